@@ -14,16 +14,47 @@ typedef void* (*memory_resource_allocate_func)(void* mem_resource,
 
 typedef void (*memory_resource_deallocate_func)(void* mem_resource, void* ptr);
 
+typedef void* (*memory_resource_reallocate_func)(void* mem_resource,
+    void* ptr,
+    size_t old_size,
+    size_t new_size,
+    size_t alignment);
+
+typedef void (*memory_resource_deallocate_sized_func)(void* mem_resource,
+    void* ptr,
+    size_t size,
+    size_t alignment);
+
+typedef size_t (*memory_resource_allocate_bulk_func)(void* mem_resource,
+    size_t size,
+    size_t alignment,
+    size_t count,
+    void** ptrs);
+
+typedef void (*memory_resource_deallocate_bulk_func)(void* mem_resource,
+    void** ptrs,
+    size_t count);
+
 /**
  * @class MemoryResource
  * @brief Base class of polymorphic memory resources
  *
  * Contains pointers to virtual allocation and deallocation functions.
+ * reallocate is optional. Like realloc, it returns the resized block, which
+ * may have moved, or NULL leaving the old block intact.
+ * deallocate_sized is optional. It receives the size and alignment the block
+ * was allocated with, so the resource does not have to look them up.
+ * allocate_bulk and deallocate_bulk are optional. allocate_bulk fills ptrs
+ * with up to count blocks and returns how many it allocated.
  */
 struct MemoryResource
 {
     memory_resource_allocate_func allocate;
     memory_resource_deallocate_func deallocate;
+    memory_resource_reallocate_func reallocate;
+    memory_resource_deallocate_sized_func deallocate_sized;
+    memory_resource_allocate_bulk_func allocate_bulk;
+    memory_resource_deallocate_bulk_func deallocate_bulk;
 };
 
 #define CMLIB_DETAILS_ALIGN(value, alignment)                                  \
@@ -63,8 +94,74 @@ INLINE void* align_ptr(void* ptr, size_t alignment)
 
 #undef CMLIB_DETAILS_ALIGN
 
+/**
+ * @brief Resizes a block allocated from the resource.
+ * Uses the reallocate entry of the resource if it has one, otherwise
+ * allocates a new block, copies and frees the old one.
+ *
+ * @param resource
+ * @param ptr block to resize, NULL to allocate a new one.
+ * @param old_size size ptr was allocated with.
+ * @param new_size
+ * @param alignment
+ * @return resized block or NULL on failure, the old block is then intact.
+ */
+void* memory_resource_reallocate(MemoryResource* resource,
+    void* ptr,
+    size_t old_size,
+    size_t new_size,
+    size_t alignment);
+
+/**
+ * @brief Frees a block allocated from the resource.
+ * Uses the deallocate_sized entry of the resource if it has one, otherwise
+ * deallocate.
+ *
+ * @param resource
+ * @param ptr
+ * @param size size ptr was allocated or last reallocated with.
+ * @param alignment alignment ptr was allocated with.
+ */
+void memory_resource_deallocate_sized(MemoryResource* resource,
+    void* ptr,
+    size_t size,
+    size_t alignment);
+
+/**
+ * @brief Allocates count blocks of the same size from the resource.
+ * Uses the allocate_bulk entry of the resource if it has one, otherwise
+ * calls allocate until it fails.
+ *
+ * @param resource
+ * @param size
+ * @param alignment
+ * @param count
+ * @param ptrs receives the allocated blocks.
+ * @return number of allocated blocks, they are the first ones in ptrs.
+ */
+size_t memory_resource_allocate_bulk(MemoryResource* resource,
+    size_t size,
+    size_t alignment,
+    size_t count,
+    void** ptrs);
+
+/**
+ * @brief Frees count blocks allocated from the resource.
+ * Uses the deallocate_bulk entry of the resource if it has one, otherwise
+ * deallocate.
+ *
+ * @param resource
+ * @param ptrs
+ * @param count
+ */
+void memory_resource_deallocate_bulk(MemoryResource* resource,
+    void** ptrs,
+    size_t count);
+
 /**
  * @brief Retrieves copy of malloc resource.
+ * Alignments above alignof(max_align_t) are served by aligned_alloc and must
+ * be powers of two.
  *
  * @return malloc memory resource.
  */
@@ -72,6 +169,7 @@ MemoryResource* get_malloc_resource(void);
 
 /**
  * @brief Retrieves copy of calloc resource.
+ * Honors alignments like the malloc resource.
  *
  * @return malloc memory resource.
  */
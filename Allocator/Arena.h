@@ -14,6 +14,16 @@
  */
 typedef struct Arena Arena;
 
+/**
+ * @class ArenaMark
+ * @brief Saved position of an arena, see arena_mark.
+ */
+typedef struct ArenaMark
+{
+    void* block;   /**< Current block of a growable arena. */
+    char* current; /**< Next available byte at the time of the mark. */
+} ArenaMark;
+
 /**
  * @brief Constructs an arena with specified size.
  *
@@ -22,6 +32,54 @@ typedef struct Arena Arena;
  */
 Arena* arena_ctor(size_t capacity);
 
+/**
+ * @brief Constructs an arena that chains a new block instead of failing when
+ * the current one is exhausted.
+ * Every block is growth_factor times larger than the previous one, and large
+ * enough for the request that needed it.
+ *
+ * @param block_size capacity of the first block, must be > 0.
+ * @param growth_factor must be > 0, 1 keeps all blocks the same size.
+ * @return arena or NULL on failure.
+ */
+Arena* arena_ctor_growable(size_t block_size, size_t growth_factor);
+
+/**
+ * @brief Constructs an arena that reserves reserve_size bytes of address
+ * space up front and commits pages in 64 KiB steps as they are needed.
+ * Allocations stay contiguous and never move. arena_flush returns the pages
+ * above the first MiB to the system.
+ *
+ * @param reserve_size must be > 0, rounded up to the page size.
+ * @return arena or NULL on failure.
+ */
+Arena* arena_ctor_virtual(size_t reserve_size);
+
+/**
+ * @brief Constructs a fixed-capacity arena whose buffer is aligned to 2 MiB
+ * and backed by huge pages, which saves TLB misses on large arenas.
+ * Falls back to regular pages when the system has no huge pages to spare.
+ *
+ * @param capacity must be > 0, rounded up to a multiple of 2 MiB.
+ * @return arena or NULL on failure.
+ */
+Arena* arena_ctor_huge(size_t capacity);
+
+/**
+ * @brief Faults in the pages of the next size bytes of the arena, so the
+ * allocations that use them do not take page faults.
+ * The range is clamped to the end of the current buffer; a virtual arena
+ * commits it first and keeps its pages across arena_flush.
+ *
+ * @param arena
+ * @param size
+ * @param lock also locks the pages in memory with mlock until the arena is
+ * destroyed.
+ * @return false if arena is NULL, the range could not be committed or mlock
+ * failed.
+ */
+bool arena_prefault(Arena* arena, size_t size, bool lock);
+
 /**
  * @brief Allocates memory in the arena.
  *
@@ -44,6 +102,25 @@ void* arena_allocate(Arena* arena, size_t size, size_t alignment);
 #define arena_allocate_type(arena, type)                                       \
     (arena_allocate(arena, sizeof(type), alignof(type)))
 
+/**
+ * @brief Resizes memory allocated in the arena.
+ * The most recent allocation grows and shrinks in place while the current
+ * block has room, others are copied to a new allocation.
+ *
+ * @param arena
+ * @param ptr memory to resize, NULL to allocate.
+ * @param old_size size ptr was allocated with.
+ * @param new_size
+ * @param alignment
+ *
+ * @return pointer to resized memory or NULL on failure.
+ */
+void* arena_reallocate(Arena* arena,
+    void* ptr,
+    size_t old_size,
+    size_t new_size,
+    size_t alignment);
+
 /**
  * @brief Dellocates memory in arena, basically a no-op.
  *
@@ -52,8 +129,44 @@ void* arena_allocate(Arena* arena, size_t size, size_t alignment);
  */
 void arena_deallocate(Arena* arena, void* ptr);
 
+/**
+ * @brief Saves the current position of the arena.
+ *
+ * @param arena
+ * @return mark to pass to arena_rewind.
+ */
+ArenaMark arena_mark(Arena* arena);
+
+/**
+ * @brief Frees everything allocated since the mark was taken.
+ * Marks taken after this one become invalid, and so do all marks after
+ * arena_flush. Blocks a growable arena chained after the mark are kept and
+ * reused before new blocks are allocated, until arena_flush.
+ *
+ * @param arena
+ * @param mark
+ */
+void arena_rewind(Arena* arena, ArenaMark mark);
+
+/**
+ * @brief Runs the following statement or block as a scope whose arena
+ * allocations are freed at its end.
+ * Leaving the scope with break, goto or return skips the rewind.
+ * arena is evaluated more than once.
+ *
+ * @param arena
+ */
+#define ARENA_SCOPE(arena)                                                     \
+    for (ArenaMark cmlib_arena_mark__ = arena_mark(arena),                     \
+                   *cmlib_arena_done__ = NULL;                                 \
+        !cmlib_arena_done__;                                                   \
+        arena_rewind(arena, cmlib_arena_mark__),                               \
+                   cmlib_arena_done__ = &cmlib_arena_mark__)
+
 /**
  * @brief Clears the arena for reuse.
+ * A growable arena keeps only its largest block, so once it has grown to fit
+ * a workload, repeating that workload does not allocate.
  *
  * @param arena
  */
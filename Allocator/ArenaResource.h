@@ -32,6 +32,32 @@ DECLARE_RESULT_HEADER(ArenaResource);
  */
 Result_ArenaResource arena_resource_ctor(size_t capacity);
 
+/**
+ * @brief Constructs a resource with a growable arena.
+ *
+ * @param block_size
+ * @param growth_factor
+ * @return result object with resource and error_code.
+ */
+Result_ArenaResource arena_resource_ctor_growable(size_t block_size,
+    size_t growth_factor);
+
+/**
+ * @brief Constructs a resource with a virtual-memory arena.
+ *
+ * @param reserve_size
+ * @return result object with resource and error_code.
+ */
+Result_ArenaResource arena_resource_ctor_virtual(size_t reserve_size);
+
+/**
+ * @brief Constructs a resource with a huge page arena.
+ *
+ * @param capacity
+ * @return result object with resource and error_code.
+ */
+Result_ArenaResource arena_resource_ctor_huge(size_t capacity);
+
 /**
  * @brief Converts existing arena into resource.
  *
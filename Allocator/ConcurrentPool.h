@@ -0,0 +1,89 @@
+/**
+ * @file ConcurrentPool.h
+ * @brief cmlib thread-safe pool allocator.
+ */
+
+#ifndef CMLIB_CONCURRENT_POOL_H_
+#define CMLIB_CONCURRENT_POOL_H_
+
+#include <stddef.h>
+
+/**
+ * @class ConcurrentPool
+ * @brief Pool that can be shared between threads.
+ *
+ * Every thread keeps a magazine of free blocks per size class up to 1024
+ * bytes and allocates and frees from it without locking. Magazines are
+ * refilled from and drained to a central pool in batches under a mutex.
+ * Larger blocks always go through the central pool.
+ * A block may be freed by any thread, not only by the one that allocated it.
+ */
+typedef struct ConcurrentPool ConcurrentPool;
+
+/**
+ * @brief Constructs a concurrent pool with specified element count per
+ * subpool.
+ *
+ * @param count must be > 0.
+ * @return pool or NULL on failure.
+ */
+ConcurrentPool* concurrent_pool_ctor(size_t count);
+
+/**
+ * @brief Frees the pool's memory, including magazines of all threads.
+ * No other thread may use the pool during and after this call.
+ *
+ * @param pool
+ */
+void concurrent_pool_dtor(ConcurrentPool* pool);
+
+/**
+ * @brief Allocates memory in the pool.
+ *
+ * @param pool
+ * @param size
+ * @param alignment must not exceed 4096.
+ *
+ * @return pointer to allocated memory or NULL on failure.
+ */
+void* concurrent_pool_allocate(ConcurrentPool* pool,
+    size_t size,
+    size_t alignment);
+
+/**
+ * @brief Allocates memory for specific type in the pool.
+ *
+ * @param pool
+ * @param type
+ *
+ * @return pointer to allocated memory or NULL on failure.
+ */
+#define concurrent_pool_allocate_type(pool, type)                              \
+    (concurrent_pool_allocate(pool, sizeof(type), alignof(type)))
+
+/**
+ * @brief Deallocates memory in the pool.
+ *
+ * @param pool
+ * @param ptr must have been returned by concurrent_pool_allocate on this
+ * pool, possibly in another thread.
+ */
+void concurrent_pool_deallocate(ConcurrentPool* pool, void* ptr);
+
+/**
+ * @brief Deallocates memory of known size in the pool.
+ * Picks the magazine from the size, which only skips looking up the subpool
+ * that owns ptr, see pool_block_size.
+ *
+ * @param pool
+ * @param ptr must have been returned by concurrent_pool_allocate on this
+ * pool, possibly in another thread.
+ * @param size size ptr was allocated with.
+ * @param alignment alignment ptr was allocated with.
+ */
+void concurrent_pool_deallocate_sized(ConcurrentPool* pool,
+    void* ptr,
+    size_t size,
+    size_t alignment);
+
+#endif // CMLIB_CONCURRENT_POOL_H_
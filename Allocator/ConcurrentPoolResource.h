@@ -0,0 +1,51 @@
+/**
+ * @file ConcurrentPoolResource.h
+ * @brief cmlib thread-safe pool memory resource.
+ */
+
+#ifndef CMLIB_CONCURRENT_POOL_RESOURCE_H_
+#define CMLIB_CONCURRENT_POOL_RESOURCE_H_
+
+#include "Allocator.h"
+#include "ConcurrentPool.h"
+#include "Result.h"
+
+/**
+ * @class ConcurrentPoolResource
+ * @brief Memory resource managing a concurrent pool.
+ * Can be shared between threads.
+ */
+typedef struct ConcurrentPoolResource
+{
+    MemoryResource base;
+    ConcurrentPool* pool;
+} ConcurrentPoolResource;
+
+DECLARE_RESULT_HEADER(ConcurrentPoolResource);
+
+/**
+ * @brief Constructs a concurrent pool resource with specified element count
+ * per subpool.
+ *
+ * @param count
+ * @return result object with resource and error_code.
+ */
+Result_ConcurrentPoolResource concurrent_pool_resource_ctor(size_t count);
+
+/**
+ * @brief Converts existing pool into resource.
+ *
+ * @param pool
+ * @return resource
+ */
+ConcurrentPoolResource concurrent_pool_to_resource(ConcurrentPool* pool);
+
+/**
+ * @brief Destroys pool resource.
+ * Do not destroy the same pool twice if you used concurrent_pool_to_resource.
+ *
+ * @param resource
+ */
+void concurrent_pool_resource_dtor(ConcurrentPoolResource* resource);
+
+#endif // CMLIB_CONCURRENT_POOL_RESOURCE_H_
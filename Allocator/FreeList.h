@@ -11,17 +11,37 @@
 /**
  * @class FreeList
  * @brief Free-list allocator like malloc.
+ *
+ * Free blocks are indexed by two-level segregated fit: power-of-two size
+ * ranges split into 16 bins each, plus bitmaps of the non-empty bins. When no
+ * pool has to be added, allocation takes two bit scans and at most one split,
+ * and deallocation takes at most two merges, so both run in constant time
+ * regardless of the number of free blocks. In exchange a request may skip
+ * a free block that would fit: only bins whose every block fits are searched,
+ * which wastes at most 1/16 of the request.
  */
 typedef struct FreeList FreeList;
 
 /**
  * @brief Constructs a free-list with specified pool_size.
  *
- * @param pool_size must be > 0.
+ * @param pool_size must be > 0 and < 4 GiB.
  * @return free-list or NULL on failure.
  */
 FreeList* free_list_ctor(size_t pool_size);
 
+/**
+ * @brief Constructs a free-list whose pools are aligned to 2 MiB and backed by
+ * huge pages, which saves TLB misses on large pools.
+ * Pools are grown to fill whole huge pages, so they may be larger than
+ * pool_size. Falls back to regular pages when the system has no huge pages
+ * to spare.
+ *
+ * @param pool_size must be > 0 and < 4 GiB.
+ * @return free-list or NULL on failure.
+ */
+FreeList* free_list_ctor_huge(size_t pool_size);
+
 /**
  * @brief Frees the free-list's memory.
  *
@@ -29,8 +49,33 @@ FreeList* free_list_ctor(size_t pool_size);
  */
 void free_list_dtor(FreeList* free_list);
 
+/**
+ * @brief Adds a pool if no free block can hold size bytes, so the next
+ * allocation of that size does not allocate a pool on the hot path.
+ *
+ * @param free_list
+ * @param size must be below MAX(pool_size, 256 KiB), larger requests get a
+ * mapping of their own and cannot be reserved.
+ * @return false if size cannot be reserved or the pool allocation failed.
+ */
+bool free_list_reserve(FreeList* free_list, size_t size);
+
+/**
+ * @brief Faults in the pages of all pools, so that allocations from them do
+ * not take page faults. Blocks mapped for large requests are not touched.
+ *
+ * @param free_list
+ * @param lock also locks the pools in memory with mlock until the free-list
+ * is destroyed.
+ * @return false if free_list is NULL or mlock failed for some pool.
+ */
+bool free_list_prefault(FreeList* free_list, bool lock);
+
 /**
  * @brief Allocates memory in the free-list.
+ * Requests of at least MAX(pool_size, 256 KiB) bytes get a memory mapping of
+ * their own, which is unmapped by free_list_deallocate. Their size is not
+ * limited to 4 GiB.
  *
  * @param free_list
  * @param size
@@ -51,14 +96,44 @@ void* free_list_allocate(FreeList* free_list, size_t size, size_t alignment);
 #define free_list_allocate_type(free_list, type)                               \
     (free_list_allocate(free_list, sizeof(type), alignof(type)))
 
+/**
+ * @brief Resizes memory allocated in the free-list.
+ * A block grows in place if the block after it is free, otherwise it is
+ * moved.
+ *
+ * @param free_list
+ * @param ptr memory to resize, NULL to allocate.
+ * @param new_size
+ * @param alignment
+ *
+ * @return pointer to resized memory or NULL on failure.
+ */
+void* free_list_reallocate(FreeList* free_list,
+    void* ptr,
+    size_t new_size,
+    size_t alignment);
+
 /**
  * @brief Deallocates memory in the free-list.
+ * The freed block is merged with free neighbours, so freeing everything
+ * leaves every pool as a single free block.
  *
  * @param free_list
  * @param ptr
  */
 void free_list_deallocate(FreeList* free_list, void* ptr);
 
+/**
+ * @brief Deallocates memory of known size in the free-list.
+ * The size tells a pool block from a mapped one, so neither the pools nor
+ * the mappings are searched for ptr.
+ *
+ * @param free_list
+ * @param ptr
+ * @param size size ptr was allocated or last reallocated with.
+ */
+void free_list_deallocate_sized(FreeList* free_list, void* ptr, size_t size);
+
 /**
  * @brief Dumps free-list internals in dot format.
  *
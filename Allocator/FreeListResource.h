@@ -32,6 +32,14 @@ DECLARE_RESULT_HEADER(FreeListResource);
  */
 Result_FreeListResource free_list_resource_ctor(size_t pool_size);
 
+/**
+ * @brief Constructs a resource with a huge page free-list.
+ *
+ * @param pool_size
+ * @return result object with resource and error_code.
+ */
+Result_FreeListResource free_list_resource_ctor_huge(size_t pool_size);
+
 /**
  * @brief Converts existing free-list into resource.
  *
@@ -0,0 +1,61 @@
+/**
+ * @file LockFreePool.h
+ * @brief cmlib lock-free fixed-size block pool.
+ */
+
+#ifndef CMLIB_LOCK_FREE_POOL_H_
+#define CMLIB_LOCK_FREE_POOL_H_
+
+#include <stddef.h>
+
+/**
+ * @class LockFreePool
+ * @brief Pool of equal-sized blocks that any thread can allocate from and
+ * free to without a mutex.
+ *
+ * Free blocks form a Treiber stack whose head is a pointer and a tag updated
+ * with a single 128-bit compare-and-swap, which protects pops from ABA.
+ * Memory is only returned to the system by lock_free_pool_dtor.
+ */
+typedef struct LockFreePool LockFreePool;
+
+/**
+ * @brief Constructs a lock-free pool.
+ *
+ * @param elem_size size of every block, must be > 0.
+ * @param alignment alignment of every block, must be a power of 2.
+ * @param count number of blocks added each time the pool runs out, must be
+ * > 0.
+ * @return pool or NULL on failure.
+ */
+LockFreePool*
+lock_free_pool_ctor(size_t elem_size, size_t alignment, size_t count);
+
+/**
+ * @brief Frees the pool's memory.
+ * No other thread may use the pool during and after this call.
+ *
+ * @param pool
+ */
+void lock_free_pool_dtor(LockFreePool* pool);
+
+/**
+ * @brief Allocates a block in the pool.
+ *
+ * @param pool
+ * @param size must not exceed the block size of the pool.
+ * @param alignment must not exceed the block alignment of the pool.
+ *
+ * @return pointer to allocated memory or NULL on failure.
+ */
+void* lock_free_pool_allocate(LockFreePool* pool, size_t size, size_t alignment);
+
+/**
+ * @brief Returns a block to the pool. May be called from any thread.
+ *
+ * @param pool
+ * @param ptr must have been returned by lock_free_pool_allocate on this pool.
+ */
+void lock_free_pool_deallocate(LockFreePool* pool, void* ptr);
+
+#endif // CMLIB_LOCK_FREE_POOL_H_
@@ -0,0 +1,55 @@
+/**
+ * @file LockFreePoolResource.h
+ * @brief cmlib lock-free pool memory resource.
+ */
+
+#ifndef CMLIB_LOCK_FREE_POOL_RESOURCE_H_
+#define CMLIB_LOCK_FREE_POOL_RESOURCE_H_
+
+#include "Allocator.h"
+#include "LockFreePool.h"
+#include "Result.h"
+
+/**
+ * @class LockFreePoolResource
+ * @brief Memory resource managing a lock-free pool.
+ * Can be shared between threads.
+ */
+typedef struct LockFreePoolResource
+{
+    MemoryResource base;
+    LockFreePool* pool;
+} LockFreePoolResource;
+
+DECLARE_RESULT_HEADER(LockFreePoolResource);
+
+/**
+ * @brief Constructs a lock-free pool resource.
+ * Allocations larger than elem_size or more aligned than alignment fail.
+ *
+ * @param elem_size
+ * @param alignment
+ * @param count
+ * @return result object with resource and error_code.
+ */
+Result_LockFreePoolResource lock_free_pool_resource_ctor(size_t elem_size,
+    size_t alignment,
+    size_t count);
+
+/**
+ * @brief Converts existing pool into resource.
+ *
+ * @param pool
+ * @return resource
+ */
+LockFreePoolResource lock_free_pool_to_resource(LockFreePool* pool);
+
+/**
+ * @brief Destroys pool resource.
+ * Do not destroy the same pool twice if you used lock_free_pool_to_resource.
+ *
+ * @param resource
+ */
+void lock_free_pool_resource_dtor(LockFreePoolResource* resource);
+
+#endif // CMLIB_LOCK_FREE_POOL_RESOURCE_H_
@@ -0,0 +1,70 @@
+/**
+ * @file MonotonicResource.h
+ * @brief cmlib monotonic buffer memory resource.
+ */
+
+#ifndef CMLIB_MONOTONIC_RESOURCE_H_
+#define CMLIB_MONOTONIC_RESOURCE_H_
+
+#include "Allocator.h"
+#include "Result.h"
+
+typedef struct MonotonicBlock MonotonicBlock;
+
+/**
+ * @class MonotonicResource
+ * @brief Memory resource that bumps through a caller-supplied buffer and then
+ * through blocks taken from an upstream resource, like
+ * std::pmr::monotonic_buffer_resource.
+ *
+ * Every upstream block is twice as large as the previous one, and large
+ * enough for the request that needed it. Deallocation is a no-op, memory is
+ * only given back by monotonic_resource_release.
+ * The state lives in the struct itself, so the resource must not be copied
+ * or moved once it is in use. Not thread-safe.
+ */
+typedef struct MonotonicResource
+{
+    MemoryResource base;
+    MemoryResource* upstream;
+    char* buffer; /**< Caller-supplied initial buffer. */
+    size_t buffer_size;
+    char* current;          /**< Next available byte. */
+    char* end;              /**< End of the current buffer or block. */
+    MonotonicBlock* blocks; /**< Upstream blocks, most recent first. */
+    size_t next_block_size; /**< Capacity of the next upstream block. */
+} MonotonicResource;
+
+DECLARE_RESULT_HEADER(MonotonicResource);
+
+/**
+ * @brief Constructs a monotonic resource.
+ * Nothing is allocated until the initial buffer is exhausted.
+ *
+ * @param buffer initial buffer, may live on the stack, NULL if buffer_size
+ * is 0. Must outlive the resource.
+ * @param buffer_size
+ * @param upstream resource that serves blocks once the buffer is full, must
+ * outlive the resource.
+ * @return result object with resource and error_code.
+ */
+Result_MonotonicResource monotonic_resource_ctor(void* buffer,
+    size_t buffer_size,
+    MemoryResource* upstream);
+
+/**
+ * @brief Returns every upstream block and starts over from the initial
+ * buffer. Everything allocated from the resource becomes invalid.
+ *
+ * @param resource
+ */
+void monotonic_resource_release(MonotonicResource* resource);
+
+/**
+ * @brief Destroys the resource, releasing its upstream blocks.
+ *
+ * @param resource
+ */
+void monotonic_resource_dtor(MonotonicResource* resource);
+
+#endif // CMLIB_MONOTONIC_RESOURCE_H_
@@ -0,0 +1,73 @@
+/**
+ * @file MultiPoolResource.h
+ * @brief cmlib pool memory resource with a fixed set of size classes.
+ */
+
+#ifndef CMLIB_MULTI_POOL_RESOURCE_H_
+#define CMLIB_MULTI_POOL_RESOURCE_H_
+
+#include "Allocator.h"
+#include "Pool.h"
+#include "Result.h"
+
+typedef struct MultiPoolLargeBlock MultiPoolLargeBlock;
+
+/**
+ * @class MultiPoolResource
+ * @brief Memory resource that rounds sizes to a fixed set of size classes
+ * served by a pool, and passes blocks larger than max_block_size to an
+ * upstream resource, like std::pmr::unsynchronized_pool_resource.
+ *
+ * Classes are 8 bytes apart up to 64 bytes and four per power of two above,
+ * so a block wastes at most a quarter of its size and containers of many
+ * different sizes share a few subpools. Reallocation within a class does not
+ * move the block.
+ * Deallocation without a size searches the upstream blocks, prefer
+ * memory_resource_deallocate_sized. The resource must not be copied or moved
+ * once it holds upstream blocks. Not thread-safe.
+ */
+typedef struct MultiPoolResource
+{
+    MemoryResource base;
+    Pool* pool;
+    MemoryResource* upstream;
+    size_t max_block_size;
+    MultiPoolLargeBlock* large_blocks; /**< Blocks taken from upstream. */
+} MultiPoolResource;
+
+DECLARE_RESULT_HEADER(MultiPoolResource);
+
+/**
+ * @brief Constructs a multi pool resource.
+ *
+ * @param count element count per subpool of every size class.
+ * @param max_block_size largest block served by the pool, larger blocks and
+ * alignments above 4096 go to upstream.
+ * @param upstream must outlive the resource.
+ * @return result object with resource and error_code.
+ */
+Result_MultiPoolResource multi_pool_resource_ctor(size_t count,
+    size_t max_block_size,
+    MemoryResource* upstream);
+
+/**
+ * @brief Returns the size of the block serving an allocation of size bytes
+ * at alignment.
+ *
+ * @param resource
+ * @param size
+ * @param alignment
+ * @return class size, or size itself if the block comes from upstream.
+ */
+size_t multi_pool_resource_block_size(const MultiPoolResource* resource,
+    size_t size,
+    size_t alignment);
+
+/**
+ * @brief Destroys the resource, returning its upstream blocks.
+ *
+ * @param resource
+ */
+void multi_pool_resource_dtor(MultiPoolResource* resource);
+
+#endif // CMLIB_MULTI_POOL_RESOURCE_H_
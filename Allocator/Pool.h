@@ -11,17 +11,69 @@
 /**
  * @class Pool
  * @brief Fixed-count allocator for equal-sized blocks.
+ * Sizes up to 1024 bytes are looked up in a direct-indexed class table.
  */
 typedef struct Pool Pool;
 
 /**
  * @brief Constructs a pool with specified element count per subpool.
+ * Slabs are rounded up to a multiple of 64 KiB and a subpool gets every block
+ * that fits into its slab, so it may hold more than count blocks.
  *
- * @param count
+ * @param count must be > 0.
  * @return pool or NULL on failure.
  */
 Pool* pool_ctor(size_t count);
 
+/**
+ * @brief Constructs a pool and creates a subpool for every expected size up
+ * front, so the first allocations of these sizes do not hit the slow path.
+ *
+ * @param count must be > 0.
+ * @param elem_sizes expected block sizes, zeros are skipped.
+ * @param class_count number of entries in elem_sizes.
+ * @return pool or NULL on failure.
+ */
+Pool* pool_ctor_classes(size_t count,
+    const size_t* elem_sizes,
+    size_t class_count);
+
+/**
+ * @brief Constructs a pool whose slabs are aligned to 2 MiB and backed by huge
+ * pages, which saves TLB misses when a pool holds millions of blocks.
+ * Slabs are rounded up to a multiple of 2 MiB instead of 64 KiB.
+ * Falls back to regular pages when the system has no huge pages to spare.
+ *
+ * @param count must be > 0.
+ * @return pool or NULL on failure.
+ */
+Pool* pool_ctor_huge(size_t count);
+
+/**
+ * @brief Creates subpools for blocks of elem_size until the pool can serve
+ * count more of them without creating a subpool on the allocation path.
+ * Reserved subpools stay until pool_trim, or until they are used and become
+ * empty again, see pool_set_retained_empty.
+ *
+ * @param pool
+ * @param elem_size size of the expected blocks, aligned to at most 8 bytes.
+ * @param count
+ * @return false if a subpool could not be allocated.
+ */
+bool pool_reserve(Pool* pool, size_t elem_size, size_t count);
+
+/**
+ * @brief Faults in the slabs of all current subpools, so that carving blocks
+ * from them does not take page faults. Call it after pool_reserve to warm up
+ * the reserved subpools.
+ *
+ * @param pool
+ * @param lock also locks the slabs in memory with mlock until they are
+ * released.
+ * @return false if pool is NULL or mlock failed for some slab.
+ */
+bool pool_prefault(Pool* pool, bool lock);
+
 /**
  * @brief Frees the pool's memory.
  *
@@ -34,7 +86,7 @@ void pool_dtor(Pool* pool);
  *
  * @param pool
  * @param size
- * @param alignment
+ * @param alignment must not exceed 4096.
  *
  * @return pointer to allocated memory or NULL on failure.
  */
@@ -53,10 +105,72 @@ void* pool_allocate(Pool* pool, size_t size, size_t alignment);
 
 /**
  * @brief Deallocates memory in the pool.
+ * Runs in constant time: the owning subpool is found by masking ptr.
+ * The subpool is released if it becomes empty and its size class already
+ * keeps enough empty subpools, see pool_set_retained_empty.
  *
  * @param pool
- * @param ptr
+ * @param ptr must have been returned by pool_allocate on this pool.
  */
 void pool_deallocate(Pool* pool, void* ptr);
 
+/**
+ * @brief Allocates count blocks of the same size in the pool.
+ * Whole runs are taken from the free list and the uncarved tail of a subpool
+ * at once.
+ *
+ * @param pool
+ * @param size
+ * @param alignment must not exceed 4096.
+ * @param count
+ * @param ptrs receives the allocated blocks.
+ * @return number of allocated blocks, less than count only on failure.
+ */
+size_t pool_allocate_bulk(Pool* pool,
+    size_t size,
+    size_t alignment,
+    size_t count,
+    void** ptrs);
+
+/**
+ * @brief Deallocates count blocks in the pool.
+ * Consecutive blocks of the same subpool are pushed onto its free list as
+ * one chain.
+ *
+ * @param pool
+ * @param ptrs blocks returned by pool_allocate or pool_allocate_bulk on this
+ * pool, NULL entries are skipped.
+ * @param count
+ */
+void pool_deallocate_bulk(Pool* pool, void** ptrs, size_t count);
+
+/**
+ * @brief Returns the size of the block ptr points to.
+ * Only reads immutable subpool data, so it is safe to call without holding
+ * the lock that guards the pool.
+ *
+ * @param pool
+ * @param ptr must have been returned by pool_allocate on this pool.
+ * @return block size or 0 if pool or ptr is NULL.
+ */
+size_t pool_block_size(Pool* pool, void* ptr);
+
+/**
+ * @brief Sets how many empty subpools every size class keeps.
+ * Subpools that become empty beyond this limit are released on deallocation.
+ * Defaults to 1.
+ *
+ * @param pool
+ * @param retained
+ */
+void pool_set_retained_empty(Pool* pool, size_t retained);
+
+/**
+ * @brief Releases all empty subpools.
+ *
+ * @param pool
+ * @return number of released subpools.
+ */
+size_t pool_trim(Pool* pool);
+
 #endif // CMLIB_POOL_H_
@@ -30,6 +30,26 @@ DECLARE_RESULT_HEADER(PoolResource);
  */
 Result_PoolResource pool_resource_ctor(size_t count);
 
+/**
+ * @brief Constructs a pool resource with pre-registered size classes.
+ *
+ * @param count
+ * @param elem_sizes
+ * @param class_count
+ * @return result object with resource and error_code.
+ */
+Result_PoolResource pool_resource_ctor_classes(size_t count,
+    const size_t* elem_sizes,
+    size_t class_count);
+
+/**
+ * @brief Constructs a pool resource whose slabs are backed by huge pages.
+ *
+ * @param count
+ * @return result object with resource and error_code.
+ */
+Result_PoolResource pool_resource_ctor_huge(size_t count);
+
 /**
  * @brief Converts existing pool into resource.
  *
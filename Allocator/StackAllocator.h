@@ -0,0 +1,106 @@
+/**
+ * @file StackAllocator.h
+ * @brief cmlib LIFO stack allocator.
+ */
+
+#ifndef CMLIB_STACK_ALLOCATOR_H_
+#define CMLIB_STACK_ALLOCATOR_H_
+
+#include <stddef.h>
+
+/**
+ * @class StackAllocator
+ * @brief Bump allocator that frees the most recent block in O(1).
+ * Every block is preceded by a 16 byte header pointing back at the previous
+ * block and at the top of the stack before the allocation. A block freed out
+ * of order is marked and popped together with the blocks above it once they
+ * are freed, so strictly nested temporaries reuse memory immediately.
+ */
+typedef struct StackAllocator StackAllocator;
+
+/**
+ * @brief Constructs a stack allocator with specified size.
+ *
+ * @param capacity must be > 0.
+ * @return stack allocator or NULL on failure.
+ */
+StackAllocator* stack_allocator_ctor(size_t capacity);
+
+/**
+ * @brief Frees the stack allocator's memory.
+ *
+ * @param stack
+ */
+void stack_allocator_dtor(StackAllocator* stack);
+
+/**
+ * @brief Allocates memory on top of the stack.
+ *
+ * @param stack
+ * @param size
+ * @param alignment
+ *
+ * @return pointer to allocated memory or NULL on failure.
+ */
+void* stack_allocator_allocate(StackAllocator* stack,
+    size_t size,
+    size_t alignment);
+
+/**
+ * @brief Allocates memory for specific type on top of the stack.
+ *
+ * @param stack
+ * @param type
+ *
+ * @return pointer to allocated memory or NULL on failure.
+ */
+#define stack_allocator_allocate_type(stack, type)                             \
+    (stack_allocator_allocate(stack, sizeof(type), alignof(type)))
+
+/**
+ * @brief Resizes memory allocated on the stack.
+ * The top block grows and shrinks in place while the stack has room and it
+ * satisfies alignment, others are copied to a new block on top and freed.
+ *
+ * @param stack
+ * @param ptr memory to resize, NULL to allocate.
+ * @param old_size size ptr was allocated with.
+ * @param new_size
+ * @param alignment
+ *
+ * @return pointer to resized memory or NULL on failure.
+ */
+void* stack_allocator_reallocate(StackAllocator* stack,
+    void* ptr,
+    size_t old_size,
+    size_t new_size,
+    size_t alignment);
+
+/**
+ * @brief Deallocates memory on the stack.
+ * Freeing the top block pops it, together with the blocks below it that were
+ * already freed. Other blocks are only marked and popped later. Freeing a
+ * block twice asserts in debug builds.
+ *
+ * @param stack
+ * @param ptr
+ */
+void stack_allocator_deallocate(StackAllocator* stack, void* ptr);
+
+/**
+ * @brief Frees all blocks at once.
+ *
+ * @param stack
+ */
+void stack_allocator_clear(StackAllocator* stack);
+
+/**
+ * @brief Returns how many bytes of the stack are in use, including headers,
+ * padding and blocks freed out of order.
+ *
+ * @param stack
+ * @return used bytes or 0 if stack is NULL.
+ */
+size_t stack_allocator_used(const StackAllocator* stack);
+
+#endif // CMLIB_STACK_ALLOCATOR_H_
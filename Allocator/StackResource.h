@@ -0,0 +1,52 @@
+/**
+ * @file StackResource.h
+ * @brief cmlib stack memory resource.
+ */
+
+#ifndef CMLIB_STACK_RESOURCE_H_
+#define CMLIB_STACK_RESOURCE_H_
+
+#include <stddef.h>
+
+#include "Allocator.h"
+#include "Result.h"
+#include "StackAllocator.h"
+
+/**
+ * @class StackResource
+ * @brief Memory resource managing a stack allocator.
+ */
+typedef struct StackResource
+{
+    MemoryResource base;
+    StackAllocator* stack;
+} StackResource;
+
+DECLARE_RESULT_HEADER(StackResource);
+
+/**
+ * @brief Constructs a stack resource with specified capacity.
+ *
+ * @param capacity
+ * @return result object with resource and error_code.
+ */
+Result_StackResource stack_resource_ctor(size_t capacity);
+
+/**
+ * @brief Converts existing stack allocator into resource.
+ *
+ * @param stack
+ * @return resource
+ */
+StackResource stack_to_resource(StackAllocator* stack);
+
+/**
+ * @brief Destroys stack resource.
+ * Do not destroy the same stack allocator twice if you used
+ * stack_to_resource.
+ *
+ * @param resource
+ */
+void stack_resource_dtor(StackResource* resource);
+
+#endif // CMLIB_STACK_RESOURCE_H_
@@ -0,0 +1,110 @@
+/**
+ * @file StatsResource.h
+ * @brief cmlib statistics-collecting memory resource.
+ */
+
+#ifndef CMLIB_STATS_RESOURCE_H_
+#define CMLIB_STATS_RESOURCE_H_
+
+#include <limits.h>
+#include <stdio.h>
+
+#include "Allocator.h"
+#include "Result.h"
+
+/**
+ * Requested sizes are counted in power-of-two buckets: bucket 0 holds sizes
+ * up to 1 byte, bucket i sizes in (2^(i-1), 2^i]. Alignments are counted by
+ * their base-2 logarithm.
+ */
+static constexpr size_t CMLIB_STATS_SIZE_BUCKET_COUNT =
+    sizeof(size_t) * CHAR_BIT + 1;
+static constexpr size_t CMLIB_STATS_ALIGNMENT_BUCKET_COUNT =
+    sizeof(size_t) * CHAR_BIT;
+
+/**
+ * @class MemoryStats
+ * @brief Totals collected by a StatsResource.
+ */
+typedef struct MemoryStats
+{
+    size_t allocations;   /**< Successful allocations. */
+    size_t frees;         /**< Deallocations. */
+    size_t reallocations; /**< Successful reallocations. */
+    size_t failures;      /**< Allocations and reallocations that failed. */
+    size_t live_bytes;    /**< Requested bytes not freed yet. */
+    size_t peak_bytes;    /**< Highest live_bytes seen. */
+    size_t sizes[CMLIB_STATS_SIZE_BUCKET_COUNT];
+    size_t alignments[CMLIB_STATS_ALIGNMENT_BUCKET_COUNT];
+} MemoryStats;
+
+typedef struct StatsState StatsState;
+
+/**
+ * @class StatsResource
+ * @brief Memory resource that forwards to an upstream resource and counts
+ * what passes through it.
+ *
+ * Every thread updates counters of its own, which are summed when they are
+ * read, so threads sharing the resource do not contend on them. Every block
+ * carries a 16 byte header in front of it holding its size, so frees are
+ * counted in bytes even when the caller does not know the size.
+ * Can be shared between threads if the upstream resource can.
+ */
+typedef struct StatsResource
+{
+    MemoryResource base;
+    MemoryResource* upstream;
+    StatsState* state;
+} StatsResource;
+
+DECLARE_RESULT_HEADER(StatsResource);
+
+/**
+ * @brief Constructs a stats resource on top of upstream.
+ *
+ * @param upstream resource that serves the memory, must outlive the stats
+ * resource.
+ * @return result object with resource and error_code.
+ */
+Result_StatsResource stats_resource_ctor(MemoryResource* upstream);
+
+/**
+ * @brief Destroys the counters of the stats resource. Blocks still allocated
+ * through it stay allocated in the upstream resource.
+ * No other thread may use the resource during and after this call.
+ *
+ * @param resource
+ */
+void stats_resource_dtor(StatsResource* resource);
+
+/**
+ * @brief Sums the counters of all threads.
+ * Counters of other threads may be a few operations behind. peak_bytes is
+ * updated in steps of 64 KiB per thread, so it may miss a peak by that much
+ * per thread.
+ *
+ * @param resource
+ * @return totals, all zero if resource is NULL.
+ */
+MemoryStats stats_resource_collect(const StatsResource* resource);
+
+/**
+ * @brief Prints stats as plain text, one counter per line, followed by the
+ * non-empty histogram buckets.
+ *
+ * @param stats
+ * @param out
+ */
+void memory_stats_dump(const MemoryStats* stats, FILE* out);
+
+/**
+ * @brief Prints stats as a JSON object. Histograms are arrays of non-empty
+ * buckets.
+ *
+ * @param stats
+ * @param out
+ */
+void memory_stats_dump_json(const MemoryStats* stats, FILE* out);
+
+#endif // CMLIB_STATS_RESOURCE_H_
@@ -0,0 +1,106 @@
+/**
+ * @file TraceResource.h
+ * @brief cmlib memory resource that records allocations to a trace file.
+ */
+
+#ifndef CMLIB_TRACE_RESOURCE_H_
+#define CMLIB_TRACE_RESOURCE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "Allocator.h"
+#include "Result.h"
+
+typedef enum TraceOp
+{
+    TRACE_ALLOCATE,
+    TRACE_DEALLOCATE,
+    TRACE_REALLOCATE,
+} TraceOp;
+
+/**
+ * A trace file starts with a TraceHeader followed by TraceRecords in host
+ * byte order.
+ */
+typedef struct TraceHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size; /**< sizeof(TraceRecord) of the writer. */
+} TraceHeader;
+
+typedef struct TraceRecord
+{
+    uint64_t timestamp; /**< Nanoseconds since the trace was started. */
+    uint64_t id;        /**< Block id, 0 for a failed allocation. */
+    uint64_t size;      /**< Requested size, 0 for a deallocation. */
+    uint32_t alignment;
+    uint16_t thread; /**< Number of the calling thread, starting from 1. */
+    uint8_t op;      /**< TraceOp. */
+    uint8_t reserved;
+} TraceRecord;
+
+typedef struct TraceState TraceState;
+
+/**
+ * @class TraceResource
+ * @brief Memory resource that forwards to an upstream resource and streams
+ * every allocation, deallocation and reallocation to a binary trace file.
+ *
+ * Blocks are numbered from 1 in allocation order and keep their id when they
+ * are reallocated, so ids are never reused and a replay can keep blocks in an
+ * array. Every block carries a header in front of it holding its id, size and
+ * alignment. A record is written before the block is handed out or after the
+ * caller gave it up, so the records of one block are in order even when
+ * threads pass blocks between them.
+ * Can be shared between threads if the upstream resource can.
+ */
+typedef struct TraceResource
+{
+    MemoryResource base;
+    MemoryResource* upstream;
+    TraceState* state;
+} TraceResource;
+
+DECLARE_RESULT_HEADER(TraceResource);
+
+/**
+ * @brief Constructs a trace resource on top of upstream and starts a trace
+ * file at path, replacing an existing one.
+ *
+ * @param upstream resource that serves the memory, must outlive the trace
+ * resource.
+ * @param path
+ * @return result object with resource and error_code.
+ */
+Result_TraceResource trace_resource_ctor(MemoryResource* upstream,
+    const char* path);
+
+/**
+ * @brief Writes buffered records to the trace file.
+ *
+ * @param resource
+ * @return ERROR_BAD_FILE if some record could not be written.
+ */
+ErrorCode trace_resource_flush(TraceResource* resource);
+
+/**
+ * @brief Flushes and closes the trace file. Blocks still allocated through
+ * the resource stay allocated in the upstream resource.
+ * No other thread may use the resource during and after this call.
+ *
+ * @param resource
+ */
+void trace_resource_dtor(TraceResource* resource);
+
+/**
+ * @brief Reads and checks the header of a trace file, leaving file at the
+ * first record.
+ *
+ * @param file
+ * @return ERROR_BAD_FILE if file is not a trace of this version.
+ */
+ErrorCode trace_read_header(FILE* file);
+
+#endif // CMLIB_TRACE_RESOURCE_H_
@@ -3,11 +3,50 @@
 
 #include <stddef.h>
 
-extern size_t standard_allocations_count;
-extern size_t standard_frees_count;
+/**
+ * @class MallocStats
+ * @brief Totals of the counting malloc wrappers over all threads.
+ *
+ * Byte counts are usable sizes as reported by malloc_usable_size, so
+ * bytes_live stays exact although free does not receive a size.
+ * In a difference of two snapshots bytes_live wraps around when memory was
+ * released, cast it to ptrdiff_t.
+ */
+typedef struct MallocStats
+{
+    size_t allocations;     /**< Successful allocations. */
+    size_t frees;           /**< Calls to free, including free(NULL). */
+    size_t bytes_requested; /**< Sum of requested sizes. */
+    size_t bytes_live;      /**< Usable bytes not freed yet. */
+} MallocStats;
+
+/**
+ * @brief Sums the counters of all threads.
+ * Every thread counts in a cache line of its own, so counting does not
+ * contend between threads. Counters of other threads may be a few
+ * operations behind unless they were joined.
+ *
+ * @return totals since program start.
+ */
+MallocStats cmlib_details_malloc_stats(void);
+
+/**
+ * @brief Returns what happened between two snapshots.
+ *
+ * @param before
+ * @param after
+ * @return after - before, field by field.
+ */
+MallocStats cmlib_details_malloc_stats_diff(MallocStats before,
+    MallocStats after);
+
+#define standard_allocations_count (cmlib_details_malloc_stats().allocations)
+#define standard_frees_count (cmlib_details_malloc_stats().frees)
 
 void* cmlib_details_malloc(size_t size);
 void* cmlib_details_calloc(size_t nmemb, size_t size);
+void* cmlib_details_aligned_alloc(size_t alignment, size_t size);
+void* cmlib_details_realloc(void* ptr, size_t size);
 
 void cmlib_details_free(void* ptr);
 
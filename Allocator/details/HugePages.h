@@ -0,0 +1,32 @@
+#ifndef CMLIB_HUGE_PAGES_H_
+#define CMLIB_HUGE_PAGES_H_
+
+#include <stddef.h>
+
+/**
+ * Slabs backed by huge pages are aligned to CMLIB_HUGE_PAGE_SIZE and their
+ * size is a multiple of it.
+ */
+static constexpr size_t CMLIB_HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+/**
+ * @brief Maps size bytes aligned to CMLIB_HUGE_PAGE_SIZE.
+ * Takes pages from the reserved huge page pool with MAP_HUGETLB when it has
+ * enough of them, otherwise maps regular pages and asks for transparent huge
+ * pages with madvise(MADV_HUGEPAGE). Where neither is available the mapping
+ * silently stays on regular pages.
+ *
+ * @param size must be a multiple of CMLIB_HUGE_PAGE_SIZE.
+ * @return mapping or NULL on failure.
+ */
+void* cmlib_details_huge_alloc(size_t size);
+
+/**
+ * @brief Unmaps a mapping of cmlib_details_huge_alloc.
+ *
+ * @param ptr
+ * @param size size passed to cmlib_details_huge_alloc.
+ */
+void cmlib_details_huge_free(void* ptr, size_t size);
+
+#endif // CMLIB_HUGE_PAGES_H_
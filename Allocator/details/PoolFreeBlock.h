@@ -0,0 +1,13 @@
+#ifndef CMLIB_POOL_FREE_BLOCK_H_
+#define CMLIB_POOL_FREE_BLOCK_H_
+
+/**
+ * @brief Intrusive free list node stored in unused pool blocks.
+ */
+typedef struct PoolFreeBlock PoolFreeBlock;
+struct PoolFreeBlock
+{
+    PoolFreeBlock* next;
+};
+
+#endif // CMLIB_POOL_FREE_BLOCK_H_
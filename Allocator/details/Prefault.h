@@ -0,0 +1,28 @@
+#ifndef CMLIB_PREFAULT_H_
+#define CMLIB_PREFAULT_H_
+
+#include <stddef.h>
+
+/**
+ * @brief Faults in the pages of a range ahead of use, so that touching them
+ * later does not take a page fault. Writes every page of the range without
+ * changing its contents, so the range may hold live data as long as no other
+ * thread writes it meanwhile.
+ *
+ * @param ptr
+ * @param size
+ * @param lock also locks the pages in memory with mlock.
+ * @return false if mlock failed, for example over RLIMIT_MEMLOCK.
+ */
+bool cmlib_details_prefault(void* ptr, size_t size, bool lock);
+
+/**
+ * @brief Unlocks the pages of a range locked by cmlib_details_prefault.
+ * Must be called before freeing malloc memory, unmapping unlocks by itself.
+ *
+ * @param ptr
+ * @param size
+ */
+void cmlib_details_unlock(void* ptr, size_t size);
+
+#endif // CMLIB_PREFAULT_H_
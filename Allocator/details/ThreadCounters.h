@@ -0,0 +1,101 @@
+#ifndef CMLIB_THREAD_COUNTERS_H_
+#define CMLIB_THREAD_COUNTERS_H_
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include "../../common.h"
+
+/**
+ * @class ThreadCounters
+ * @brief Registry of per-thread counters.
+ *
+ * Every thread that counts gets count counters in cache lines of its own,
+ * which only it writes, so counting does not contend between threads. When a
+ * thread exits its counters are added to the retired ones, so sums over the
+ * registry stay complete. The registry allocates with plain malloc, so the
+ * counting malloc wrappers can use it without counting themselves.
+ */
+typedef struct ThreadCounters ThreadCounters;
+
+/**
+ * Called at thread exit with the counters of the thread, right before they
+ * are added to the retired ones.
+ */
+typedef void (*thread_counters_exit_t)(void* context, atomic_size_t* counters);
+
+/**
+ * @brief Constructs a registry.
+ *
+ * @param count number of counters per thread, must be > 0.
+ * @param on_exit called at thread exit, may be NULL.
+ * @param context passed to on_exit.
+ * @return registry or NULL on failure.
+ */
+ThreadCounters* cmlib_details_thread_counters_ctor(size_t count,
+    thread_counters_exit_t on_exit,
+    void* context);
+
+/**
+ * @brief Frees the registry and the counters of all threads.
+ * No other thread may count during and after this call.
+ *
+ * @param registry
+ */
+void cmlib_details_thread_counters_dtor(ThreadCounters* registry);
+
+/**
+ * @brief Returns the counters of the calling thread, creating and registering
+ * them on first use.
+ *
+ * @param registry
+ * @return counters or NULL if they could not be created.
+ */
+atomic_size_t* cmlib_details_thread_counters_get(ThreadCounters* registry);
+
+/**
+ * @brief Locks the registry and returns the retired counters, for threads
+ * that have no counters of their own.
+ *
+ * @param registry
+ * @return retired counters, valid until
+ * cmlib_details_thread_counters_unlock_retired.
+ */
+atomic_size_t*
+cmlib_details_thread_counters_lock_retired(ThreadCounters* registry);
+
+/**
+ * @brief Unlocks the registry locked by
+ * cmlib_details_thread_counters_lock_retired.
+ *
+ * @param registry
+ */
+void cmlib_details_thread_counters_unlock_retired(ThreadCounters* registry);
+
+/**
+ * @brief Sums every counter over the retired counters and those of all
+ * running threads. Counters of other threads may be a few operations behind
+ * unless they were joined.
+ *
+ * @param registry
+ * @param sums array of count sums, overwritten.
+ */
+void cmlib_details_thread_counters_sum(ThreadCounters* registry, size_t* sums);
+
+/**
+ * Counters have a single writer, so a relaxed load and store is enough and
+ * avoids a locked instruction.
+ */
+INLINE void cmlib_details_counter_add(atomic_size_t* counter, size_t value)
+{
+    atomic_store_explicit(counter,
+        atomic_load_explicit(counter, memory_order_relaxed) + value,
+        memory_order_relaxed);
+}
+
+INLINE size_t cmlib_details_counter_load(const atomic_size_t* counter)
+{
+    return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+#endif // CMLIB_THREAD_COUNTERS_H_
@@ -1,21 +1,41 @@
 #include "Allocator.h"
 
+#include <stddef.h>
+#include <string.h>
+
 #include "details/CountingMalloc.h"
 
+static void* malloc_aligned_allocate(size_t size, size_t alignment);
+
 static void*
 malloc_resource_allocate(void* resource, size_t size, size_t alignment)
 {
     (void)resource;
-    (void)alignment;
-    return cmlib_details_malloc(size);
+
+    if (alignment <= alignof(max_align_t))
+    {
+        return cmlib_details_malloc(size);
+    }
+
+    return malloc_aligned_allocate(size, alignment);
 }
 
 static void*
 calloc_resource_allocate(void* resource, size_t size, size_t alignment)
 {
     (void)resource;
-    (void)alignment;
-    return cmlib_details_calloc(1, size);
+
+    if (alignment <= alignof(max_align_t))
+    {
+        return cmlib_details_calloc(1, size);
+    }
+
+    void* ptr = malloc_aligned_allocate(size, alignment);
+    if (ptr)
+    {
+        memset(ptr, 0, size);
+    }
+    return ptr;
 }
 
 static void malloc_resource_deallocate(void* resource, void* ptr)
@@ -24,11 +44,56 @@ static void malloc_resource_deallocate(void* resource, void* ptr)
     cmlib_details_free(ptr);
 }
 
+/**
+ * realloc only keeps the alignment of malloc, so over-aligned blocks are
+ * moved by hand.
+ */
+static void* malloc_resource_reallocate(void* resource,
+    void* ptr,
+    size_t old_size,
+    size_t new_size,
+    size_t alignment)
+{
+    (void)resource;
+
+    if (alignment <= alignof(max_align_t))
+    {
+        return cmlib_details_realloc(ptr, new_size);
+    }
+
+    void* new_ptr = malloc_aligned_allocate(new_size, alignment);
+    if (!new_ptr)
+    {
+        return NULL;
+    }
+
+    memcpy(new_ptr, ptr, MIN(old_size, new_size));
+    cmlib_details_free(ptr);
+
+    return new_ptr;
+}
+
+/**
+ * Allocates size bytes at an alignment larger than malloc provides.
+ * aligned_alloc expects the size to be a multiple of the alignment.
+ */
+static void* malloc_aligned_allocate(size_t size, size_t alignment)
+{
+    if ((alignment & (alignment - 1)) != 0 || size > SIZE_MAX - alignment)
+    {
+        return NULL;
+    }
+
+    return cmlib_details_aligned_alloc(alignment, align_size(size, alignment));
+}
+
 static MemoryResource malloc_resource = {
     .allocate = malloc_resource_allocate,
     .deallocate = malloc_resource_deallocate,
+    .reallocate = malloc_resource_reallocate,
 };
 
+// realloc would leave the new tail uninitialized
 static MemoryResource calloc_resource = {
     .allocate = calloc_resource_allocate,
     .deallocate = malloc_resource_deallocate,
@@ -37,6 +102,113 @@ static MemoryResource calloc_resource = {
 size_t align_size(size_t, size_t);
 void* align_ptr(void*, size_t);
 
+void* memory_resource_reallocate(MemoryResource* resource,
+    void* ptr,
+    size_t old_size,
+    size_t new_size,
+    size_t alignment)
+{
+    if (!resource)
+    {
+        return NULL;
+    }
+
+    if (!ptr)
+    {
+        return resource->allocate(resource, new_size, alignment);
+    }
+
+    if (resource->reallocate)
+    {
+        return resource->reallocate(resource,
+            ptr,
+            old_size,
+            new_size,
+            alignment);
+    }
+
+    void* new_ptr = resource->allocate(resource, new_size, alignment);
+    if (!new_ptr)
+    {
+        return NULL;
+    }
+
+    memcpy(new_ptr, ptr, MIN(old_size, new_size));
+    memory_resource_deallocate_sized(resource, ptr, old_size, alignment);
+
+    return new_ptr;
+}
+
+void memory_resource_deallocate_sized(MemoryResource* resource,
+    void* ptr,
+    size_t size,
+    size_t alignment)
+{
+    if (!resource)
+    {
+        return;
+    }
+
+    if (resource->deallocate_sized)
+    {
+        resource->deallocate_sized(resource, ptr, size, alignment);
+        return;
+    }
+
+    resource->deallocate(resource, ptr);
+}
+
+size_t memory_resource_allocate_bulk(MemoryResource* resource,
+    size_t size,
+    size_t alignment,
+    size_t count,
+    void** ptrs)
+{
+    if (!resource || !ptrs)
+    {
+        return 0;
+    }
+
+    if (resource->allocate_bulk)
+    {
+        return resource->allocate_bulk(resource, size, alignment, count, ptrs);
+    }
+
+    size_t allocated = 0;
+    while (allocated < count)
+    {
+        void* ptr = resource->allocate(resource, size, alignment);
+        if (!ptr)
+        {
+            break;
+        }
+        ptrs[allocated++] = ptr;
+    }
+
+    return allocated;
+}
+
+void memory_resource_deallocate_bulk(MemoryResource* resource,
+    void** ptrs,
+    size_t count)
+{
+    if (!resource || !ptrs)
+    {
+        return;
+    }
+
+    if (resource->deallocate_bulk)
+    {
+        resource->deallocate_bulk(resource, ptrs, count);
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        resource->deallocate(resource, ptrs[i]);
+    }
+}
+
 MemoryResource* get_malloc_resource(void)
 {
     return &malloc_resource;
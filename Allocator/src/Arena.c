@@ -1,21 +1,69 @@
 #include "Arena.h"
 
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
 #include "Allocator.h"
 #include "details/CountingMalloc.h"
+#include "details/HugePages.h"
+#include "details/Prefault.h"
+
+/**
+ * Header of a block of a growable arena, followed by capacity bytes.
+ */
+typedef struct ArenaBlock ArenaBlock;
+struct ArenaBlock
+{
+    ArenaBlock* prev; /**< Block filled before this one. */
+    size_t capacity;
+};
+
+/**
+ * A virtual arena commits its reservation in steps of ARENA_COMMIT_SIZE and on
+ * flush returns the pages above ARENA_RETAINED_COMMIT_SIZE to the system.
+ */
+static constexpr size_t ARENA_COMMIT_SIZE = 64 * 1024;
+static constexpr size_t ARENA_RETAINED_COMMIT_SIZE = 1024 * 1024;
 
 struct Arena
 {
     char* buffer;  /**< Start of owned storage. */
     char* current; /**< Next available byte. */
     char* end;     /**< One-past-end pointer. */
+
+    ArenaBlock* block;      /**< Current block of a growable arena. */
+    ArenaBlock* spare;      /**< Blocks released by arena_rewind. */
+    size_t growth_factor;   /**< 0 for fixed-capacity arenas. */
+    size_t next_block_size; /**< Capacity of the next chained block. */
+
+    char* reserve_end;  /**< End of the range reserved by a virtual arena. */
+    char* prefault_end; /**< A virtual arena keeps pages up to here on flush. */
+    size_t huge_size;   /**< Size of the buffer mapping of a huge arena. */
+    bool locked;        /**< arena_prefault locked some pages. */
 };
 
 Arena* arena_ctor(size_t);
+Arena* arena_ctor_growable(size_t, size_t);
+Arena* arena_ctor_virtual(size_t);
+Arena* arena_ctor_huge(size_t);
+bool arena_prefault(Arena*, size_t, bool);
 void* arena_allocate(Arena*, size_t, size_t);
+void* arena_reallocate(Arena*, void*, size_t, size_t, size_t);
 void arena_deallocate(Arena*, void*);
+ArenaMark arena_mark(Arena*);
+void arena_rewind(Arena*, ArenaMark);
 void arena_flush(Arena*);
 void arena_dtor(Arena*);
 
+static bool arena_grow(Arena* arena, size_t size, size_t alignment);
+static bool arena_commit(Arena* arena, char* allocated_ptr, size_t size);
+static void arena_use_block(Arena* arena, ArenaBlock* block);
+static void
+arena_free_blocks(ArenaBlock* block, const ArenaBlock* keep, bool locked);
+
 Arena* arena_ctor(size_t capacity)
 {
     if (capacity == 0)
@@ -41,6 +89,138 @@ Arena* arena_ctor(size_t capacity)
     return arena;
 }
 
+Arena* arena_ctor_growable(size_t block_size, size_t growth_factor)
+{
+    if (block_size == 0 || growth_factor == 0)
+    {
+        return NULL;
+    }
+
+    Arena* arena = (Arena*)cmlib_details_malloc(sizeof(Arena));
+
+    if (!arena)
+    {
+        return NULL;
+    }
+
+    *arena = (Arena) {
+        .growth_factor = growth_factor,
+        .next_block_size = block_size,
+    };
+
+    if (!arena_grow(arena, 1, 1))
+    {
+        cmlib_details_free(arena);
+        return NULL;
+    }
+
+    return arena;
+}
+
+Arena* arena_ctor_virtual(size_t reserve_size)
+{
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+
+    if (reserve_size == 0 || reserve_size > SIZE_MAX - page_size)
+    {
+        return NULL;
+    }
+
+    reserve_size = align_size(reserve_size, page_size);
+
+    Arena* arena = (Arena*)cmlib_details_malloc(sizeof(Arena));
+
+    if (!arena)
+    {
+        return NULL;
+    }
+
+    char* buf = mmap(NULL,
+        reserve_size,
+        PROT_NONE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+        -1,
+        0);
+
+    if (buf == MAP_FAILED)
+    {
+        cmlib_details_free(arena);
+        return NULL;
+    }
+
+    *arena = (Arena) {
+        .buffer = buf,
+        .current = buf,
+        .end = buf,
+        .reserve_end = buf + reserve_size,
+    };
+
+    return arena;
+}
+
+Arena* arena_ctor_huge(size_t capacity)
+{
+    if (capacity == 0 || capacity > SIZE_MAX - CMLIB_HUGE_PAGE_SIZE)
+    {
+        return NULL;
+    }
+
+    capacity = align_size(capacity, CMLIB_HUGE_PAGE_SIZE);
+
+    Arena* arena = (Arena*)cmlib_details_malloc(sizeof(Arena));
+
+    if (!arena)
+    {
+        return NULL;
+    }
+
+    char* buf = cmlib_details_huge_alloc(capacity);
+
+    if (!buf)
+    {
+        cmlib_details_free(arena);
+        return NULL;
+    }
+
+    *arena = (Arena) {
+        .buffer = buf,
+        .current = buf,
+        .end = buf + capacity,
+        .huge_size = capacity,
+    };
+
+    return arena;
+}
+
+bool arena_prefault(Arena* arena, size_t size, bool lock)
+{
+    if (!arena)
+    {
+        return false;
+    }
+
+    char* begin = arena->current;
+    if (arena->reserve_end && size > (size_t)(arena->end - begin)
+        && !arena_commit(arena, begin, size))
+    {
+        return false;
+    }
+
+    size = MIN(size, (size_t)(arena->end - begin));
+    if (!cmlib_details_prefault(begin, size, lock))
+    {
+        return false;
+    }
+
+    arena->locked |= lock;
+    if (arena->reserve_end)
+    {
+        arena->prefault_end = MAX(arena->prefault_end, begin + size);
+    }
+
+    return true;
+}
+
 void* arena_allocate(Arena* arena, size_t size, size_t alignment)
 {
     if (!arena || size == 0 || alignment == 0)
@@ -50,9 +230,18 @@ void* arena_allocate(Arena* arena, size_t size, size_t alignment)
 
     char* allocated_ptr = align_ptr(arena->current, alignment);
 
-    if (allocated_ptr + size > arena->end)
+    if (allocated_ptr > arena->end
+        || size > (size_t)(arena->end - allocated_ptr))
     {
-        return NULL;
+        bool expanded = arena->reserve_end
+            ? arena_commit(arena, allocated_ptr, size)
+            : arena->growth_factor && arena_grow(arena, size, alignment);
+        if (!expanded)
+        {
+            return NULL;
+        }
+
+        allocated_ptr = align_ptr(arena->current, alignment);
     }
 
     arena->current = allocated_ptr + size;
@@ -60,8 +249,89 @@ void* arena_allocate(Arena* arena, size_t size, size_t alignment)
     return (void*)allocated_ptr;
 }
 
+void* arena_reallocate(Arena* arena,
+    void* ptr,
+    size_t old_size,
+    size_t new_size,
+    size_t alignment)
+{
+    if (!arena || new_size == 0 || alignment == 0)
+    {
+        return NULL;
+    }
+
+    if (!ptr)
+    {
+        return arena_allocate(arena, new_size, alignment);
+    }
+
+    char* block = ptr;
+
+    if (block >= arena->buffer && block + old_size == arena->current)
+    {
+        if (new_size <= (size_t)(arena->end - block)
+            || (arena->reserve_end && arena_commit(arena, block, new_size)))
+        {
+            arena->current = block + new_size;
+            return ptr;
+        }
+    }
+    else if (new_size <= old_size)
+    {
+        return ptr;
+    }
+
+    void* new_ptr = arena_allocate(arena, new_size, alignment);
+    if (!new_ptr)
+    {
+        return NULL;
+    }
+
+    memcpy(new_ptr, ptr, MIN(old_size, new_size));
+
+    return new_ptr;
+}
+
 void arena_deallocate(Arena*, void*) {}
 
+ArenaMark arena_mark(Arena* arena)
+{
+    if (!arena)
+    {
+        return (ArenaMark) {};
+    }
+
+    return (ArenaMark) {
+        .block = arena->block,
+        .current = arena->current,
+    };
+}
+
+void arena_rewind(Arena* arena, ArenaMark mark)
+{
+    if (!arena || !mark.current)
+    {
+        return;
+    }
+
+    if (arena->block != mark.block)
+    {
+        ArenaBlock* cur = arena->block;
+        while (cur && cur != mark.block)
+        {
+            ArenaBlock* prev = cur->prev;
+            cur->prev = arena->spare;
+            arena->spare = cur;
+            cur = prev;
+        }
+
+        assert(cur && "mark does not belong to the arena");
+        arena_use_block(arena, cur);
+    }
+
+    arena->current = mark.current;
+}
+
 void arena_flush(Arena* arena)
 {
     if (!arena)
@@ -69,6 +339,36 @@ void arena_flush(Arena* arena)
         return;
     }
 
+    if (arena->block)
+    {
+        ArenaBlock* largest = arena->block;
+        for (ArenaBlock* cur = arena->block; cur; cur = cur->prev)
+        {
+            largest = cur->capacity > largest->capacity ? cur : largest;
+        }
+        for (ArenaBlock* cur = arena->spare; cur; cur = cur->prev)
+        {
+            largest = cur->capacity > largest->capacity ? cur : largest;
+        }
+
+        arena_free_blocks(arena->block, largest, arena->locked);
+        arena_free_blocks(arena->spare, largest, arena->locked);
+        arena->spare = NULL;
+        largest->prev = NULL;
+        arena_use_block(arena, largest);
+    }
+
+    size_t committed = (size_t)(arena->end - arena->buffer);
+    size_t retained = arena->prefault_end
+        ? MAX(ARENA_RETAINED_COMMIT_SIZE,
+              align_size((size_t)(arena->prefault_end - arena->buffer),
+                  ARENA_COMMIT_SIZE))
+        : ARENA_RETAINED_COMMIT_SIZE;
+    if (arena->reserve_end && committed > retained)
+    {
+        madvise(arena->buffer + retained, committed - retained, MADV_DONTNEED);
+    }
+
     arena->current = arena->buffer;
 }
 
@@ -79,5 +379,133 @@ void arena_dtor(Arena* arena)
         return;
     }
 
+    arena_free_blocks(arena->block, NULL, arena->locked);
+    arena_free_blocks(arena->spare, NULL, arena->locked);
+
+    bool fixed = !arena->growth_factor && !arena->reserve_end
+        && !arena->huge_size;
+    if (arena->locked && fixed)
+    {
+        cmlib_details_unlock(arena->buffer,
+            (size_t)(arena->end - arena->buffer));
+    }
+
+    if (arena->reserve_end)
+    {
+        munmap(arena->buffer, (size_t)(arena->reserve_end - arena->buffer));
+    }
+
+    if (arena->huge_size)
+    {
+        cmlib_details_huge_free(arena->buffer, arena->huge_size);
+    }
+
     cmlib_details_free(arena);
 }
+
+/**
+ * Chains a block that fits size bytes at alignment and makes it current.
+ * The next spare block is reused if it fits. New blocks grow by
+ * growth_factor, but never get smaller than the request.
+ */
+static bool arena_grow(Arena* arena, size_t size, size_t alignment)
+{
+    if (size > SIZE_MAX - alignment)
+    {
+        return false;
+    }
+
+    ArenaBlock* spare = arena->spare;
+    if (spare && spare->capacity >= size + alignment - 1)
+    {
+        arena->spare = spare->prev;
+        spare->prev = arena->block;
+        arena_use_block(arena, spare);
+        return true;
+    }
+
+    size_t capacity = MAX(arena->next_block_size, size + alignment - 1);
+
+    if (capacity > SIZE_MAX - sizeof(ArenaBlock))
+    {
+        return false;
+    }
+
+    auto block =
+        (ArenaBlock*)cmlib_details_malloc(sizeof(ArenaBlock) + capacity);
+    if (!block)
+    {
+        return false;
+    }
+
+    block->prev = arena->block;
+    block->capacity = capacity;
+    arena_use_block(arena, block);
+
+    arena->next_block_size = capacity <= SIZE_MAX / arena->growth_factor
+        ? capacity * arena->growth_factor
+        : SIZE_MAX;
+
+    return true;
+}
+
+/**
+ * Makes the reserved pages up to allocated_ptr + size accessible, committing
+ * at least ARENA_COMMIT_SIZE bytes at a time.
+ */
+static bool arena_commit(Arena* arena, char* allocated_ptr, size_t size)
+{
+    if (allocated_ptr > arena->reserve_end
+        || size > (size_t)(arena->reserve_end - allocated_ptr))
+    {
+        return false;
+    }
+
+    size_t reserved = (size_t)(arena->reserve_end - arena->buffer);
+    size_t needed = (size_t)(allocated_ptr - arena->buffer) + size;
+    size_t committed = MIN(align_size(needed, ARENA_COMMIT_SIZE), reserved);
+
+    char* new_end = arena->buffer + committed;
+    if (mprotect(arena->end,
+            (size_t)(new_end - arena->end),
+            PROT_READ | PROT_WRITE)
+        != 0)
+    {
+        return false;
+    }
+
+    arena->end = new_end;
+
+    return true;
+}
+
+/**
+ * Frees the chain of blocks starting at block, except keep. Blocks of an
+ * arena that locked pages are unlocked first.
+ */
+static void
+arena_free_blocks(ArenaBlock* block, const ArenaBlock* keep, bool locked)
+{
+    while (block)
+    {
+        ArenaBlock* prev = block->prev;
+        if (block != keep)
+        {
+            if (locked)
+            {
+                cmlib_details_unlock(block,
+                    sizeof(ArenaBlock) + block->capacity);
+            }
+            cmlib_details_free(block);
+        }
+        block = prev;
+    }
+}
+
+static void arena_use_block(Arena* arena, ArenaBlock* block)
+{
+    arena->block = block;
+    arena->buffer = (char*)(block + 1);
+    arena->current = arena->buffer;
+    arena->end = arena->buffer + block->capacity;
+}
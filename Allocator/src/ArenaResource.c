@@ -3,12 +3,20 @@
 DECLARE_RESULT_SOURCE(ArenaResource);
 
 Result_ArenaResource arena_resource_ctor(size_t);
+Result_ArenaResource arena_resource_ctor_growable(size_t, size_t);
+Result_ArenaResource arena_resource_ctor_virtual(size_t);
+Result_ArenaResource arena_resource_ctor_huge(size_t);
 ArenaResource arena_to_resource(Arena*);
 void arena_resource_dtor(ArenaResource*);
 
 static void*
 arena_resource_allocate(void* resource, size_t size, size_t alignment);
 static void arena_resource_deallocate(void* resource, void* ptr);
+static void* arena_resource_reallocate(void* resource,
+    void* ptr,
+    size_t old_size,
+    size_t new_size,
+    size_t alignment);
 
 Result_ArenaResource arena_resource_ctor(size_t capacity)
 {
@@ -21,6 +29,40 @@ Result_ArenaResource arena_resource_ctor(size_t capacity)
     return Result_ArenaResource_ctor(arena_to_resource(arena), EVERYTHING_FINE);
 }
 
+Result_ArenaResource arena_resource_ctor_growable(size_t block_size,
+    size_t growth_factor)
+{
+    Arena* arena = arena_ctor_growable(block_size, growth_factor);
+    if (!arena)
+    {
+        return Result_ArenaResource_ctor((ArenaResource) {}, ERROR_NULLPTR);
+    }
+
+    return Result_ArenaResource_ctor(arena_to_resource(arena), EVERYTHING_FINE);
+}
+
+Result_ArenaResource arena_resource_ctor_virtual(size_t reserve_size)
+{
+    Arena* arena = arena_ctor_virtual(reserve_size);
+    if (!arena)
+    {
+        return Result_ArenaResource_ctor((ArenaResource) {}, ERROR_NULLPTR);
+    }
+
+    return Result_ArenaResource_ctor(arena_to_resource(arena), EVERYTHING_FINE);
+}
+
+Result_ArenaResource arena_resource_ctor_huge(size_t capacity)
+{
+    Arena* arena = arena_ctor_huge(capacity);
+    if (!arena)
+    {
+        return Result_ArenaResource_ctor((ArenaResource) {}, ERROR_NULLPTR);
+    }
+
+    return Result_ArenaResource_ctor(arena_to_resource(arena), EVERYTHING_FINE);
+}
+
 ArenaResource arena_to_resource(Arena* arena)
 {
     if (!arena)
@@ -33,6 +75,7 @@ ArenaResource arena_to_resource(Arena* arena)
             (MemoryResource) {
                 .allocate = arena_resource_allocate,
                 .deallocate = arena_resource_deallocate,
+                .reallocate = arena_resource_reallocate,
             },
         .arena = arena,
     };
@@ -62,3 +105,14 @@ static void arena_resource_deallocate(void* resource, void* ptr)
     ArenaResource* ar = (ArenaResource*)resource;
     arena_deallocate(ar->arena, ptr);
 }
+
+static void* arena_resource_reallocate(void* resource,
+    void* ptr,
+    size_t old_size,
+    size_t new_size,
+    size_t alignment)
+{
+    assert(resource);
+    ArenaResource* ar = (ArenaResource*)resource;
+    return arena_reallocate(ar->arena, ptr, old_size, new_size, alignment);
+}
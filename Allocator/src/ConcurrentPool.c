@@ -0,0 +1,402 @@
+#include "ConcurrentPool.h"
+
+#include <threads.h>
+
+#include "Allocator.h"
+#include "Pool.h"
+#include "details/CountingMalloc.h"
+
+/**
+ * Aligned sizes up to CONCURRENT_POOL_CLASS_MAX are cached per thread, one
+ * magazine per multiple of CONCURRENT_POOL_CLASS_GRANULARITY.
+ */
+static constexpr size_t CONCURRENT_POOL_CLASS_GRANULARITY = 8;
+static constexpr size_t CONCURRENT_POOL_CLASS_MAX = 1024;
+static constexpr size_t CONCURRENT_POOL_CLASS_COUNT =
+    CONCURRENT_POOL_CLASS_MAX / CONCURRENT_POOL_CLASS_GRANULARITY;
+
+/**
+ * A magazine holds up to CONCURRENT_POOL_MAGAZINE_SIZE blocks and exchanges
+ * CONCURRENT_POOL_BATCH_SIZE of them with the central pool at a time, so a
+ * thread that alternates allocations and frees does not take the lock.
+ */
+static constexpr size_t CONCURRENT_POOL_MAGAZINE_SIZE = 64;
+static constexpr size_t CONCURRENT_POOL_BATCH_SIZE =
+    CONCURRENT_POOL_MAGAZINE_SIZE / 2;
+
+typedef struct Magazine
+{
+    size_t count;
+    void* blocks[CONCURRENT_POOL_MAGAZINE_SIZE];
+} Magazine;
+
+typedef struct ThreadCache ThreadCache;
+struct ThreadCache
+{
+    ConcurrentPool* pool;
+    ThreadCache *prev, *next; /**< Caches of all threads using the pool. */
+    Magazine* magazines[CONCURRENT_POOL_CLASS_COUNT];
+};
+
+struct ConcurrentPool
+{
+    Pool* central;
+    mtx_t lock; /**< Guards central and caches. */
+    tss_t cache_key;
+    ThreadCache* caches;
+};
+
+static ThreadCache* thread_cache_get(ConcurrentPool* pool);
+static void thread_cache_dtor(void* cache);
+static void thread_cache_free(ThreadCache* cache);
+
+static Magazine* thread_cache_magazine(ThreadCache* cache, size_t size);
+
+static bool magazine_refill(ConcurrentPool* pool,
+    Magazine* magazine,
+    size_t size,
+    size_t alignment);
+static void magazine_drain(ConcurrentPool* pool, Magazine* magazine);
+
+static size_t magazine_index(size_t size);
+
+static void
+cached_deallocate(ConcurrentPool* pool, void* ptr, size_t aligned_size);
+
+static void* central_allocate(ConcurrentPool* pool,
+    size_t size,
+    size_t alignment);
+static void central_deallocate(ConcurrentPool* pool, void* ptr);
+
+ConcurrentPool* concurrent_pool_ctor(size_t count)
+{
+    ConcurrentPool* pool = cmlib_details_malloc(sizeof(ConcurrentPool));
+    if (!pool)
+    {
+        return NULL;
+    }
+
+    *pool = (ConcurrentPool) {
+        .central = pool_ctor(count),
+    };
+
+    if (!pool->central)
+    {
+        cmlib_details_free(pool);
+        return NULL;
+    }
+
+    if (mtx_init(&pool->lock, mtx_plain) != thrd_success)
+    {
+        pool_dtor(pool->central);
+        cmlib_details_free(pool);
+        return NULL;
+    }
+
+    if (tss_create(&pool->cache_key, thread_cache_dtor) != thrd_success)
+    {
+        mtx_destroy(&pool->lock);
+        pool_dtor(pool->central);
+        cmlib_details_free(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+void concurrent_pool_dtor(ConcurrentPool* pool)
+{
+    if (!pool)
+    {
+        return;
+    }
+
+    tss_delete(pool->cache_key);
+
+    ThreadCache* cur = pool->caches;
+    while (cur)
+    {
+        ThreadCache* next = cur->next;
+        thread_cache_free(cur);
+        cur = next;
+    }
+
+    pool_dtor(pool->central);
+    mtx_destroy(&pool->lock);
+    cmlib_details_free(pool);
+}
+
+void* concurrent_pool_allocate(ConcurrentPool* pool,
+    size_t size,
+    size_t alignment)
+{
+    if (!pool || size == 0 || alignment == 0)
+    {
+        return NULL;
+    }
+
+    alignment = MAX(alignment, alignof(void*));
+    size_t aligned_size = align_size(size, alignment);
+
+    if (aligned_size > CONCURRENT_POOL_CLASS_MAX)
+    {
+        return central_allocate(pool, size, alignment);
+    }
+
+    ThreadCache* cache = thread_cache_get(pool);
+    Magazine* magazine =
+        cache ? thread_cache_magazine(cache, aligned_size) : NULL;
+
+    if (!magazine)
+    {
+        return central_allocate(pool, size, alignment);
+    }
+
+    if (magazine->count == 0
+        && !magazine_refill(pool, magazine, aligned_size, alignment))
+    {
+        return NULL;
+    }
+
+    return magazine->blocks[--magazine->count];
+}
+
+void concurrent_pool_deallocate(ConcurrentPool* pool, void* ptr)
+{
+    if (!pool || !ptr)
+    {
+        return;
+    }
+
+    cached_deallocate(pool, ptr, pool_block_size(pool->central, ptr));
+}
+
+void concurrent_pool_deallocate_sized(ConcurrentPool* pool,
+    void* ptr,
+    size_t size,
+    size_t alignment)
+{
+    if (!pool || !ptr)
+    {
+        return;
+    }
+
+    alignment = MAX(alignment, alignof(void*));
+    cached_deallocate(pool, ptr, align_size(size, alignment));
+}
+
+/**
+ * Returns the cache of the calling thread, creating and registering it on
+ * first use.
+ */
+static ThreadCache* thread_cache_get(ConcurrentPool* pool)
+{
+    ThreadCache* cache = tss_get(pool->cache_key);
+    if (cache)
+    {
+        return cache;
+    }
+
+    mtx_lock(&pool->lock);
+
+    cache = cmlib_details_calloc(1, sizeof(ThreadCache));
+    if (cache)
+    {
+        cache->pool = pool;
+        cache->next = pool->caches;
+        if (cache->next)
+        {
+            cache->next->prev = cache;
+        }
+        pool->caches = cache;
+    }
+
+    mtx_unlock(&pool->lock);
+
+    if (cache && tss_set(pool->cache_key, cache) != thrd_success)
+    {
+        thread_cache_dtor(cache);
+        return NULL;
+    }
+
+    return cache;
+}
+
+/**
+ * Runs at thread exit: returns all cached blocks to the central pool and
+ * unregisters the cache.
+ */
+static void thread_cache_dtor(void* cache)
+{
+    ThreadCache* tc = cache;
+    ConcurrentPool* pool = tc->pool;
+
+    mtx_lock(&pool->lock);
+
+    for (size_t i = 0; i < CONCURRENT_POOL_CLASS_COUNT; i++)
+    {
+        Magazine* magazine = tc->magazines[i];
+        if (!magazine)
+        {
+            continue;
+        }
+
+        for (size_t j = 0; j < magazine->count; j++)
+        {
+            pool_deallocate(pool->central, magazine->blocks[j]);
+        }
+        magazine->count = 0;
+    }
+
+    if (tc->prev)
+    {
+        tc->prev->next = tc->next;
+    }
+    else
+    {
+        pool->caches = tc->next;
+    }
+    if (tc->next)
+    {
+        tc->next->prev = tc->prev;
+    }
+
+    thread_cache_free(tc);
+
+    mtx_unlock(&pool->lock);
+}
+
+static void thread_cache_free(ThreadCache* cache)
+{
+    for (size_t i = 0; i < CONCURRENT_POOL_CLASS_COUNT; i++)
+    {
+        cmlib_details_free(cache->magazines[i]);
+    }
+
+    cmlib_details_free(cache);
+}
+
+/**
+ * Returns the magazine of the cache for blocks of aligned size, creating it on
+ * first use.
+ */
+static Magazine* thread_cache_magazine(ThreadCache* cache, size_t size)
+{
+    Magazine** slot = &cache->magazines[magazine_index(size)];
+    if (*slot)
+    {
+        return *slot;
+    }
+
+    Magazine* magazine = cmlib_details_malloc(sizeof(Magazine));
+
+    if (magazine)
+    {
+        magazine->count = 0;
+        *slot = magazine;
+    }
+
+    return magazine;
+}
+
+/**
+ * Takes a batch of blocks of aligned size from the central pool.
+ *
+ * @return false if no block could be allocated.
+ */
+static bool magazine_refill(ConcurrentPool* pool,
+    Magazine* magazine,
+    size_t size,
+    size_t alignment)
+{
+    mtx_lock(&pool->lock);
+
+    while (magazine->count < CONCURRENT_POOL_BATCH_SIZE)
+    {
+        void* block = pool_allocate(pool->central, size, alignment);
+        if (!block)
+        {
+            break;
+        }
+        magazine->blocks[magazine->count++] = block;
+    }
+
+    mtx_unlock(&pool->lock);
+
+    return magazine->count != 0;
+}
+
+/**
+ * Returns the oldest batch of blocks of a full magazine to the central pool.
+ */
+static void magazine_drain(ConcurrentPool* pool, Magazine* magazine)
+{
+    mtx_lock(&pool->lock);
+
+    for (size_t i = 0; i < CONCURRENT_POOL_BATCH_SIZE; i++)
+    {
+        pool_deallocate(pool->central, magazine->blocks[i]);
+    }
+
+    mtx_unlock(&pool->lock);
+
+    magazine->count -= CONCURRENT_POOL_BATCH_SIZE;
+    for (size_t i = 0; i < magazine->count; i++)
+    {
+        magazine->blocks[i] = magazine->blocks[i + CONCURRENT_POOL_BATCH_SIZE];
+    }
+}
+
+static size_t magazine_index(size_t size)
+{
+    return size / CONCURRENT_POOL_CLASS_GRANULARITY - 1;
+}
+
+/**
+ * Puts a block of aligned size into the magazine of the calling thread, or
+ * returns it to the central pool if it is not cached.
+ */
+static void
+cached_deallocate(ConcurrentPool* pool, void* ptr, size_t aligned_size)
+{
+    if (aligned_size > CONCURRENT_POOL_CLASS_MAX)
+    {
+        central_deallocate(pool, ptr);
+        return;
+    }
+
+    ThreadCache* cache = thread_cache_get(pool);
+    Magazine* magazine =
+        cache ? thread_cache_magazine(cache, aligned_size) : NULL;
+
+    if (!magazine)
+    {
+        central_deallocate(pool, ptr);
+        return;
+    }
+
+    if (magazine->count == CONCURRENT_POOL_MAGAZINE_SIZE)
+    {
+        magazine_drain(pool, magazine);
+    }
+
+    magazine->blocks[magazine->count++] = ptr;
+}
+
+static void* central_allocate(ConcurrentPool* pool,
+    size_t size,
+    size_t alignment)
+{
+    mtx_lock(&pool->lock);
+    void* ret = pool_allocate(pool->central, size, alignment);
+    mtx_unlock(&pool->lock);
+
+    return ret;
+}
+
+static void central_deallocate(ConcurrentPool* pool, void* ptr)
+{
+    mtx_lock(&pool->lock);
+    pool_deallocate(pool->central, ptr);
+    mtx_unlock(&pool->lock);
+}
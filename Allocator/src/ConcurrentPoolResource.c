@@ -0,0 +1,79 @@
+#include "ConcurrentPoolResource.h"
+
+DECLARE_RESULT_SOURCE(ConcurrentPoolResource);
+
+static void* concurrent_pool_resource_allocate(void* resource,
+    size_t size,
+    size_t alignment);
+static void concurrent_pool_resource_deallocate(void* resource, void* ptr);
+static void concurrent_pool_resource_deallocate_sized(void* resource,
+    void* ptr,
+    size_t size,
+    size_t alignment);
+
+Result_ConcurrentPoolResource concurrent_pool_resource_ctor(size_t count)
+{
+    ConcurrentPool* pool = concurrent_pool_ctor(count);
+    if (!pool)
+    {
+        return Result_ConcurrentPoolResource_ctor((ConcurrentPoolResource) {},
+            ERROR_NULLPTR);
+    }
+
+    return Result_ConcurrentPoolResource_ctor(concurrent_pool_to_resource(pool),
+        EVERYTHING_FINE);
+}
+
+ConcurrentPoolResource concurrent_pool_to_resource(ConcurrentPool* pool)
+{
+    if (!pool)
+    {
+        return (ConcurrentPoolResource) {};
+    }
+
+    return (ConcurrentPoolResource) {
+        .base =
+            (MemoryResource) {
+                .allocate = concurrent_pool_resource_allocate,
+                .deallocate = concurrent_pool_resource_deallocate,
+                .deallocate_sized = concurrent_pool_resource_deallocate_sized,
+            },
+        .pool = pool,
+    };
+}
+
+void concurrent_pool_resource_dtor(ConcurrentPoolResource* resource)
+{
+    if (!resource)
+    {
+        return;
+    }
+
+    concurrent_pool_dtor(resource->pool);
+}
+
+static void* concurrent_pool_resource_allocate(void* resource,
+    size_t size,
+    size_t alignment)
+{
+    assert(resource);
+    ConcurrentPoolResource* cpr = (ConcurrentPoolResource*)(resource);
+    return concurrent_pool_allocate(cpr->pool, size, alignment);
+}
+
+static void concurrent_pool_resource_deallocate(void* resource, void* ptr)
+{
+    assert(resource);
+    ConcurrentPoolResource* cpr = (ConcurrentPoolResource*)(resource);
+    return concurrent_pool_deallocate(cpr->pool, ptr);
+}
+
+static void concurrent_pool_resource_deallocate_sized(void* resource,
+    void* ptr,
+    size_t size,
+    size_t alignment)
+{
+    assert(resource);
+    ConcurrentPoolResource* cpr = (ConcurrentPoolResource*)(resource);
+    concurrent_pool_deallocate_sized(cpr->pool, ptr, size, alignment);
+}
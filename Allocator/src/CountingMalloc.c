@@ -1,24 +1,193 @@
 #include "details/CountingMalloc.h"
 
+#include <malloc.h>
+#include <stdatomic.h>
 #include <stdlib.h>
+#include <threads.h>
 
-size_t standard_allocations_count = 0;
-size_t standard_frees_count = 0;
+#include "details/ThreadCounters.h"
+
+typedef enum MallocCounter
+{
+    MALLOC_ALLOCATIONS,
+    MALLOC_FREES,
+    MALLOC_BYTES_REQUESTED,
+    MALLOC_BYTES_LIVE,
+    MALLOC_COUNTER_COUNT,
+} MallocCounter;
+
+static once_flag counters_once = ONCE_FLAG_INIT;
+static ThreadCounters* counters_registry;
+static thread_local atomic_size_t* thread_counters;
+
+static void counters_init(void);
+static void counters_exit(void* context, atomic_size_t* counters);
+static void counters_record(size_t allocations,
+    size_t frees,
+    size_t bytes_requested,
+    size_t bytes_allocated,
+    size_t bytes_freed);
+static void counters_add(atomic_size_t* counters,
+    size_t allocations,
+    size_t frees,
+    size_t bytes_requested,
+    size_t bytes_live);
+
+MallocStats cmlib_details_malloc_stats(void)
+{
+    call_once(&counters_once, counters_init);
+
+    if (!counters_registry)
+    {
+        return (MallocStats) {};
+    }
+
+    size_t sums[MALLOC_COUNTER_COUNT] = {};
+    cmlib_details_thread_counters_sum(counters_registry, sums);
+
+    return (MallocStats) {
+        .allocations = sums[MALLOC_ALLOCATIONS],
+        .frees = sums[MALLOC_FREES],
+        .bytes_requested = sums[MALLOC_BYTES_REQUESTED],
+        .bytes_live = sums[MALLOC_BYTES_LIVE],
+    };
+}
+
+MallocStats cmlib_details_malloc_stats_diff(MallocStats before,
+    MallocStats after)
+{
+    return (MallocStats) {
+        .allocations = after.allocations - before.allocations,
+        .frees = after.frees - before.frees,
+        .bytes_requested = after.bytes_requested - before.bytes_requested,
+        .bytes_live = after.bytes_live - before.bytes_live,
+    };
+}
 
 void* cmlib_details_malloc(size_t size)
 {
-    standard_allocations_count++;
-    return malloc(size);
+    void* ptr = malloc(size);
+    if (ptr)
+    {
+        counters_record(1, 0, size, malloc_usable_size(ptr), 0);
+    }
+    return ptr;
 }
 
 void* cmlib_details_calloc(size_t nmemb, size_t size)
 {
-    standard_allocations_count++;
-    return calloc(nmemb, size);
+    void* ptr = calloc(nmemb, size);
+    if (ptr)
+    {
+        // calloc fails if the product overflows
+        counters_record(1, 0, nmemb * size, malloc_usable_size(ptr), 0);
+    }
+    return ptr;
+}
+
+void* cmlib_details_aligned_alloc(size_t alignment, size_t size)
+{
+    void* ptr = aligned_alloc(alignment, size);
+    if (ptr)
+    {
+        counters_record(1, 0, size, malloc_usable_size(ptr), 0);
+    }
+    return ptr;
+}
+
+void* cmlib_details_realloc(void* ptr, size_t size)
+{
+    size_t old_usable = malloc_usable_size(ptr);
+
+    void* new_ptr = realloc(ptr, size);
+    if (new_ptr)
+    {
+        counters_record(1,
+            ptr ? 1 : 0,
+            size,
+            malloc_usable_size(new_ptr),
+            old_usable);
+    }
+    else if (ptr && size == 0)
+    {
+        counters_record(0, 1, 0, 0, old_usable);
+    }
+
+    return new_ptr;
 }
 
 void cmlib_details_free(void* ptr)
 {
-    standard_frees_count++;
+    counters_record(0, 1, 0, 0, malloc_usable_size(ptr));
     free(ptr);
 }
+
+
+/**
+ * The registry is never destroyed, so allocations made while other static
+ * data is torn down are still counted.
+ */
+static void counters_init(void)
+{
+    counters_registry = cmlib_details_thread_counters_ctor(MALLOC_COUNTER_COUNT,
+        counters_exit,
+        NULL);
+}
+
+/**
+ * Forgets the cached counters of an exiting thread, the registry frees them.
+ */
+static void counters_exit(void* context, atomic_size_t* counters)
+{
+    (void)context;
+    (void)counters;
+    thread_counters = NULL;
+}
+
+static void counters_record(size_t allocations,
+    size_t frees,
+    size_t bytes_requested,
+    size_t bytes_allocated,
+    size_t bytes_freed)
+{
+    if (!thread_counters)
+    {
+        call_once(&counters_once, counters_init);
+        if (!counters_registry)
+        {
+            return;
+        }
+        thread_counters = cmlib_details_thread_counters_get(counters_registry);
+    }
+
+    if (!thread_counters)
+    {
+        counters_add(
+            cmlib_details_thread_counters_lock_retired(counters_registry),
+            allocations,
+            frees,
+            bytes_requested,
+            bytes_allocated - bytes_freed);
+        cmlib_details_thread_counters_unlock_retired(counters_registry);
+        return;
+    }
+
+    counters_add(thread_counters,
+        allocations,
+        frees,
+        bytes_requested,
+        bytes_allocated - bytes_freed);
+}
+
+static void counters_add(atomic_size_t* counters,
+    size_t allocations,
+    size_t frees,
+    size_t bytes_requested,
+    size_t bytes_live)
+{
+    cmlib_details_counter_add(&counters[MALLOC_ALLOCATIONS], allocations);
+    cmlib_details_counter_add(&counters[MALLOC_FREES], frees);
+    cmlib_details_counter_add(&counters[MALLOC_BYTES_REQUESTED],
+        bytes_requested);
+    cmlib_details_counter_add(&counters[MALLOC_BYTES_LIVE], bytes_live);
+}
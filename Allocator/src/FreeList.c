@@ -3,50 +3,171 @@
 #include <assert.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 #include "../../common.h"
 #include "Allocator.h"
 #include "Error.h"
 #include "details/CountingMalloc.h"
+#include "details/HugePages.h"
+#include "details/Prefault.h"
+
+/**
+ * Every block of a pool starts with a FreeListBlockHeader. The size of a block
+ * is a multiple of FREE_LIST_BLOCK_GRANULARITY, so the low bits of size hold
+ * the block flags. A free block also stores its size in a footer at its end,
+ * which lets the next block find it when merging.
+ *
+ * An occupied block keeps the distance from its start to the payload in the
+ * 4 bytes right before the payload. With the payload right after the header
+ * this is the offset field of the header itself.
+ */
+typedef struct FreeListBlockHeader
+{
+    uint32_t size;
+    uint32_t offset;
+} FreeListBlockHeader;
 
 typedef struct FreeListFreeBlockHeader FreeListFreeBlockHeader;
 struct FreeListFreeBlockHeader
 {
-    size_t size;
+    FreeListBlockHeader header;
+    FreeListFreeBlockHeader* prev;
     FreeListFreeBlockHeader* next;
 };
 
-typedef struct FreeListOccupiedBlockHeader
-{
-    uint32_t size;
-    uint32_t padding;
-} FreeListOccupiedBlockHeader;
-
 typedef struct FreeListMemoryPool FreeListMemoryPool;
 struct FreeListMemoryPool
 {
-    FreeListMemoryPool* next_pool;
-    FreeListFreeBlockHeader* free_block;
-    void* pool_end;
+    void* pool_end; /**< Header of the sentinel block closing the pool. */
 };
 
+static constexpr uint32_t FREE_LIST_BLOCK_FREE = 1;
+static constexpr uint32_t FREE_LIST_PREV_FREE = 2;
+static constexpr uint32_t FREE_LIST_FLAGS_MASK = 7;
+
+static constexpr size_t FREE_LIST_BLOCK_GRANULARITY = 8;
+static constexpr size_t FREE_LIST_FOOTER_SIZE = FREE_LIST_BLOCK_GRANULARITY;
+static constexpr size_t FREE_LIST_MIN_BLOCK_SIZE =
+    sizeof(FreeListFreeBlockHeader) + FREE_LIST_FOOTER_SIZE;
+static constexpr size_t FREE_LIST_MAX_BLOCK_SIZE =
+    UINT32_MAX & ~FREE_LIST_FLAGS_MASK;
+
+/**
+ * Free blocks of all pools are indexed by two-level segregated fit. The first
+ * level splits sizes by powers of two, the second level splits every power of
+ * two into FREE_LIST_SL_COUNT equal ranges. Sizes below
+ * FREE_LIST_SMALL_BLOCK_SIZE share the first row, one bin per granularity
+ * step. Bitmaps of non-empty bins turn every lookup into two bit scans.
+ */
+static constexpr size_t FREE_LIST_SL_LOG2 = 4;
+static constexpr size_t FREE_LIST_SL_COUNT = 1 << FREE_LIST_SL_LOG2;
+static constexpr size_t FREE_LIST_FL_SHIFT = FREE_LIST_SL_LOG2 + 3;
+static constexpr size_t FREE_LIST_SMALL_BLOCK_SIZE = 1 << FREE_LIST_FL_SHIFT;
+static constexpr size_t FREE_LIST_FL_COUNT = 32 - FREE_LIST_FL_SHIFT + 1;
+
+static constexpr size_t FREE_LIST_INLINE_POOL_COUNT = 16;
+
+/**
+ * Requests of at least MAX(pool size, FREE_LIST_MIN_LARGE_SIZE) bytes bypass
+ * the pools: each gets its own mapping, which is returned to the system as
+ * soon as it is freed. This also serves requests too large for a block.
+ */
+static constexpr size_t FREE_LIST_MIN_LARGE_SIZE = 256 * 1024;
+
+typedef struct FreeListLargeBlock
+{
+    void* ptr; /**< Both the payload and the start of the mapping. */
+    size_t size;
+} FreeListLargeBlock;
+
+/**
+ * pools holds every pool sorted by address, so the owner of a pointer is found
+ * by binary search. It starts in inline_pools and moves to the heap once the
+ * free list outgrows them. large_blocks is the side table of mapped blocks,
+ * also sorted by address.
+ */
 struct FreeList
 {
-    FreeListMemoryPool* pool;
+    FreeListMemoryPool* pool; /**< First pool, allocated with the FreeList. */
+    FreeListMemoryPool** pools;
+    size_t pool_count;
+    size_t pool_capacity;
+    FreeListMemoryPool* inline_pools[FREE_LIST_INLINE_POOL_COUNT];
+    FreeListLargeBlock* large_blocks;
+    size_t large_count;
+    size_t large_capacity;
+    size_t large_threshold;
+    bool huge_pages; /**< Pools are backed by huge pages. */
+    bool locked;     /**< free_list_prefault locked the pools. */
+    uint32_t fl_bitmap;
+    uint32_t sl_bitmap[FREE_LIST_FL_COUNT];
+    FreeListFreeBlockHeader* blocks[FREE_LIST_FL_COUNT][FREE_LIST_SL_COUNT];
 };
 
+typedef struct FreeListBin
+{
+    size_t fl;
+    size_t sl;
+} FreeListBin;
+
 static constexpr size_t POOL_METADATA_SIZE = sizeof(FreeListMemoryPool);
 
-static FreeListMemoryPool* free_list_pool_ctor(size_t size, bool first_pool);
-static void free_list_pool_dtor(FreeListMemoryPool* pool);
-static void* free_list_pool_allocate(FreeListMemoryPool* pool,
-    size_t size,
-    size_t alignment);
+static void free_list_init(FreeList* free_list, size_t pool_size);
+static size_t free_list_huge_size(size_t meta_size, size_t pool_size);
+static size_t free_list_huge_pool_size(size_t meta_size, size_t huge_size);
+
+static FreeListMemoryPool* free_list_pool_ctor(FreeList* free_list,
+    size_t size);
+static FreeListMemoryPool*
+free_list_pool_ctor_fitting(FreeList* free_list, size_t required_size);
+static void free_list_pool_init(FreeList* free_list,
+    FreeListMemoryPool* pool,
+    size_t size);
+static void free_list_pool_dtor(FreeList* free_list, FreeListMemoryPool* pool);
 static bool free_list_pool_check_ptr(FreeListMemoryPool* pool, void* ptr);
-static bool free_list_pool_deallocate(FreeListMemoryPool* pool, void* ptr);
+static bool free_list_pool_deallocate(FreeList* free_list,
+    FreeListMemoryPool* pool,
+    void* ptr);
 static size_t free_list_pool_size(const FreeListMemoryPool* pool);
+static size_t free_list_pool_total_size(const FreeListMemoryPool* pool);
+static bool free_list_pool_index_insert(FreeList* free_list,
+    FreeListMemoryPool* pool);
+static FreeListMemoryPool* free_list_pool_index_find(const FreeList* free_list,
+    const void* ptr);
 static size_t free_list_required_block_size(size_t size, size_t alignment);
 
+static void*
+free_list_large_allocate(FreeList* free_list, size_t size, size_t alignment);
+static bool free_list_large_deallocate(FreeList* free_list, void* ptr);
+static size_t free_list_large_find(const FreeList* free_list, const void* ptr);
+
+static void* free_list_block_allocate(FreeList* free_list,
+    FreeListFreeBlockHeader* block,
+    size_t size,
+    size_t alignment);
+static bool
+free_list_block_resize(FreeList* free_list, void* ptr, size_t new_size);
+static size_t free_list_block_usable_size(void* ptr);
+static void free_list_block_deallocate(FreeList* free_list, void* ptr);
+
+static void free_list_push(FreeList* free_list,
+    FreeListFreeBlockHeader* block,
+    size_t size);
+static void free_list_unlink(FreeList* free_list,
+    FreeListFreeBlockHeader* block);
+static FreeListFreeBlockHeader* free_list_find(FreeList* free_list,
+    size_t size);
+
+static FreeListBin free_list_bin(size_t size);
+static size_t free_list_search_size(size_t size);
+static size_t log2_floor(size_t value);
+
+static size_t block_size(const FreeListBlockHeader* header);
+static FreeListBlockHeader* block_next(FreeListBlockHeader* header);
+
 FreeList* free_list_ctor(size_t pool_size)
 {
     if (pool_size == 0)
@@ -54,16 +175,51 @@ FreeList* free_list_ctor(size_t pool_size)
         return NULL;
     }
 
-    FreeListMemoryPool* pool = free_list_pool_ctor(pool_size, true);
+    pool_size = align_size(MAX(pool_size, FREE_LIST_MIN_BLOCK_SIZE),
+        FREE_LIST_BLOCK_GRANULARITY);
+    if (pool_size > FREE_LIST_MAX_BLOCK_SIZE)
+    {
+        return NULL;
+    }
+
+    FreeList* free_list = cmlib_details_malloc(sizeof(FreeList)
+        + POOL_METADATA_SIZE + pool_size + sizeof(FreeListBlockHeader));
 
-    if (!pool)
+    if (!free_list)
+    {
+        return NULL;
+    }
+
+    free_list_init(free_list, pool_size);
+
+    return free_list;
+}
+
+FreeList* free_list_ctor_huge(size_t pool_size)
+{
+    if (pool_size == 0)
     {
         return NULL;
     }
 
-    FreeList* free_list = (FreeList*)pool - 1;
+    pool_size = align_size(MAX(pool_size, FREE_LIST_MIN_BLOCK_SIZE),
+        FREE_LIST_BLOCK_GRANULARITY);
+    if (pool_size > FREE_LIST_MAX_BLOCK_SIZE)
+    {
+        return NULL;
+    }
 
-    free_list->pool = pool;
+    size_t huge_size = free_list_huge_size(sizeof(FreeList), pool_size);
+    FreeList* free_list = cmlib_details_huge_alloc(huge_size);
+
+    if (!free_list)
+    {
+        return NULL;
+    }
+
+    free_list_init(free_list,
+        free_list_huge_pool_size(sizeof(FreeList), huge_size));
+    free_list->huge_pages = true;
 
     return free_list;
 }
@@ -75,61 +231,176 @@ void free_list_dtor(FreeList* free_list)
         return;
     }
 
-    FreeListMemoryPool* cur_pool = free_list->pool->next_pool;
-    while (cur_pool)
+    for (size_t i = 0; i < free_list->pool_count; i++)
+    {
+        if (free_list->pools[i] != free_list->pool)
+        {
+            free_list_pool_dtor(free_list, free_list->pools[i]);
+        }
+    }
+
+    if (free_list->pools != free_list->inline_pools)
+    {
+        cmlib_details_free(free_list->pools);
+    }
+
+    for (size_t i = 0; i < free_list->large_count; i++)
     {
-        FreeListMemoryPool* next_pool = cur_pool->next_pool;
-        free_list_pool_dtor(cur_pool);
-        cur_pool = next_pool;
+        munmap(free_list->large_blocks[i].ptr, free_list->large_blocks[i].size);
     }
 
+    if (free_list->large_blocks)
+    {
+        cmlib_details_free(free_list->large_blocks);
+    }
+
+    if (free_list->huge_pages)
+    {
+        cmlib_details_huge_free(free_list,
+            free_list_huge_size(sizeof(FreeList),
+                free_list_pool_size(free_list->pool)));
+        return;
+    }
+
+    if (free_list->locked)
+    {
+        cmlib_details_unlock(free_list,
+            sizeof(FreeList) + free_list_pool_total_size(free_list->pool));
+    }
     cmlib_details_free(free_list);
 }
 
-void* free_list_allocate(FreeList* free_list, size_t size, size_t alignment)
+bool free_list_reserve(FreeList* free_list, size_t size)
 {
-    if (!free_list)
+    if (!free_list || size >= free_list->large_threshold)
     {
-        return NULL;
+        return false;
     }
 
-    FreeListMemoryPool* prev_pool = NULL;
-    FreeListMemoryPool* cur_pool = free_list->pool;
-    void* allocated = NULL;
+    size_t required_size =
+        free_list_required_block_size(size, FREE_LIST_BLOCK_GRANULARITY);
+    if (!required_size)
+    {
+        return false;
+    }
+
+    return free_list_find(free_list, required_size)
+        || free_list_pool_ctor_fitting(free_list, required_size);
+}
 
-    while (cur_pool && !allocated)
+bool free_list_prefault(FreeList* free_list, bool lock)
+{
+    if (!free_list)
     {
-        allocated = free_list_pool_allocate(cur_pool, size, alignment);
-        prev_pool = cur_pool;
-        cur_pool = cur_pool->next_pool;
+        return false;
     }
 
-    if (allocated)
+    bool ok = true;
+
+    for (size_t i = 0; i < free_list->pool_count; i++)
     {
-        return allocated;
+        FreeListMemoryPool* pool = free_list->pools[i];
+        ok &= cmlib_details_prefault(pool,
+            free_list_pool_total_size(pool),
+            lock);
     }
 
-    if (!free_list->pool)
+    free_list->locked |= lock;
+
+    return ok;
+}
+
+void* free_list_allocate(FreeList* free_list, size_t size, size_t alignment)
+{
+    if (!free_list)
     {
         return NULL;
     }
 
+    if (size >= free_list->large_threshold)
+    {
+        return free_list_large_allocate(free_list, size, alignment);
+    }
+
     size_t required_size = free_list_required_block_size(size, alignment);
     if (!required_size)
     {
         return NULL;
     }
 
-    size_t new_pool_size = MAX(required_size,
-        free_list_pool_size(free_list->pool));
-    FreeListMemoryPool* new_pool = free_list_pool_ctor(new_pool_size, false);
-    if (!new_pool)
+    FreeListFreeBlockHeader* block = free_list_find(free_list, required_size);
+
+    if (!block)
+    {
+        FreeListMemoryPool* new_pool =
+            free_list_pool_ctor_fitting(free_list, required_size);
+        if (!new_pool)
+        {
+            return NULL;
+        }
+
+        block = (FreeListFreeBlockHeader*)(new_pool + 1);
+    }
+
+    return free_list_block_allocate(free_list, block, size, alignment);
+}
+
+void* free_list_reallocate(FreeList* free_list,
+    void* ptr,
+    size_t new_size,
+    size_t alignment)
+{
+    if (!free_list || new_size == 0 || alignment == 0)
+    {
+        return NULL;
+    }
+
+    if (!ptr)
+    {
+        return free_list_allocate(free_list, new_size, alignment);
+    }
+
+    size_t old_size = 0;
+    FreeListMemoryPool* pool = free_list_pool_index_find(free_list, ptr);
+
+    if (free_list_pool_check_ptr(pool, ptr))
+    {
+        if (new_size < free_list->large_threshold
+            && free_list_block_resize(free_list, ptr, new_size))
+        {
+            return ptr;
+        }
+
+        old_size = free_list_block_usable_size(ptr);
+    }
+    else
+    {
+        size_t index = free_list_large_find(free_list, ptr);
+        if (index == free_list->large_count
+            || free_list->large_blocks[index].ptr != ptr)
+        {
+            return NULL;
+        }
+
+        // shrinking below the threshold moves into a pool, so the size
+        // passed to free_list_deallocate_sized still tells where a block is
+        old_size = free_list->large_blocks[index].size;
+        if (new_size <= old_size && new_size >= free_list->large_threshold)
+        {
+            return ptr;
+        }
+    }
+
+    void* new_ptr = free_list_allocate(free_list, new_size, alignment);
+    if (!new_ptr)
     {
         return NULL;
     }
 
-    prev_pool->next_pool = new_pool;
-    return free_list_pool_allocate(new_pool, size, alignment);
+    memcpy(new_ptr, ptr, MIN(old_size, new_size));
+    free_list_deallocate(free_list, ptr);
+
+    return new_ptr;
 }
 
 void free_list_deallocate(FreeList* free_list, void* ptr)
@@ -139,11 +410,30 @@ void free_list_deallocate(FreeList* free_list, void* ptr)
         return;
     }
 
-    FreeListMemoryPool* cur_pool = free_list->pool;
-    while (cur_pool && !free_list_pool_deallocate(cur_pool, ptr))
+    if (free_list->large_count && free_list_large_deallocate(free_list, ptr))
+    {
+        return;
+    }
+
+    free_list_pool_deallocate(free_list,
+        free_list_pool_index_find(free_list, ptr),
+        ptr);
+}
+
+void free_list_deallocate_sized(FreeList* free_list, void* ptr, size_t size)
+{
+    if (!free_list || !ptr)
+    {
+        return;
+    }
+
+    if (size >= free_list->large_threshold)
     {
-        cur_pool = cur_pool->next_pool;
+        free_list_large_deallocate(free_list, ptr);
+        return;
     }
+
+    free_list_block_deallocate(free_list, ptr);
 }
 
 void free_list_dump_dot(const FreeList* free_list, FILE* out)
@@ -166,10 +456,10 @@ void free_list_dump_dot(const FreeList* free_list, FILE* out)
         return;
     }
 
-    size_t pool_index = 0;
-    for (const FreeListMemoryPool* pool = free_list->pool; pool;
-        pool = pool->next_pool, pool_index++)
+    for (size_t pool_index = 0; pool_index < free_list->pool_count;
+        pool_index++)
     {
+        const FreeListMemoryPool* pool = free_list->pools[pool_index];
         fprintf(out,
             "    pool_%zu [label=\"pool %zu|addr=%p|size=%zu|end=%p\"];\n",
             pool_index,
@@ -181,50 +471,77 @@ void free_list_dump_dot(const FreeList* free_list, FILE* out)
         if (pool_index == 0)
         {
             fprintf(out,
-                "    free_list -> pool_%zu [label=\"pool\"];\n",
+                "    free_list -> pool_%zu [label=\"pools\"];\n",
                 pool_index);
         }
 
-        if (pool->next_pool)
+        if (pool_index + 1 < free_list->pool_count)
         {
             fprintf(out,
                 "    pool_%zu -> pool_%zu [label=\"next_pool\"];\n",
                 pool_index,
                 pool_index + 1);
         }
+    }
 
-        size_t block_index = 0;
-        for (const FreeListFreeBlockHeader* block = pool->free_block; block;
-            block = block->next, block_index++)
+    for (size_t fl = 0; fl < FREE_LIST_FL_COUNT; fl++)
+    {
+        for (size_t sl = 0; sl < FREE_LIST_SL_COUNT; sl++)
         {
-            fprintf(out,
-                "    pool_%zu_free_block_%zu "
-                "[label=\"free_block %zu|addr=%p|size=%zu\"];\n",
-                pool_index,
-                block_index,
-                block_index,
-                (void*)block,
-                block->size);
-
-            if (block_index == 0)
+            const FreeListFreeBlockHeader* block = free_list->blocks[fl][sl];
+            if (!block)
             {
-                fprintf(out,
-                    "    pool_%zu -> pool_%zu_free_block_%zu "
-                    "[label=\"next_block\"];\n",
-                    pool_index,
-                    pool_index,
-                    block_index);
+                continue;
             }
 
-            if (block->next)
+            fprintf(out,
+                "    bin_%zu_%zu [label=\"bin %zu.%zu\"];\n",
+                fl,
+                sl,
+                fl,
+                sl);
+            fprintf(out,
+                "    free_list -> bin_%zu_%zu [label=\"bin\"];\n",
+                fl,
+                sl);
+
+            size_t block_index = 0;
+            for (; block; block = block->next, block_index++)
             {
                 fprintf(out,
-                    "    pool_%zu_free_block_%zu -> "
-                    "pool_%zu_free_block_%zu [label=\"next\"];\n",
-                    pool_index,
+                    "    bin_%zu_%zu_free_block_%zu "
+                    "[label=\"free_block %zu|addr=%p|size=%zu\"];\n",
+                    fl,
+                    sl,
+                    block_index,
                     block_index,
-                    pool_index,
-                    block_index + 1);
+                    (void*)block,
+                    block_size(&block->header));
+
+                if (block_index == 0)
+                {
+                    fprintf(out,
+                        "    bin_%zu_%zu -> bin_%zu_%zu_free_block_%zu "
+                        "[label=\"next_block\"];\n",
+                        fl,
+                        sl,
+                        fl,
+                        sl,
+                        block_index);
+                }
+
+                if (block->next)
+                {
+                    fprintf(out,
+                        "    bin_%zu_%zu_free_block_%zu -> "
+                        "bin_%zu_%zu_free_block_%zu [label=\"next\"];\n",
+                        fl,
+                        sl,
+                        block_index,
+                        fl,
+                        sl,
+                        block_index + 1);
+                }
             }
         }
     }
@@ -232,223 +549,705 @@ void free_list_dump_dot(const FreeList* free_list, FILE* out)
     fprintf(out, "}\n");
 }
 
-static FreeListMemoryPool* free_list_pool_ctor(size_t size, bool first_pool)
+/**
+ * Initializes a free-list followed by its first pool of pool_size bytes.
+ */
+static void free_list_init(FreeList* free_list, size_t pool_size)
 {
-    ERROR_CHECKING();
+    *free_list = (FreeList) {
+        .pool = (FreeListMemoryPool*)(free_list + 1),
+        .pools = free_list->inline_pools,
+        .pool_count = 1,
+        .pool_capacity = FREE_LIST_INLINE_POOL_COUNT,
+        .large_threshold = MAX(pool_size, FREE_LIST_MIN_LARGE_SIZE),
+    };
+    free_list->inline_pools[0] = free_list->pool;
+
+    free_list_pool_init(free_list, free_list->pool, pool_size);
+}
+
+/**
+ * Size of the huge page mapping holding meta_size bytes followed by a pool of
+ * pool_size bytes.
+ */
+static size_t free_list_huge_size(size_t meta_size, size_t pool_size)
+{
+    return align_size(meta_size + POOL_METADATA_SIZE + pool_size
+            + sizeof(FreeListBlockHeader),
+        CMLIB_HUGE_PAGE_SIZE);
+}
+
+/**
+ * Size of the largest pool that fits into a huge page mapping of huge_size
+ * bytes after meta_size bytes. Mapping it again with free_list_huge_size
+ * gives back huge_size.
+ */
+static size_t free_list_huge_pool_size(size_t meta_size, size_t huge_size)
+{
+    return MIN(huge_size - meta_size - POOL_METADATA_SIZE
+            - sizeof(FreeListBlockHeader),
+        FREE_LIST_MAX_BLOCK_SIZE);
+}
 
-    size = MAX(size, sizeof(FreeListFreeBlockHeader));
+/**
+ * Allocates a pool holding a single free block of size bytes and adds it to
+ * the pool index. A huge page pool grows to fill its mapping.
+ */
+static FreeListMemoryPool* free_list_pool_ctor(FreeList* free_list,
+    size_t size)
+{
+    ERROR_CHECKING();
 
-    size_t alloc_size = POOL_METADATA_SIZE + sizeof(FreeListOccupiedBlockHeader)
-        + size;
-    if (first_pool)
+    size = align_size(MAX(size, FREE_LIST_MIN_BLOCK_SIZE),
+        FREE_LIST_BLOCK_GRANULARITY);
+    if (size > FREE_LIST_MAX_BLOCK_SIZE)
     {
-        size += sizeof(FreeList);
+        return NULL;
     }
 
-    auto pool = (FreeListMemoryPool*)cmlib_details_malloc(alloc_size);
+    FreeListMemoryPool* pool = NULL;
+    if (free_list->huge_pages)
+    {
+        size_t huge_size = free_list_huge_size(0, size);
+        pool = cmlib_details_huge_alloc(huge_size);
+        size = free_list_huge_pool_size(0, huge_size);
+    }
+    else
+    {
+        pool = cmlib_details_malloc(
+            POOL_METADATA_SIZE + size + sizeof(FreeListBlockHeader));
+    }
 
     if (!pool)
     {
         return NULL;
     }
 
-    if (first_pool)
+    // free_list_pool_dtor needs the size if the index insert fails
+    pool->pool_end = (char*)(pool + 1) + size;
+
+    if (!free_list_pool_index_insert(free_list, pool))
     {
-        pool = (FreeListMemoryPool*)((FreeList*)pool + 1);
+        free_list_pool_dtor(free_list, pool);
+        return NULL;
     }
 
-    FreeListFreeBlockHeader* block = (FreeListFreeBlockHeader*)(pool + 1);
+    free_list_pool_init(free_list, pool, size);
 
-    *block = (FreeListFreeBlockHeader) {
-        .size = size,
-        .next = NULL,
-    };
+    return pool;
+}
+
+/**
+ * Adds a pool whose free block holds a block of required_size bytes. It is
+ * sized so that later searches for the same size find it.
+ */
+static FreeListMemoryPool*
+free_list_pool_ctor_fitting(FreeList* free_list, size_t required_size)
+{
+    size_t search_size =
+        MIN(free_list_search_size(required_size), FREE_LIST_MAX_BLOCK_SIZE);
+
+    return free_list_pool_ctor(free_list,
+        MAX(search_size, free_list_pool_size(free_list->pool)));
+}
+
+static void free_list_pool_init(FreeList* free_list,
+    FreeListMemoryPool* pool,
+    size_t size)
+{
+    auto block = (FreeListFreeBlockHeader*)(pool + 1);
+    auto sentinel = (FreeListBlockHeader*)((char*)block + size);
 
     *pool = (FreeListMemoryPool) {
-        .next_pool = NULL,
-        .free_block = block,
-        .pool_end = (char*)block + size,
+        .pool_end = sentinel,
     };
 
-    return pool;
+    *sentinel = (FreeListBlockHeader) {};
+    free_list_push(free_list, block, size);
 }
 
-static void free_list_pool_dtor(FreeListMemoryPool* pool)
+static void free_list_pool_dtor(FreeList* free_list, FreeListMemoryPool* pool)
 {
+    if (free_list->huge_pages)
+    {
+        cmlib_details_huge_free(pool,
+            free_list_huge_size(0, free_list_pool_size(pool)));
+        return;
+    }
+
+    if (free_list->locked)
+    {
+        cmlib_details_unlock(pool, free_list_pool_total_size(pool));
+    }
     cmlib_details_free(pool);
 }
 
-static void*
-free_list_pool_allocate(FreeListMemoryPool* pool, size_t size, size_t alignment)
+static bool free_list_pool_check_ptr(FreeListMemoryPool* pool, void* ptr)
 {
     if (!pool)
     {
-        return NULL;
+        return false;
     }
 
-    if (size == 0 || size > UINT32_MAX)
+    if (!ptr)
     {
-        return NULL;
+        return false;
+    }
+
+    void* pool_start = pool + 1;
+
+    // TODO: range/alignment checks still accept interior pointers that were
+    // never returned by free_list_allocate.
+    return pool_start <= ptr && ptr < pool->pool_end;
+}
+
+static bool free_list_pool_deallocate(FreeList* free_list,
+    FreeListMemoryPool* pool,
+    void* ptr)
+{
+    if (!pool)
+    {
+        return false;
+    }
+
+    if (!free_list_pool_check_ptr(pool, ptr))
+    {
+        return false;
     }
 
-    alignment = MAX(alignment, alignof(FreeListOccupiedBlockHeader));
+    free_list_block_deallocate(free_list, ptr);
 
-    FreeListFreeBlockHeader* prev_block = NULL;
-    FreeListFreeBlockHeader* cur_block = pool->free_block;
+    return true;
+}
 
-    FreeListOccupiedBlockHeader* occupied_block = NULL;
-    size_t occupied_size = 0;
-    size_t occupied_padding = 0;
+static size_t free_list_pool_size(const FreeListMemoryPool* pool)
+{
+    assert(pool);
 
-    FreeListFreeBlockHeader* split_block = NULL;
-    size_t split_size = 0;
+    ptrdiff_t size = pool->pool_end - (void*)(pool + 1);
 
-    while (cur_block)
+    return size;
+}
+
+/**
+ * Size of the pool including its metadata and sentinel.
+ */
+static size_t free_list_pool_total_size(const FreeListMemoryPool* pool)
+{
+    return POOL_METADATA_SIZE + free_list_pool_size(pool)
+        + sizeof(FreeListBlockHeader);
+}
+
+/**
+ * Inserts pool into the address-ordered pool index, moving the index to a
+ * twice larger array when it is full.
+ */
+static bool free_list_pool_index_insert(FreeList* free_list,
+    FreeListMemoryPool* pool)
+{
+    if (free_list->pool_count == free_list->pool_capacity)
     {
-        char* block_start = (char*)cur_block;
-        char* block_end = block_start + cur_block->size;
-        char* payload =
-            align_ptr(block_start + sizeof(FreeListOccupiedBlockHeader),
-                alignment);
-        occupied_block =
-            (FreeListOccupiedBlockHeader*)(payload - sizeof(*occupied_block));
-        occupied_padding = (size_t)((char*)occupied_block - block_start);
+        size_t new_capacity = free_list->pool_capacity * 2;
+        FreeListMemoryPool** new_pools =
+            cmlib_details_malloc(new_capacity * sizeof(*new_pools));
+        if (!new_pools)
+        {
+            return false;
+        }
+
+        memcpy(new_pools,
+            free_list->pools,
+            free_list->pool_count * sizeof(*new_pools));
 
-        if (payload <= block_end && payload + size <= block_end)
+        if (free_list->pools != free_list->inline_pools)
         {
-            char* split = align_ptr(payload + size,
-                alignof(FreeListFreeBlockHeader));
+            cmlib_details_free(free_list->pools);
+        }
 
-            if (split + sizeof(FreeListFreeBlockHeader) < block_end)
-            {
-                occupied_size = split - block_start;
-                split_size = block_end - split;
-                split_block = (FreeListFreeBlockHeader*)split;
-            }
-            else
-            {
-                occupied_size = cur_block->size;
-            }
-            break;
+        free_list->pools = new_pools;
+        free_list->pool_capacity = new_capacity;
+    }
+
+    size_t left = 0;
+    size_t right = free_list->pool_count;
+    while (left < right)
+    {
+        size_t middle = left + (right - left) / 2;
+        if ((uintptr_t)free_list->pools[middle] < (uintptr_t)pool)
+        {
+            left = middle + 1;
         }
+        else
+        {
+            right = middle;
+        }
+    }
+
+    memmove(free_list->pools + left + 1,
+        free_list->pools + left,
+        (free_list->pool_count - left) * sizeof(*free_list->pools));
+    free_list->pools[left] = pool;
+    free_list->pool_count++;
+
+    return true;
+}
 
-        prev_block = cur_block;
-        cur_block = cur_block->next;
+/**
+ * Returns the pool with the highest address not above ptr, the only pool
+ * that can own it, or NULL.
+ */
+static FreeListMemoryPool* free_list_pool_index_find(const FreeList* free_list,
+    const void* ptr)
+{
+    size_t left = 0;
+    size_t right = free_list->pool_count;
+    while (left < right)
+    {
+        size_t middle = left + (right - left) / 2;
+        if ((uintptr_t)free_list->pools[middle] <= (uintptr_t)ptr)
+        {
+            left = middle + 1;
+        }
+        else
+        {
+            right = middle;
+        }
     }
 
-    if (!cur_block)
+    return left ? free_list->pools[left - 1] : NULL;
+}
+
+/**
+ * Maps a block of size bytes for a large request. The mapping is trimmed so
+ * that it starts right at the aligned payload.
+ */
+static void*
+free_list_large_allocate(FreeList* free_list, size_t size, size_t alignment)
+{
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0)
     {
         return NULL;
     }
 
-    FreeListFreeBlockHeader** prev_block_next = NULL;
-    if (prev_block)
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    alignment = MAX(alignment, page_size);
+
+    size_t map_size = align_size(size, page_size);
+    size_t slack = alignment - page_size;
+    if (map_size < size || map_size + slack < map_size)
     {
-        prev_block_next = &prev_block->next;
+        return NULL;
     }
-    else
+
+    if (free_list->large_count == free_list->large_capacity)
+    {
+        size_t new_capacity = MAX(free_list->large_capacity * 2, 8ul);
+        FreeListLargeBlock* new_blocks =
+            cmlib_details_malloc(new_capacity * sizeof(*new_blocks));
+        if (!new_blocks)
+        {
+            return NULL;
+        }
+
+        if (free_list->large_blocks)
+        {
+            memcpy(new_blocks,
+                free_list->large_blocks,
+                free_list->large_count * sizeof(*new_blocks));
+            cmlib_details_free(free_list->large_blocks);
+        }
+
+        free_list->large_blocks = new_blocks;
+        free_list->large_capacity = new_capacity;
+    }
+
+    char* map = mmap(NULL,
+        map_size + slack,
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS,
+        -1,
+        0);
+    if (map == MAP_FAILED)
     {
-        prev_block_next = &pool->free_block;
+        return NULL;
     }
 
-    if (split_block)
+    char* payload = align_ptr(map, alignment);
+    size_t head = (size_t)(payload - map);
+    if (head)
     {
-        *split_block = (FreeListFreeBlockHeader) {
-            .next = cur_block->next,
-            .size = split_size,
-        };
-        *prev_block_next = split_block;
+        munmap(map, head);
     }
-    else
+    if (slack - head)
     {
-        *prev_block_next = cur_block->next;
+        munmap(payload + map_size, slack - head);
     }
 
-    occupied_block->size = (uint32_t)occupied_size;
-    occupied_block->padding = (uint32_t)occupied_padding;
-
-    void* allocated = occupied_block + 1;
+    size_t index = free_list_large_find(free_list, payload);
+    memmove(free_list->large_blocks + index + 1,
+        free_list->large_blocks + index,
+        (free_list->large_count - index) * sizeof(*free_list->large_blocks));
+    free_list->large_blocks[index] = (FreeListLargeBlock) {
+        .ptr = payload,
+        .size = map_size,
+    };
+    free_list->large_count++;
 
-    return allocated;
+    return payload;
 }
 
-static bool free_list_pool_check_ptr(FreeListMemoryPool* pool, void* ptr)
+/**
+ * Unmaps the large block of ptr. Returns false if ptr is not a large block.
+ */
+static bool free_list_large_deallocate(FreeList* free_list, void* ptr)
 {
-    if (!pool)
+    size_t index = free_list_large_find(free_list, ptr);
+    if (index == free_list->large_count
+        || free_list->large_blocks[index].ptr != ptr)
     {
         return false;
     }
 
-    if (!ptr)
+    munmap(ptr, free_list->large_blocks[index].size);
+
+    memmove(free_list->large_blocks + index,
+        free_list->large_blocks + index + 1,
+        (free_list->large_count - index - 1)
+            * sizeof(*free_list->large_blocks));
+    free_list->large_count--;
+
+    return true;
+}
+
+/**
+ * Returns the index of the first large block not below ptr.
+ */
+static size_t free_list_large_find(const FreeList* free_list, const void* ptr)
+{
+    size_t left = 0;
+    size_t right = free_list->large_count;
+    while (left < right)
     {
-        return false;
+        size_t middle = left + (right - left) / 2;
+        if ((uintptr_t)free_list->large_blocks[middle].ptr < (uintptr_t)ptr)
+        {
+            left = middle + 1;
+        }
+        else
+        {
+            right = middle;
+        }
     }
 
-    void* pool_start = pool + 1;
+    return left;
+}
 
-    // TODO: range/alignment checks still accept interior pointers that were
-    // never returned by free_list_pool_allocate.
-    // add bit to block sizes that tells it was really allocated
-    return pool_start <= ptr && ptr < pool->pool_end;
+static size_t free_list_required_block_size(size_t size, size_t alignment)
+{
+    if (alignment == 0 || size == 0)
+    {
+        return 0;
+    }
+
+    alignment = MAX(alignment, alignof(FreeListBlockHeader));
+
+    if (size > FREE_LIST_MAX_BLOCK_SIZE)
+    {
+        return 0;
+    }
+
+    size_t required_size = sizeof(FreeListBlockHeader) + size + alignment
+        - alignof(FreeListBlockHeader);
+    required_size = align_size(MAX(required_size, FREE_LIST_MIN_BLOCK_SIZE),
+        FREE_LIST_BLOCK_GRANULARITY);
+
+    if (required_size > FREE_LIST_MAX_BLOCK_SIZE)
+    {
+        return 0;
+    }
+
+    return required_size;
 }
-static bool free_list_pool_deallocate(FreeListMemoryPool* pool, void* ptr)
+
+/**
+ * Takes a free block that fits size bytes at alignment off the index, places
+ * the payload in it and gives the tail back to the index if it can hold a
+ * block.
+ */
+static void* free_list_block_allocate(FreeList* free_list,
+    FreeListFreeBlockHeader* block,
+    size_t size,
+    size_t alignment)
 {
-    if (!pool)
+    alignment = MAX(alignment, alignof(FreeListBlockHeader));
+
+    free_list_unlink(free_list, block);
+
+    char* payload = align_ptr((char*)block + sizeof(FreeListBlockHeader),
+        alignment);
+    size_t cur_size = block_size(&block->header);
+    size_t occupied_size = (size_t)(payload - (char*)block) + size;
+
+    assert(occupied_size <= cur_size);
+
+    occupied_size = align_size(MAX(occupied_size, FREE_LIST_MIN_BLOCK_SIZE),
+        FREE_LIST_BLOCK_GRANULARITY);
+
+    if (cur_size - occupied_size >= FREE_LIST_MIN_BLOCK_SIZE)
+    {
+        free_list_push(free_list,
+            (FreeListFreeBlockHeader*)((char*)block + occupied_size),
+            cur_size - occupied_size);
+    }
+    else
+    {
+        occupied_size = cur_size;
+        block_next(&block->header)->size &= ~FREE_LIST_PREV_FREE;
+    }
+
+    uint32_t offset = (uint32_t)(payload - (char*)block);
+
+    // neighbours of a free block are never free, so neither flag is set
+    block->header = (FreeListBlockHeader) {
+        .size = (uint32_t)occupied_size,
+        .offset = offset,
+    };
+    ((uint32_t*)payload)[-1] = offset;
+
+    return payload;
+}
+
+/**
+ * Grows the occupied block of ptr in place to fit new_size bytes, taking space
+ * from the next block if it is free.
+ */
+static bool
+free_list_block_resize(FreeList* free_list, void* ptr, size_t new_size)
+{
+    auto header = (FreeListBlockHeader*)((char*)ptr - ((uint32_t*)ptr)[-1]);
+    size_t offset = (size_t)((char*)ptr - (char*)header);
+    size_t cur_size = block_size(header);
+
+    if (new_size <= cur_size - offset)
+    {
+        return true;
+    }
+
+    if (new_size > FREE_LIST_MAX_BLOCK_SIZE - offset)
     {
         return false;
     }
 
-    if (!free_list_pool_check_ptr(pool, ptr))
+    size_t needed = align_size(offset + new_size, FREE_LIST_BLOCK_GRANULARITY);
+    FreeListBlockHeader* next = block_next(header);
+    if (!(next->size & FREE_LIST_BLOCK_FREE)
+        || cur_size + block_size(next) < needed)
     {
         return false;
     }
 
-    FreeListOccupiedBlockHeader* header = (FreeListOccupiedBlockHeader*)ptr - 1;
-    FreeListFreeBlockHeader* block =
-        (FreeListFreeBlockHeader*)((char*)header - header->padding);
-    block->size = header->size;
-    block->next = pool->free_block;
+    size_t total_size = cur_size + block_size(next);
+    free_list_unlink(free_list, (FreeListFreeBlockHeader*)next);
+
+    if (total_size - needed >= FREE_LIST_MIN_BLOCK_SIZE)
+    {
+        free_list_push(free_list,
+            (FreeListFreeBlockHeader*)((char*)header + needed),
+            total_size - needed);
+    }
+    else
+    {
+        needed = total_size;
+        ((FreeListBlockHeader*)((char*)header + total_size))->size &=
+            ~FREE_LIST_PREV_FREE;
+    }
 
-    pool->free_block = block;
+    header->size = (uint32_t)needed | (header->size & FREE_LIST_PREV_FREE);
 
     return true;
 }
 
-static size_t free_list_pool_size(const FreeListMemoryPool* pool)
+/**
+ * Frees the pool block of ptr and merges it with free neighbours, so adjacent
+ * free blocks never exist.
+ */
+static void free_list_block_deallocate(FreeList* free_list, void* ptr)
 {
-    assert(pool);
+    auto header =
+        (FreeListBlockHeader*)((char*)ptr - ((uint32_t*)ptr)[-1]);
 
-    ptrdiff_t size = pool->pool_end - (void*)(pool + 1);
+    if (header->size & FREE_LIST_BLOCK_FREE)
+    {
+        return;
+    }
 
-    return size;
+    size_t size = block_size(header);
+
+    FreeListBlockHeader* next = block_next(header);
+    if (next->size & FREE_LIST_BLOCK_FREE)
+    {
+        free_list_unlink(free_list, (FreeListFreeBlockHeader*)next);
+        size += block_size(next);
+    }
+
+    if (header->size & FREE_LIST_PREV_FREE)
+    {
+        uint32_t prev_size =
+            *(uint32_t*)((char*)header - FREE_LIST_FOOTER_SIZE);
+        header = (FreeListBlockHeader*)((char*)header - prev_size);
+
+        free_list_unlink(free_list, (FreeListFreeBlockHeader*)header);
+        size += prev_size;
+    }
+
+    free_list_push(free_list, (FreeListFreeBlockHeader*)header, size);
 }
 
-static size_t free_list_required_block_size(size_t size, size_t alignment)
+/**
+ * Bytes from ptr to the end of its occupied block.
+ */
+static size_t free_list_block_usable_size(void* ptr)
 {
-    if (alignment == 0 || size == 0)
+    uint32_t offset = ((uint32_t*)ptr)[-1];
+    auto header = (FreeListBlockHeader*)((char*)ptr - offset);
+
+    return block_size(header) - offset;
+}
+
+/**
+ * Marks the size bytes at block as a free block and puts it into its bin.
+ * The block after it learns that its predecessor is free.
+ */
+static void free_list_push(FreeList* free_list,
+    FreeListFreeBlockHeader* block,
+    size_t size)
+{
+    block->header = (FreeListBlockHeader) {
+        .size = (uint32_t)size | FREE_LIST_BLOCK_FREE,
+    };
+    *(uint32_t*)((char*)block + size - FREE_LIST_FOOTER_SIZE) = (uint32_t)size;
+    block_next(&block->header)->size |= FREE_LIST_PREV_FREE;
+
+    FreeListBin bin = free_list_bin(size);
+    FreeListFreeBlockHeader** head = &free_list->blocks[bin.fl][bin.sl];
+
+    block->prev = NULL;
+    block->next = *head;
+    if (block->next)
     {
-        return 0;
+        block->next->prev = block;
     }
+    *head = block;
 
-    alignment = MAX(alignment, alignof(FreeListOccupiedBlockHeader));
+    free_list->fl_bitmap |= 1u << bin.fl;
+    free_list->sl_bitmap[bin.fl] |= 1u << bin.sl;
+}
 
-    if (size > SIZE_MAX - sizeof(FreeListOccupiedBlockHeader))
+static void free_list_unlink(FreeList* free_list,
+    FreeListFreeBlockHeader* block)
+{
+    if (block->next)
     {
-        return 0;
+        block->next->prev = block->prev;
     }
 
-    size_t required_size = sizeof(FreeListOccupiedBlockHeader) + size;
-    if (required_size > SIZE_MAX - (alignment - 1))
+    if (block->prev)
     {
-        return 0;
+        block->prev->next = block->next;
+        return;
     }
 
-    required_size += alignment - 1;
+    FreeListBin bin = free_list_bin(block_size(&block->header));
+    free_list->blocks[bin.fl][bin.sl] = block->next;
 
-    if (required_size > (size_t)UINT32_MAX)
+    if (!block->next)
     {
-        return 0;
+        free_list->sl_bitmap[bin.fl] &= ~(1u << bin.sl);
+        if (!free_list->sl_bitmap[bin.fl])
+        {
+            free_list->fl_bitmap &= ~(1u << bin.fl);
+        }
     }
+}
 
-    return required_size;
+/**
+ * Returns the head of the first non-empty bin whose blocks all hold at least
+ * size bytes, or NULL.
+ */
+static FreeListFreeBlockHeader* free_list_find(FreeList* free_list,
+    size_t size)
+{
+    size = free_list_search_size(size);
+    if (size > FREE_LIST_MAX_BLOCK_SIZE)
+    {
+        return NULL;
+    }
+
+    FreeListBin bin = free_list_bin(size);
+
+    uint32_t sl_map = free_list->sl_bitmap[bin.fl] & (~0u << bin.sl);
+    if (!sl_map)
+    {
+        uint32_t fl_map = free_list->fl_bitmap & (~0u << (bin.fl + 1));
+        if (!fl_map)
+        {
+            return NULL;
+        }
+
+        bin.fl = (size_t)__builtin_ctz(fl_map);
+        sl_map = free_list->sl_bitmap[bin.fl];
+    }
+
+    bin.sl = (size_t)__builtin_ctz(sl_map);
+
+    return free_list->blocks[bin.fl][bin.sl];
+}
+
+static FreeListBin free_list_bin(size_t size)
+{
+    if (size < FREE_LIST_SMALL_BLOCK_SIZE)
+    {
+        return (FreeListBin) {
+            .fl = 0,
+            .sl = size / FREE_LIST_BLOCK_GRANULARITY,
+        };
+    }
+
+    size_t fl = log2_floor(size);
+
+    return (FreeListBin) {
+        .fl = fl - FREE_LIST_FL_SHIFT + 1,
+        .sl = (size >> (fl - FREE_LIST_SL_LOG2)) ^ FREE_LIST_SL_COUNT,
+    };
+}
+
+/**
+ * Rounds size up to the next bin boundary, so any block of its bin is large
+ * enough.
+ */
+static size_t free_list_search_size(size_t size)
+{
+    if (size < FREE_LIST_SMALL_BLOCK_SIZE)
+    {
+        return size;
+    }
+
+    size_t round = ((size_t)1 << (log2_floor(size) - FREE_LIST_SL_LOG2)) - 1;
+
+    return (size + round) & ~round;
+}
+
+static size_t log2_floor(size_t value)
+{
+    return sizeof(size_t) * 8 - 1 - (size_t)__builtin_clzl(value);
+}
+
+static size_t block_size(const FreeListBlockHeader* header)
+{
+    return header->size & ~FREE_LIST_FLAGS_MASK;
+}
+
+static FreeListBlockHeader* block_next(FreeListBlockHeader* header)
+{
+    return (FreeListBlockHeader*)((char*)header + block_size(header));
 }
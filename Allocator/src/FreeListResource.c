@@ -5,6 +5,15 @@ DECLARE_RESULT_SOURCE(FreeListResource);
 static void*
 free_list_resource_allocate(void* resource, size_t size, size_t alignment);
 static void free_list_resource_deallocate(void* resource, void* ptr);
+static void* free_list_resource_reallocate(void* resource,
+    void* ptr,
+    size_t old_size,
+    size_t new_size,
+    size_t alignment);
+static void free_list_resource_deallocate_sized(void* resource,
+    void* ptr,
+    size_t size,
+    size_t alignment);
 
 Result_FreeListResource free_list_resource_ctor(size_t pool_size)
 {
@@ -19,6 +28,19 @@ Result_FreeListResource free_list_resource_ctor(size_t pool_size)
         EVERYTHING_FINE);
 }
 
+Result_FreeListResource free_list_resource_ctor_huge(size_t pool_size)
+{
+    FreeList* free_list = free_list_ctor_huge(pool_size);
+    if (!free_list)
+    {
+        return Result_FreeListResource_ctor((FreeListResource) {},
+            ERROR_NULLPTR);
+    }
+
+    return Result_FreeListResource_ctor(free_list_to_resource(free_list),
+        EVERYTHING_FINE);
+}
+
 FreeListResource free_list_to_resource(FreeList* free_list)
 {
     if (!free_list)
@@ -31,6 +53,8 @@ FreeListResource free_list_to_resource(FreeList* free_list)
             (MemoryResource) {
                 .allocate = free_list_resource_allocate,
                 .deallocate = free_list_resource_deallocate,
+                .reallocate = free_list_resource_reallocate,
+                .deallocate_sized = free_list_resource_deallocate_sized,
             },
         .free_list = free_list,
     };
@@ -60,3 +84,29 @@ static void free_list_resource_deallocate(void* resource, void* ptr)
     FreeListResource* free_list_resource = (FreeListResource*)resource;
     free_list_deallocate(free_list_resource->free_list, ptr);
 }
+
+static void* free_list_resource_reallocate(void* resource,
+    void* ptr,
+    size_t old_size,
+    size_t new_size,
+    size_t alignment)
+{
+    (void)old_size;
+    assert(resource);
+    FreeListResource* free_list_resource = (FreeListResource*)resource;
+    return free_list_reallocate(free_list_resource->free_list,
+        ptr,
+        new_size,
+        alignment);
+}
+
+static void free_list_resource_deallocate_sized(void* resource,
+    void* ptr,
+    size_t size,
+    size_t alignment)
+{
+    (void)alignment;
+    assert(resource);
+    FreeListResource* free_list_resource = (FreeListResource*)resource;
+    free_list_deallocate_sized(free_list_resource->free_list, ptr, size);
+}
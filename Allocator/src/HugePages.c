@@ -0,0 +1,67 @@
+#include "details/HugePages.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "Allocator.h"
+
+void* cmlib_details_huge_alloc(size_t size)
+{
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_2MB)
+    // fails right away unless enough huge pages are reserved
+    void* huge = mmap(NULL,
+        size,
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB,
+        -1,
+        0);
+    if (huge != MAP_FAILED)
+    {
+        return huge;
+    }
+#endif
+
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    size_t slack = CMLIB_HUGE_PAGE_SIZE - page_size;
+    if (size + slack < size)
+    {
+        return NULL;
+    }
+
+    char* map = mmap(NULL,
+        size + slack,
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS,
+        -1,
+        0);
+    if (map == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    char* ptr = align_ptr(map, CMLIB_HUGE_PAGE_SIZE);
+    size_t head = (size_t)(ptr - map);
+    if (head)
+    {
+        munmap(map, head);
+    }
+    if (slack - head)
+    {
+        munmap(ptr + size, slack - head);
+    }
+
+#ifdef MADV_HUGEPAGE
+    // fails harmlessly where transparent huge pages are disabled
+    madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+
+    return ptr;
+}
+
+void cmlib_details_huge_free(void* ptr, size_t size)
+{
+    if (ptr)
+    {
+        munmap(ptr, size);
+    }
+}
@@ -0,0 +1,219 @@
+#include "LockFreePool.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "Allocator.h"
+#include "details/CountingMalloc.h"
+#include "details/PoolFreeBlock.h"
+
+/**
+ * Head of the free stack. The tag changes on every successful update, so a
+ * pop that read a stale head fails even if the same block is on top again.
+ * Both halves are read with separate 8 byte loads: a torn read only makes the
+ * following 16 byte compare-and-swap fail.
+ */
+typedef struct LockFreeHead
+{
+    alignas(2 * sizeof(void*)) PoolFreeBlock* block;
+    uintptr_t tag;
+} LockFreeHead;
+
+typedef struct LockFreeChunk LockFreeChunk;
+struct LockFreeChunk
+{
+    LockFreeChunk* next;
+};
+
+struct LockFreePool
+{
+    LockFreeHead head;
+    _Atomic(LockFreeChunk*) chunks; /**< Chunks are only ever pushed. */
+    size_t elem_size;
+    size_t alignment;
+    size_t count;
+};
+
+static LockFreeHead lock_free_head_load(LockFreeHead* head);
+static bool lock_free_head_exchange(LockFreeHead* head,
+    LockFreeHead* expected,
+    LockFreeHead desired);
+
+static bool lock_free_pool_grow(LockFreePool* pool);
+static void lock_free_pool_push(LockFreePool* pool,
+    PoolFreeBlock* first,
+    PoolFreeBlock* last);
+
+LockFreePool*
+lock_free_pool_ctor(size_t elem_size, size_t alignment, size_t count)
+{
+    if (elem_size == 0 || count == 0 || alignment == 0
+        || (alignment & (alignment - 1)) != 0)
+    {
+        return NULL;
+    }
+
+    LockFreePool* pool = cmlib_details_aligned_alloc(alignof(LockFreePool),
+        sizeof(LockFreePool));
+    if (!pool)
+    {
+        return NULL;
+    }
+
+    alignment = MAX(alignment, alignof(PoolFreeBlock));
+
+    pool->elem_size = align_size(MAX(elem_size, sizeof(PoolFreeBlock)),
+        alignment);
+    pool->alignment = alignment;
+    pool->count = count;
+    pool->head = (LockFreeHead) {};
+    atomic_init(&pool->chunks, NULL);
+
+    return pool;
+}
+
+void lock_free_pool_dtor(LockFreePool* pool)
+{
+    if (!pool)
+    {
+        return;
+    }
+
+    LockFreeChunk* cur = atomic_load(&pool->chunks);
+    while (cur)
+    {
+        LockFreeChunk* next = cur->next;
+        cmlib_details_free(cur);
+        cur = next;
+    }
+
+    cmlib_details_free(pool);
+}
+
+void* lock_free_pool_allocate(LockFreePool* pool, size_t size, size_t alignment)
+{
+    if (!pool || size == 0 || size > pool->elem_size || alignment == 0
+        || alignment > pool->alignment)
+    {
+        return NULL;
+    }
+
+    LockFreeHead head = lock_free_head_load(&pool->head);
+
+    for (;;)
+    {
+        if (!head.block)
+        {
+            if (!lock_free_pool_grow(pool))
+            {
+                return NULL;
+            }
+            head = lock_free_head_load(&pool->head);
+            continue;
+        }
+
+        // The block may already be taken by another thread. Its memory stays
+        // mapped, and the tag makes the exchange fail in that case.
+        LockFreeHead next = {
+            .block = __atomic_load_n(&head.block->next, __ATOMIC_RELAXED),
+            .tag = head.tag + 1,
+        };
+
+        if (lock_free_head_exchange(&pool->head, &head, next))
+        {
+            return head.block;
+        }
+    }
+}
+
+void lock_free_pool_deallocate(LockFreePool* pool, void* ptr)
+{
+    if (!pool || !ptr)
+    {
+        return;
+    }
+
+    PoolFreeBlock* block = (PoolFreeBlock*)ptr;
+    lock_free_pool_push(pool, block, block);
+}
+
+/**
+ * Allocates a chunk of count blocks and pushes all of them at once.
+ */
+static bool lock_free_pool_grow(LockFreePool* pool)
+{
+    size_t offset = align_size(sizeof(LockFreeChunk), pool->alignment);
+    size_t alignment = MAX(pool->alignment, alignof(LockFreeChunk));
+    size_t size = align_size(offset + pool->count * pool->elem_size, alignment);
+
+    LockFreeChunk* chunk = cmlib_details_aligned_alloc(alignment, size);
+    if (!chunk)
+    {
+        return false;
+    }
+
+    char* blocks = (char*)chunk + offset;
+    for (size_t i = 0; i + 1 < pool->count; i++)
+    {
+        ((PoolFreeBlock*)(blocks + i * pool->elem_size))->next =
+            (PoolFreeBlock*)(blocks + (i + 1) * pool->elem_size);
+    }
+
+    chunk->next = atomic_load_explicit(&pool->chunks, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&pool->chunks,
+        &chunk->next,
+        chunk,
+        memory_order_release,
+        memory_order_relaxed))
+    {
+    }
+
+    lock_free_pool_push(pool,
+        (PoolFreeBlock*)blocks,
+        (PoolFreeBlock*)(blocks + (pool->count - 1) * pool->elem_size));
+
+    return true;
+}
+
+/**
+ * Pushes the chain of blocks from first to last onto the free stack.
+ */
+static void lock_free_pool_push(LockFreePool* pool,
+    PoolFreeBlock* first,
+    PoolFreeBlock* last)
+{
+    LockFreeHead head = lock_free_head_load(&pool->head);
+    LockFreeHead new_head = {};
+
+    do
+    {
+        __atomic_store_n(&last->next, head.block, __ATOMIC_RELAXED);
+        new_head = (LockFreeHead) {
+            .block = first,
+            .tag = head.tag + 1,
+        };
+    } while (!lock_free_head_exchange(&pool->head, &head, new_head));
+}
+
+static LockFreeHead lock_free_head_load(LockFreeHead* head)
+{
+    return (LockFreeHead) {
+        .tag = __atomic_load_n(&head->tag, __ATOMIC_ACQUIRE),
+        .block = __atomic_load_n(&head->block, __ATOMIC_ACQUIRE),
+    };
+}
+
+/**
+ * On failure stores the current head into expected.
+ */
+static bool lock_free_head_exchange(LockFreeHead* head,
+    LockFreeHead* expected,
+    LockFreeHead desired)
+{
+    return __atomic_compare_exchange(head,
+        expected,
+        &desired,
+        true,
+        __ATOMIC_ACQ_REL,
+        __ATOMIC_ACQUIRE);
+}
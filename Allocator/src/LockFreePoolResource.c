@@ -0,0 +1,66 @@
+#include "LockFreePoolResource.h"
+
+DECLARE_RESULT_SOURCE(LockFreePoolResource);
+
+static void* lock_free_pool_resource_allocate(void* resource,
+    size_t size,
+    size_t alignment);
+static void lock_free_pool_resource_deallocate(void* resource, void* ptr);
+
+Result_LockFreePoolResource lock_free_pool_resource_ctor(size_t elem_size,
+    size_t alignment,
+    size_t count)
+{
+    LockFreePool* pool = lock_free_pool_ctor(elem_size, alignment, count);
+    if (!pool)
+    {
+        return Result_LockFreePoolResource_ctor((LockFreePoolResource) {},
+            ERROR_NULLPTR);
+    }
+
+    return Result_LockFreePoolResource_ctor(lock_free_pool_to_resource(pool),
+        EVERYTHING_FINE);
+}
+
+LockFreePoolResource lock_free_pool_to_resource(LockFreePool* pool)
+{
+    if (!pool)
+    {
+        return (LockFreePoolResource) {};
+    }
+
+    return (LockFreePoolResource) {
+        .base =
+            (MemoryResource) {
+                .allocate = lock_free_pool_resource_allocate,
+                .deallocate = lock_free_pool_resource_deallocate,
+            },
+        .pool = pool,
+    };
+}
+
+void lock_free_pool_resource_dtor(LockFreePoolResource* resource)
+{
+    if (!resource)
+    {
+        return;
+    }
+
+    lock_free_pool_dtor(resource->pool);
+}
+
+static void* lock_free_pool_resource_allocate(void* resource,
+    size_t size,
+    size_t alignment)
+{
+    assert(resource);
+    LockFreePoolResource* lfpr = (LockFreePoolResource*)(resource);
+    return lock_free_pool_allocate(lfpr->pool, size, alignment);
+}
+
+static void lock_free_pool_resource_deallocate(void* resource, void* ptr)
+{
+    assert(resource);
+    LockFreePoolResource* lfpr = (LockFreePoolResource*)(resource);
+    return lock_free_pool_deallocate(lfpr->pool, ptr);
+}
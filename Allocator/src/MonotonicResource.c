@@ -0,0 +1,220 @@
+#include "MonotonicResource.h"
+
+#include <string.h>
+
+DECLARE_RESULT_SOURCE(MonotonicResource);
+
+/**
+ * Upstream blocks are never smaller than MONOTONIC_MIN_BLOCK_SIZE and every
+ * one is MONOTONIC_GROWTH_FACTOR times larger than the previous one.
+ */
+static constexpr size_t MONOTONIC_MIN_BLOCK_SIZE = 1024;
+static constexpr size_t MONOTONIC_GROWTH_FACTOR = 2;
+
+/**
+ * Header of a block taken from the upstream resource, followed by its
+ * storage.
+ */
+struct MonotonicBlock
+{
+    MonotonicBlock* prev;
+    size_t size; /**< Size of the upstream allocation. */
+};
+
+static void*
+monotonic_resource_allocate(void* resource, size_t size, size_t alignment);
+static void monotonic_resource_deallocate(void* resource, void* ptr);
+static void* monotonic_resource_reallocate(void* resource,
+    void* ptr,
+    size_t old_size,
+    size_t new_size,
+    size_t alignment);
+
+static bool
+monotonic_resource_grow(MonotonicResource* mr, size_t size, size_t alignment);
+static size_t monotonic_initial_block_size(size_t buffer_size);
+
+Result_MonotonicResource monotonic_resource_ctor(void* buffer,
+    size_t buffer_size,
+    MemoryResource* upstream)
+{
+    if (!upstream || (!buffer && buffer_size))
+    {
+        return Result_MonotonicResource_ctor((MonotonicResource) {},
+            ERROR_NULLPTR);
+    }
+
+    return Result_MonotonicResource_ctor(
+        (MonotonicResource) {
+            .base =
+                (MemoryResource) {
+                    .allocate = monotonic_resource_allocate,
+                    .deallocate = monotonic_resource_deallocate,
+                    .reallocate = monotonic_resource_reallocate,
+                },
+            .upstream = upstream,
+            .buffer = buffer,
+            .buffer_size = buffer_size,
+            .current = buffer,
+            .end = (char*)buffer + buffer_size,
+            .next_block_size = monotonic_initial_block_size(buffer_size),
+        },
+        EVERYTHING_FINE);
+}
+
+void monotonic_resource_release(MonotonicResource* resource)
+{
+    if (!resource)
+    {
+        return;
+    }
+
+    MonotonicBlock* block = resource->blocks;
+    while (block)
+    {
+        MonotonicBlock* prev = block->prev;
+        memory_resource_deallocate_sized(resource->upstream,
+            block,
+            block->size,
+            alignof(MonotonicBlock));
+        block = prev;
+    }
+
+    resource->blocks = NULL;
+    resource->current = resource->buffer;
+    resource->end = resource->buffer + resource->buffer_size;
+    resource->next_block_size =
+        monotonic_initial_block_size(resource->buffer_size);
+}
+
+void monotonic_resource_dtor(MonotonicResource* resource)
+{
+    monotonic_resource_release(resource);
+}
+
+static void*
+monotonic_resource_allocate(void* resource, size_t size, size_t alignment)
+{
+    assert(resource);
+    MonotonicResource* mr = (MonotonicResource*)resource;
+
+    if (size == 0 || alignment == 0)
+    {
+        return NULL;
+    }
+
+    char* allocated_ptr = align_ptr(mr->current, alignment);
+
+    if (!mr->current || allocated_ptr > mr->end
+        || size > (size_t)(mr->end - allocated_ptr))
+    {
+        if (!monotonic_resource_grow(mr, size, alignment))
+        {
+            return NULL;
+        }
+
+        allocated_ptr = align_ptr(mr->current, alignment);
+    }
+
+    mr->current = allocated_ptr + size;
+
+    return allocated_ptr;
+}
+
+static void monotonic_resource_deallocate(void* resource, void* ptr)
+{
+    (void)resource;
+    (void)ptr;
+}
+
+/**
+ * The most recent allocation grows and shrinks in place while the current
+ * buffer has room, others are copied to a new allocation.
+ */
+static void* monotonic_resource_reallocate(void* resource,
+    void* ptr,
+    size_t old_size,
+    size_t new_size,
+    size_t alignment)
+{
+    assert(resource);
+    MonotonicResource* mr = (MonotonicResource*)resource;
+
+    if (new_size == 0 || alignment == 0)
+    {
+        return NULL;
+    }
+
+    if (!ptr)
+    {
+        return monotonic_resource_allocate(resource, new_size, alignment);
+    }
+
+    char* block = ptr;
+
+    if (block + old_size == mr->current
+        && new_size <= (size_t)(mr->end - block))
+    {
+        mr->current = block + new_size;
+        return ptr;
+    }
+
+    if (new_size <= old_size)
+    {
+        return ptr;
+    }
+
+    void* new_ptr = monotonic_resource_allocate(resource, new_size, alignment);
+    if (!new_ptr)
+    {
+        return NULL;
+    }
+
+    memcpy(new_ptr, ptr, old_size);
+
+    return new_ptr;
+}
+
+/**
+ * Takes a block that fits size bytes at alignment from the upstream resource
+ * and makes it current. The rest of the previous buffer is abandoned.
+ */
+static bool
+monotonic_resource_grow(MonotonicResource* mr, size_t size, size_t alignment)
+{
+    size_t overhead = sizeof(MonotonicBlock) + alignment - 1;
+    if (size > SIZE_MAX - overhead)
+    {
+        return false;
+    }
+
+    size_t block_size = MAX(mr->next_block_size, size + overhead);
+
+    MemoryResource* upstream = mr->upstream;
+    MonotonicBlock* block =
+        upstream->allocate(upstream, block_size, alignof(MonotonicBlock));
+    if (!block)
+    {
+        return false;
+    }
+
+    *block = (MonotonicBlock) {
+        .prev = mr->blocks,
+        .size = block_size,
+    };
+    mr->blocks = block;
+    mr->current = (char*)(block + 1);
+    mr->end = (char*)block + block_size;
+
+    mr->next_block_size =
+        mr->next_block_size <= SIZE_MAX / MONOTONIC_GROWTH_FACTOR
+        ? mr->next_block_size * MONOTONIC_GROWTH_FACTOR
+        : SIZE_MAX;
+
+    return true;
+}
+
+static size_t monotonic_initial_block_size(size_t buffer_size)
+{
+    return MAX(buffer_size, MONOTONIC_MIN_BLOCK_SIZE);
+}
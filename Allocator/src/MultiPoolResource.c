@@ -0,0 +1,456 @@
+#include "MultiPoolResource.h"
+
+#include <limits.h>
+#include <string.h>
+
+DECLARE_RESULT_SOURCE(MultiPoolResource);
+
+/**
+ * Sizes up to MULTI_POOL_LINEAR_MAX are rounded to a multiple of
+ * MULTI_POOL_GRANULARITY. Above it every power of two range is split into
+ * 2^MULTI_POOL_CLASS_BITS classes.
+ */
+static constexpr size_t MULTI_POOL_GRANULARITY = 8;
+static constexpr size_t MULTI_POOL_LINEAR_MAX = 64;
+static constexpr size_t MULTI_POOL_CLASS_BITS = 2;
+
+/**
+ * Largest alignment pool_allocate supports.
+ */
+static constexpr size_t MULTI_POOL_MAX_ALIGNMENT = 4096;
+
+/**
+ * Header placed right before a block taken from the upstream resource.
+ */
+struct MultiPoolLargeBlock
+{
+    MultiPoolLargeBlock *prev, *next;
+    size_t size;      /**< Size requested by the caller. */
+    size_t alignment; /**< Alignment requested by the caller. */
+};
+
+static void*
+multi_pool_resource_allocate(void* resource, size_t size, size_t alignment);
+static void multi_pool_resource_deallocate(void* resource, void* ptr);
+static void* multi_pool_resource_reallocate(void* resource,
+    void* ptr,
+    size_t old_size,
+    size_t new_size,
+    size_t alignment);
+static void multi_pool_resource_deallocate_sized(void* resource,
+    void* ptr,
+    size_t size,
+    size_t alignment);
+static size_t multi_pool_resource_allocate_bulk(void* resource,
+    size_t size,
+    size_t alignment,
+    size_t count,
+    void** ptrs);
+static void
+multi_pool_resource_deallocate_bulk(void* resource, void** ptrs, size_t count);
+
+static bool multi_pool_is_large(const MultiPoolResource* mpr,
+    size_t size,
+    size_t alignment);
+static size_t multi_pool_class_size(size_t size, size_t alignment);
+
+static void* multi_pool_large_allocate(MultiPoolResource* mpr,
+    size_t size,
+    size_t alignment);
+static void* multi_pool_large_reallocate(MultiPoolResource* mpr,
+    void* ptr,
+    size_t new_size);
+static void multi_pool_large_deallocate(MultiPoolResource* mpr, void* ptr);
+static MultiPoolLargeBlock* multi_pool_large_header(void* ptr);
+static size_t multi_pool_large_offset(size_t alignment);
+static void
+multi_pool_large_link(MultiPoolResource* mpr, MultiPoolLargeBlock* block);
+static void
+multi_pool_large_unlink(MultiPoolResource* mpr, MultiPoolLargeBlock* block);
+
+Result_MultiPoolResource multi_pool_resource_ctor(size_t count,
+    size_t max_block_size,
+    MemoryResource* upstream)
+{
+    if (!upstream)
+    {
+        return Result_MultiPoolResource_ctor((MultiPoolResource) {},
+            ERROR_NULLPTR);
+    }
+
+    Pool* pool = pool_ctor(count);
+    if (!pool)
+    {
+        return Result_MultiPoolResource_ctor((MultiPoolResource) {},
+            ERROR_NULLPTR);
+    }
+
+    return Result_MultiPoolResource_ctor(
+        (MultiPoolResource) {
+            .base =
+                (MemoryResource) {
+                    .allocate = multi_pool_resource_allocate,
+                    .deallocate = multi_pool_resource_deallocate,
+                    .reallocate = multi_pool_resource_reallocate,
+                    .deallocate_sized = multi_pool_resource_deallocate_sized,
+                    .allocate_bulk = multi_pool_resource_allocate_bulk,
+                    .deallocate_bulk = multi_pool_resource_deallocate_bulk,
+                },
+            .pool = pool,
+            .upstream = upstream,
+            .max_block_size = max_block_size,
+        },
+        EVERYTHING_FINE);
+}
+
+size_t multi_pool_resource_block_size(const MultiPoolResource* resource,
+    size_t size,
+    size_t alignment)
+{
+    if (!resource || alignment == 0)
+    {
+        return 0;
+    }
+
+    if (multi_pool_is_large(resource, size, alignment))
+    {
+        return size;
+    }
+
+    return multi_pool_class_size(size, alignment);
+}
+
+void multi_pool_resource_dtor(MultiPoolResource* resource)
+{
+    if (!resource)
+    {
+        return;
+    }
+
+    while (resource->large_blocks)
+    {
+        multi_pool_large_deallocate(resource, resource->large_blocks + 1);
+    }
+
+    pool_dtor(resource->pool);
+}
+
+static void*
+multi_pool_resource_allocate(void* resource, size_t size, size_t alignment)
+{
+    assert(resource);
+    MultiPoolResource* mpr = (MultiPoolResource*)resource;
+
+    if (size == 0 || alignment == 0)
+    {
+        return NULL;
+    }
+
+    if (multi_pool_is_large(mpr, size, alignment))
+    {
+        return multi_pool_large_allocate(mpr, size, alignment);
+    }
+
+    return pool_allocate(mpr->pool,
+        multi_pool_class_size(size, alignment),
+        alignment);
+}
+
+static void multi_pool_resource_deallocate(void* resource, void* ptr)
+{
+    assert(resource);
+    MultiPoolResource* mpr = (MultiPoolResource*)resource;
+
+    if (!ptr)
+    {
+        return;
+    }
+
+    for (MultiPoolLargeBlock* cur = mpr->large_blocks; cur; cur = cur->next)
+    {
+        if (cur + 1 == ptr)
+        {
+            multi_pool_large_deallocate(mpr, ptr);
+            return;
+        }
+    }
+
+    pool_deallocate(mpr->pool, ptr);
+}
+
+/**
+ * Blocks stay in place while the new size maps to the same class, upstream
+ * blocks are resized by the upstream resource.
+ */
+static void* multi_pool_resource_reallocate(void* resource,
+    void* ptr,
+    size_t old_size,
+    size_t new_size,
+    size_t alignment)
+{
+    assert(resource);
+    MultiPoolResource* mpr = (MultiPoolResource*)resource;
+
+    if (new_size == 0 || alignment == 0)
+    {
+        return NULL;
+    }
+
+    if (!ptr)
+    {
+        return multi_pool_resource_allocate(resource, new_size, alignment);
+    }
+
+    bool old_large = multi_pool_is_large(mpr, old_size, alignment);
+    bool new_large = multi_pool_is_large(mpr, new_size, alignment);
+
+    if (old_large && new_large)
+    {
+        return multi_pool_large_reallocate(mpr, ptr, new_size);
+    }
+
+    if (!old_large && !new_large
+        && multi_pool_class_size(old_size, alignment)
+            == multi_pool_class_size(new_size, alignment))
+    {
+        return ptr;
+    }
+
+    void* new_ptr = multi_pool_resource_allocate(resource, new_size, alignment);
+    if (!new_ptr)
+    {
+        return NULL;
+    }
+
+    memcpy(new_ptr, ptr, MIN(old_size, new_size));
+    multi_pool_resource_deallocate_sized(resource, ptr, old_size, alignment);
+
+    return new_ptr;
+}
+
+static void multi_pool_resource_deallocate_sized(void* resource,
+    void* ptr,
+    size_t size,
+    size_t alignment)
+{
+    assert(resource);
+    MultiPoolResource* mpr = (MultiPoolResource*)resource;
+
+    if (!ptr)
+    {
+        return;
+    }
+
+    if (multi_pool_is_large(mpr, size, alignment))
+    {
+        multi_pool_large_deallocate(mpr, ptr);
+        return;
+    }
+
+    pool_deallocate(mpr->pool, ptr);
+}
+
+static size_t multi_pool_resource_allocate_bulk(void* resource,
+    size_t size,
+    size_t alignment,
+    size_t count,
+    void** ptrs)
+{
+    assert(resource);
+    MultiPoolResource* mpr = (MultiPoolResource*)resource;
+
+    if (size == 0 || alignment == 0)
+    {
+        return 0;
+    }
+
+    if (!multi_pool_is_large(mpr, size, alignment))
+    {
+        return pool_allocate_bulk(mpr->pool,
+            multi_pool_class_size(size, alignment),
+            alignment,
+            count,
+            ptrs);
+    }
+
+    size_t allocated = 0;
+    while (allocated < count)
+    {
+        void* ptr = multi_pool_large_allocate(mpr, size, alignment);
+        if (!ptr)
+        {
+            break;
+        }
+        ptrs[allocated++] = ptr;
+    }
+
+    return allocated;
+}
+
+/**
+ * Hands the blocks to the pool at once unless some of them may come from
+ * upstream.
+ */
+static void
+multi_pool_resource_deallocate_bulk(void* resource, void** ptrs, size_t count)
+{
+    assert(resource);
+    MultiPoolResource* mpr = (MultiPoolResource*)resource;
+
+    if (!mpr->large_blocks)
+    {
+        pool_deallocate_bulk(mpr->pool, ptrs, count);
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        multi_pool_resource_deallocate(resource, ptrs[i]);
+    }
+}
+
+static bool multi_pool_is_large(const MultiPoolResource* mpr,
+    size_t size,
+    size_t alignment)
+{
+    return alignment > MULTI_POOL_MAX_ALIGNMENT || size > mpr->max_block_size
+        || multi_pool_class_size(size, alignment) > mpr->max_block_size;
+}
+
+/**
+ * Rounds size up to its class. A class above MULTI_POOL_LINEAR_MAX in the
+ * range (2^k, 2^(k+1)] is a multiple of 2^(k - MULTI_POOL_CLASS_BITS), so
+ * rounding it up to a power of two alignment not above 2^(k+1) yields another
+ * class of the same set.
+ */
+static size_t multi_pool_class_size(size_t size, size_t alignment)
+{
+    size = align_size(size, MAX(alignment, MULTI_POOL_GRANULARITY));
+
+    if (size > MULTI_POOL_LINEAR_MAX)
+    {
+        size_t log = sizeof(size_t) * CHAR_BIT - 1
+            - (size_t)__builtin_clzl(size - 1);
+        size = align_size(size, (size_t)1 << (log - MULTI_POOL_CLASS_BITS));
+    }
+
+    return align_size(size, alignment);
+}
+
+static void* multi_pool_large_allocate(MultiPoolResource* mpr,
+    size_t size,
+    size_t alignment)
+{
+    size_t offset = multi_pool_large_offset(alignment);
+    if (size > SIZE_MAX - offset)
+    {
+        return NULL;
+    }
+
+    MemoryResource* upstream = mpr->upstream;
+    char* block = upstream->allocate(upstream,
+        offset + size,
+        MAX(alignment, alignof(MultiPoolLargeBlock)));
+    if (!block)
+    {
+        return NULL;
+    }
+
+    MultiPoolLargeBlock* header = multi_pool_large_header(block + offset);
+    header->size = size;
+    header->alignment = alignment;
+    multi_pool_large_link(mpr, header);
+
+    return block + offset;
+}
+
+static void* multi_pool_large_reallocate(MultiPoolResource* mpr,
+    void* ptr,
+    size_t new_size)
+{
+    MultiPoolLargeBlock* header = multi_pool_large_header(ptr);
+    size_t alignment = header->alignment;
+    size_t offset = multi_pool_large_offset(alignment);
+    if (new_size > SIZE_MAX - offset)
+    {
+        return NULL;
+    }
+
+    // the header moves with the block, so it is relinked afterwards
+    multi_pool_large_unlink(mpr, header);
+
+    char* block = memory_resource_reallocate(mpr->upstream,
+        (char*)ptr - offset,
+        offset + header->size,
+        offset + new_size,
+        MAX(alignment, alignof(MultiPoolLargeBlock)));
+    if (!block)
+    {
+        multi_pool_large_link(mpr, header);
+        return NULL;
+    }
+
+    header = multi_pool_large_header(block + offset);
+    header->size = new_size;
+    multi_pool_large_link(mpr, header);
+
+    return block + offset;
+}
+
+static void multi_pool_large_deallocate(MultiPoolResource* mpr, void* ptr)
+{
+    MultiPoolLargeBlock* header = multi_pool_large_header(ptr);
+    size_t alignment = header->alignment;
+    size_t offset = multi_pool_large_offset(alignment);
+
+    multi_pool_large_unlink(mpr, header);
+
+    memory_resource_deallocate_sized(mpr->upstream,
+        (char*)ptr - offset,
+        offset + header->size,
+        MAX(alignment, alignof(MultiPoolLargeBlock)));
+}
+
+static MultiPoolLargeBlock* multi_pool_large_header(void* ptr)
+{
+    return (MultiPoolLargeBlock*)ptr - 1;
+}
+
+/**
+ * Distance from the start of an upstream block to the caller's block, which
+ * leaves room for the header and keeps the caller's block aligned.
+ */
+static size_t multi_pool_large_offset(size_t alignment)
+{
+    return align_size(sizeof(MultiPoolLargeBlock),
+        MAX(alignment, alignof(MultiPoolLargeBlock)));
+}
+
+static void
+multi_pool_large_link(MultiPoolResource* mpr, MultiPoolLargeBlock* block)
+{
+    block->prev = NULL;
+    block->next = mpr->large_blocks;
+    if (block->next)
+    {
+        block->next->prev = block;
+    }
+    mpr->large_blocks = block;
+}
+
+static void
+multi_pool_large_unlink(MultiPoolResource* mpr, MultiPoolLargeBlock* block)
+{
+    if (block->prev)
+    {
+        block->prev->next = block->next;
+    }
+    else
+    {
+        mpr->large_blocks = block->next;
+    }
+    if (block->next)
+    {
+        block->next->prev = block->prev;
+    }
+}
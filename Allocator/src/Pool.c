@@ -1,67 +1,121 @@
 #include "Pool.h"
 
+#include <limits.h>
 #include <stdint.h>
 
 #include "Allocator.h"
 #include "details/CountingMalloc.h"
-
-typedef struct PoolFreeBlock PoolFreeBlock;
-struct PoolFreeBlock
-{
-    PoolFreeBlock* next;
-};
+#include "details/HugePages.h"
+#include "details/Prefault.h"
+#include "details/PoolFreeBlock.h"
+
+/**
+ * Subpools are carved out of slabs aligned to POOL_SLAB_ALIGNMENT. Every slab
+ * unit that contains the start of a block begins with a PoolSlabTag, so the
+ * subpool owning a block is found by masking the block address.
+ */
+static constexpr size_t POOL_SLAB_ALIGNMENT = 64 * 1024;
+static constexpr size_t POOL_MAX_ALIGNMENT = 4096;
+
+/**
+ * Aligned sizes up to POOL_SMALL_CLASS_MAX index the small class table
+ * directly. Larger sizes are bucketed by their highest set bit, each bucket
+ * holding a short chain of exact sizes.
+ */
+static constexpr size_t POOL_CLASS_GRANULARITY = 8;
+static constexpr size_t POOL_SMALL_CLASS_MAX = 1024;
+static constexpr size_t POOL_SMALL_CLASS_COUNT =
+    POOL_SMALL_CLASS_MAX / POOL_CLASS_GRANULARITY;
+static constexpr size_t POOL_LARGE_BUCKET_COUNT = sizeof(size_t) * CHAR_BIT;
+
+/**
+ * Number of empty subpools a class keeps by default before releasing them, so
+ * an alloc/free cycle at a subpool boundary does not allocate a slab each time.
+ */
+static constexpr size_t POOL_DEFAULT_RETAINED_EMPTY = 1;
 
 typedef struct SubPool SubPool;
-struct SubPool
+typedef struct PoolSizeClass PoolSizeClass;
+
+typedef struct PoolSlabTag
 {
-    PoolFreeBlock* free_block;
-};
+    SubPool* sub_pool;
+} PoolSlabTag;
 
-typedef struct SecondLevelPool SecondLevelPool;
-struct SecondLevelPool
+struct SubPool
 {
-    SubPool base;
-    SecondLevelPool* next_pool_same_size;
+    PoolSlabTag tag;
+    PoolFreeBlock* free_block; /**< Blocks that have been freed. */
+    size_t bump;               /**< Slab offset of the next uncarved block. */
+    size_t unit_left;          /**< Uncarved blocks left in bump's unit. */
+    size_t uncarved;           /**< Uncarved blocks left in the subpool. */
+    PoolSizeClass* size_class;
+    size_t live;     /**< Number of allocated blocks. */
+    size_t capacity; /**< Number of blocks the slab holds. */
+    size_t slab_size;
+    bool locked; /**< pool_prefault locked the slab. */
+    SubPool *prev_partial, *next_partial; /**< Subpools with free blocks. */
+    SubPool *prev, *next;                 /**< All subpools of the class. */
 };
 
-typedef struct FirstLevelPool FirstLevelPool;
-struct FirstLevelPool
+struct PoolSizeClass
 {
-    SecondLevelPool base;
-    FirstLevelPool* next_pool_dif_size;
     size_t elem_size;
+    SubPool* partial;    /**< Stack of subpools that have free blocks. */
+    SubPool* sub_pools;  /**< All subpools of the class. */
+    size_t empty_count;  /**< Number of subpools without live blocks. */
+    PoolSizeClass* next; /**< Next large class in the same bucket. */
+    bool huge_pages;     /**< Slabs are backed by huge pages. */
 };
 
 struct Pool
 {
     size_t count;
-    FirstLevelPool* pool;
+    size_t retained_empty;
+    bool huge_pages;
+    PoolSizeClass small_classes[POOL_SMALL_CLASS_COUNT];
+    PoolSizeClass* large_classes[POOL_LARGE_BUCKET_COUNT];
 };
 
-typedef struct FindResult
-{
-    FirstLevelPool *prev, *cur;
-} FindResult;
-
-static SubPool* sub_pool_ctor(size_t count, size_t elem_size, size_t meta_size);
+static SubPool* sub_pool_ctor(PoolSizeClass* size_class, size_t count);
+static void sub_pool_dtor(SubPool* pool);
+static void sub_pool_free_slab(SubPool* pool);
 static void* sub_pool_allocate(SubPool* pool);
+static void* sub_pool_carve(SubPool* pool);
+static bool sub_pool_is_full(SubPool* pool);
 static void sub_pool_deallocate(SubPool* pool, void* ptr);
-
-static SecondLevelPool*
-second_level_ctor(size_t count, size_t elem_size, size_t meta_size);
-static FirstLevelPool* first_level_ctor(size_t count, size_t elem_size);
-
-static void*
-second_level_allocate(SecondLevelPool* pool, size_t count, size_t elem_size);
-static void* first_level_allocate(FirstLevelPool* pool, size_t count);
-
-static SubPool* find_sub_pool_containing_ptr(Pool* pool, void* ptr);
-
-static FindResult find_first_level_by_size(FirstLevelPool* pool,
-    size_t elem_size);
+static size_t sub_pool_allocate_run(SubPool* pool, void** ptrs, size_t count);
+static void sub_pool_deallocate_run(SubPool* pool, void** ptrs, size_t count);
+
+static void size_class_dtor(PoolSizeClass* size_class);
+static void* size_class_allocate(PoolSizeClass* size_class, size_t count);
+static size_t size_class_allocate_bulk(PoolSizeClass* size_class,
+    size_t count,
+    void** ptrs,
+    size_t ptr_count);
+static void size_class_push_partial(PoolSizeClass* size_class, SubPool* pool);
+static void size_class_unlink_partial(PoolSizeClass* size_class, SubPool* pool);
+static size_t size_class_trim(PoolSizeClass* size_class, size_t retained);
+static bool size_class_prefault(PoolSizeClass* size_class, bool lock);
+
+static PoolSizeClass* pool_get_size_class(Pool* pool, size_t elem_size);
+static size_t pool_large_bucket(size_t elem_size);
+
+static size_t pool_block_alignment(size_t elem_size);
+static size_t sub_pool_unit_capacity(size_t offset, size_t elem_size);
+static size_t
+sub_pool_slab_size(size_t count, size_t elem_size, size_t meta_size);
+static size_t
+sub_pool_slab_count(size_t slab_size, size_t elem_size, size_t meta_size);
+static SubPool* find_sub_pool_containing_ptr(void* ptr);
 
 Pool* pool_ctor(size_t count)
 {
+    if (count == 0)
+    {
+        return NULL;
+    }
+
     Pool* pool = cmlib_details_malloc(sizeof(Pool));
     if (!pool)
     {
@@ -70,12 +124,128 @@ Pool* pool_ctor(size_t count)
 
     *pool = (Pool) {
         .count = count,
-        .pool = NULL,
+        .retained_empty = POOL_DEFAULT_RETAINED_EMPTY,
     };
 
+    for (size_t i = 0; i < POOL_SMALL_CLASS_COUNT; i++)
+    {
+        pool->small_classes[i].elem_size = (i + 1) * POOL_CLASS_GRANULARITY;
+    }
+
     return pool;
 }
 
+Pool* pool_ctor_classes(size_t count,
+    const size_t* elem_sizes,
+    size_t class_count)
+{
+    if (!elem_sizes && class_count)
+    {
+        return NULL;
+    }
+
+    Pool* pool = pool_ctor(count);
+    if (!pool)
+    {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < class_count; i++)
+    {
+        if (elem_sizes[i] == 0)
+        {
+            continue;
+        }
+
+        PoolSizeClass* size_class = pool_get_size_class(pool,
+            align_size(elem_sizes[i], alignof(PoolFreeBlock)));
+
+        if (!size_class
+            || (!size_class->sub_pools && !sub_pool_ctor(size_class, count)))
+        {
+            pool_dtor(pool);
+            return NULL;
+        }
+    }
+
+    return pool;
+}
+
+Pool* pool_ctor_huge(size_t count)
+{
+    Pool* pool = pool_ctor(count);
+    if (!pool)
+    {
+        return NULL;
+    }
+
+    pool->huge_pages = true;
+    for (size_t i = 0; i < POOL_SMALL_CLASS_COUNT; i++)
+    {
+        pool->small_classes[i].huge_pages = true;
+    }
+
+    return pool;
+}
+
+bool pool_reserve(Pool* pool, size_t elem_size, size_t count)
+{
+    if (!pool || elem_size == 0)
+    {
+        return false;
+    }
+
+    size_t aligned_size = align_size(elem_size, alignof(PoolFreeBlock));
+    PoolSizeClass* size_class = pool_get_size_class(pool, aligned_size);
+    if (!size_class)
+    {
+        return false;
+    }
+
+    size_t available = 0;
+    for (SubPool* cur = size_class->partial; cur; cur = cur->next_partial)
+    {
+        available += cur->capacity - cur->live;
+    }
+
+    while (available < count)
+    {
+        SubPool* sp = sub_pool_ctor(size_class, pool->count);
+        if (!sp)
+        {
+            return false;
+        }
+        available += sp->capacity;
+    }
+
+    return true;
+}
+
+bool pool_prefault(Pool* pool, bool lock)
+{
+    if (!pool)
+    {
+        return false;
+    }
+
+    bool ok = true;
+
+    for (size_t i = 0; i < POOL_SMALL_CLASS_COUNT; i++)
+    {
+        ok &= size_class_prefault(&pool->small_classes[i], lock);
+    }
+
+    for (size_t i = 0; i < POOL_LARGE_BUCKET_COUNT; i++)
+    {
+        for (PoolSizeClass* cur = pool->large_classes[i]; cur; cur = cur->next)
+        {
+            ok &= size_class_prefault(cur, lock);
+        }
+    }
+
+    return ok;
+}
+
 void pool_dtor(Pool* pool)
 {
     if (!pool)
@@ -83,20 +253,21 @@ void pool_dtor(Pool* pool)
         return;
     }
 
-    FirstLevelPool* cur_f = pool->pool;
+    for (size_t i = 0; i < POOL_SMALL_CLASS_COUNT; i++)
+    {
+        size_class_dtor(&pool->small_classes[i]);
+    }
 
-    while (cur_f)
+    for (size_t i = 0; i < POOL_LARGE_BUCKET_COUNT; i++)
     {
-        SecondLevelPool* cur_s = cur_f->base.next_pool_same_size;
-        while (cur_s)
+        PoolSizeClass* cur = pool->large_classes[i];
+        while (cur)
         {
-            SecondLevelPool* next = cur_s->next_pool_same_size;
-            cmlib_details_free(cur_s);
-            cur_s = next;
+            PoolSizeClass* next = cur->next;
+            size_class_dtor(cur);
+            cmlib_details_free(cur);
+            cur = next;
         }
-        FirstLevelPool* next = cur_f->next_pool_dif_size;
-        cmlib_details_free(cur_f);
-        cur_f = next;
     }
 
     cmlib_details_free(pool);
@@ -104,84 +275,246 @@ void pool_dtor(Pool* pool)
 
 void* pool_allocate(Pool* pool, size_t size, size_t alignment)
 {
-    if (!pool || size == 0 || alignment == 0)
+    if (!pool || size == 0 || alignment == 0 || alignment > POOL_MAX_ALIGNMENT)
+    {
+        return NULL;
+    }
+
+    alignment = MAX(alignment, alignof(PoolFreeBlock));
+    size_t aligned_size = align_size(size, alignment);
+
+    PoolSizeClass* size_class = pool_get_size_class(pool, aligned_size);
+    if (!size_class)
     {
         return NULL;
     }
 
+    return size_class_allocate(size_class, pool->count);
+}
+
+void pool_deallocate(Pool* pool, void* ptr)
+{
+    if (!pool || !ptr)
+    {
+        return;
+    }
+
+    SubPool* sp = find_sub_pool_containing_ptr(ptr);
+
+    if (!sp)
+    {
+        return;
+    }
+
+    sub_pool_deallocate(sp, ptr);
+
+    PoolSizeClass* size_class = sp->size_class;
+    if (sp->live == 0 && ++size_class->empty_count > pool->retained_empty)
+    {
+        sub_pool_dtor(sp);
+    }
+}
+
+size_t pool_allocate_bulk(Pool* pool,
+    size_t size,
+    size_t alignment,
+    size_t count,
+    void** ptrs)
+{
+    if (!pool || !ptrs || size == 0 || alignment == 0
+        || alignment > POOL_MAX_ALIGNMENT)
+    {
+        return 0;
+    }
+
     alignment = MAX(alignment, alignof(PoolFreeBlock));
     size_t aligned_size = align_size(size, alignment);
 
-    if (!pool->pool)
+    PoolSizeClass* size_class = pool_get_size_class(pool, aligned_size);
+    if (!size_class)
     {
-        pool->pool = first_level_ctor(pool->count, aligned_size);
-        return first_level_allocate(pool->pool, pool->count);
+        return 0;
     }
 
-    FindResult needed_pool = find_first_level_by_size(pool->pool, aligned_size);
+    return size_class_allocate_bulk(size_class, pool->count, ptrs, count);
+}
 
-    if (!needed_pool.cur)
+void pool_deallocate_bulk(Pool* pool, void** ptrs, size_t count)
+{
+    if (!pool || !ptrs)
     {
-        needed_pool.cur = first_level_ctor(pool->count, aligned_size);
-        if (needed_pool.prev)
+        return;
+    }
+
+    size_t i = 0;
+    while (i < count)
+    {
+        if (!ptrs[i])
+        {
+            i++;
+            continue;
+        }
+
+        SubPool* sp = find_sub_pool_containing_ptr(ptrs[i]);
+
+        size_t run = 1;
+        while (i + run < count && ptrs[i + run]
+            && find_sub_pool_containing_ptr(ptrs[i + run]) == sp)
+        {
+            run++;
+        }
+
+        sub_pool_deallocate_run(sp, ptrs + i, run);
+        i += run;
+
+        PoolSizeClass* size_class = sp->size_class;
+        if (sp->live == 0 && ++size_class->empty_count > pool->retained_empty)
         {
-            needed_pool.prev->next_pool_dif_size = needed_pool.cur;
+            sub_pool_dtor(sp);
         }
     }
+}
 
-    FirstLevelPool* fp = needed_pool.cur;
-    if (!fp)
+size_t pool_block_size(Pool* pool, void* ptr)
+{
+    if (!pool || !ptr)
     {
-        return NULL;
+        return 0;
     }
 
-    return first_level_allocate(fp, pool->count);
+    return find_sub_pool_containing_ptr(ptr)->size_class->elem_size;
 }
 
-void pool_deallocate(Pool* pool, void* ptr)
+void pool_set_retained_empty(Pool* pool, size_t retained)
 {
-    if (!pool || !ptr)
+    if (!pool)
     {
         return;
     }
 
-    SubPool* sp = find_sub_pool_containing_ptr(pool, ptr);
+    pool->retained_empty = retained;
+}
 
-    if (!sp)
+size_t pool_trim(Pool* pool)
+{
+    if (!pool)
     {
-        return;
+        return 0;
     }
 
-    sub_pool_deallocate(sp, ptr);
+    size_t released = 0;
+
+    for (size_t i = 0; i < POOL_SMALL_CLASS_COUNT; i++)
+    {
+        released += size_class_trim(&pool->small_classes[i], 0);
+    }
+
+    for (size_t i = 0; i < POOL_LARGE_BUCKET_COUNT; i++)
+    {
+        for (PoolSizeClass* cur = pool->large_classes[i]; cur; cur = cur->next)
+        {
+            released += size_class_trim(cur, 0);
+        }
+    }
+
+    return released;
 }
 
-static SubPool* sub_pool_ctor(size_t count, size_t elem_size, size_t meta_size)
+/**
+ * Creates a subpool of at least count blocks and links it into the class both
+ * as a member and as a partial subpool. The slab is rounded up to whole slab
+ * units, or whole huge pages, and the subpool takes every block that fits
+ * into it, so a small count does not cost a mostly empty slab per subpool.
+ * Blocks are carved from the slab on first use, so untouched pages stay
+ * unmapped.
+ */
+static SubPool* sub_pool_ctor(PoolSizeClass* size_class, size_t count)
 {
-    size_t size = count * elem_size;
-    SubPool* pool = (SubPool*)cmlib_details_malloc(size + meta_size);
+    size_t elem_size = size_class->elem_size;
+    size_t alignment = pool_block_alignment(elem_size);
+    size_t slab_size = sub_pool_slab_size(count, elem_size, sizeof(SubPool));
+
+    SubPool* pool = NULL;
+    if (size_class->huge_pages)
+    {
+        slab_size = align_size(slab_size, CMLIB_HUGE_PAGE_SIZE);
+        pool = slab_size ? cmlib_details_huge_alloc(slab_size) : NULL;
+    }
+    else
+    {
+        pool = cmlib_details_aligned_alloc(POOL_SLAB_ALIGNMENT, slab_size);
+    }
+
     if (!pool)
     {
         return NULL;
     }
 
-    char* start = (char*)pool + meta_size;
-    char* end = start + size;
+    count = sub_pool_slab_count(slab_size, elem_size, sizeof(SubPool));
+
+    pool->tag.sub_pool = pool;
+    pool->free_block = NULL;
+    pool->bump = align_size(sizeof(SubPool), alignment);
+    pool->unit_left = sub_pool_unit_capacity(pool->bump, elem_size);
+    pool->uncarved = count;
+
+    pool->size_class = size_class;
+    pool->live = 0;
+    pool->capacity = count;
+    pool->slab_size = slab_size;
+    pool->locked = false;
+    pool->prev = NULL;
+    pool->next = size_class->sub_pools;
+    if (pool->next)
+    {
+        pool->next->prev = pool;
+    }
+    size_class->sub_pools = pool;
+    size_class->empty_count++;
+    size_class_push_partial(size_class, pool);
 
-    char* cur = start;
+    return pool;
+}
 
-    while (cur < end)
+/**
+ * Unlinks an empty subpool from its class and releases its slab.
+ */
+static void sub_pool_dtor(SubPool* pool)
+{
+    PoolSizeClass* size_class = pool->size_class;
+
+    size_class_unlink_partial(size_class, pool);
+
+    if (pool->prev)
+    {
+        pool->prev->next = pool->next;
+    }
+    else
     {
-        ((PoolFreeBlock*)cur)->next = (PoolFreeBlock*)(cur + elem_size);
-        cur += elem_size;
+        size_class->sub_pools = pool->next;
+    }
+    if (pool->next)
+    {
+        pool->next->prev = pool->prev;
     }
-    cur -= elem_size;
-    ((PoolFreeBlock*)cur)->next = NULL;
 
-    *pool = (SubPool) {
-        .free_block = (PoolFreeBlock*)start,
-    };
+    size_class->empty_count--;
+    sub_pool_free_slab(pool);
+}
 
-    return pool;
+static void sub_pool_free_slab(SubPool* pool)
+{
+    if (pool->size_class->huge_pages)
+    {
+        cmlib_details_huge_free(pool, pool->slab_size);
+        return;
+    }
+
+    if (pool->locked)
+    {
+        cmlib_details_unlock(pool, pool->slab_size);
+    }
+    cmlib_details_free(pool);
 }
 
 static void* sub_pool_allocate(SubPool* pool)
@@ -191,143 +524,400 @@ static void* sub_pool_allocate(SubPool* pool)
         return NULL;
     }
 
-    if (!pool->free_block)
+    void* ret = NULL;
+
+    if (pool->free_block)
+    {
+        ret = pool->free_block;
+        pool->free_block = pool->free_block->next;
+    }
+    else if (pool->uncarved)
+    {
+        ret = sub_pool_carve(pool);
+    }
+    else
     {
         return NULL;
     }
 
-    void* ret = pool->free_block;
-    pool->free_block = pool->free_block->next;
+    pool->live++;
+
+    return ret;
+}
+
+/**
+ * Takes the next block from the uncarved tail of the slab. Entering a new
+ * slab unit writes its tag first.
+ */
+static void* sub_pool_carve(SubPool* pool)
+{
+    size_t elem_size = pool->size_class->elem_size;
+    char* slab = (char*)pool;
+
+    if (pool->unit_left == 0)
+    {
+        size_t alignment = pool_block_alignment(elem_size);
+        size_t tag_size = align_size(sizeof(PoolSlabTag), alignment);
+        size_t unit = align_size(pool->bump, POOL_SLAB_ALIGNMENT);
+
+        ((PoolSlabTag*)(slab + unit))->sub_pool = pool;
+        pool->bump = unit + tag_size;
+        pool->unit_left = sub_pool_unit_capacity(pool->bump, elem_size);
+    }
+
+    void* ret = slab + pool->bump;
+    pool->bump += elem_size;
+    pool->unit_left--;
+    pool->uncarved--;
 
     return ret;
 }
 
+static bool sub_pool_is_full(SubPool* pool)
+{
+    return !pool->free_block && !pool->uncarved;
+}
+
 static void sub_pool_deallocate(SubPool* pool, void* ptr)
 {
     if (!pool)
     {
         return;
     }
+
+    if (sub_pool_is_full(pool))
+    {
+        size_class_push_partial(pool->size_class, pool);
+    }
+
     PoolFreeBlock* fblock = (PoolFreeBlock*)ptr;
     fblock->next = pool->free_block;
     pool->free_block = fblock;
+    pool->live--;
 }
 
-static SecondLevelPool*
-second_level_ctor(size_t count, size_t elem_size, size_t meta_size)
+/**
+ * Takes up to count blocks, free ones first, then uncarved ones.
+ *
+ * @return number of blocks taken.
+ */
+static size_t sub_pool_allocate_run(SubPool* pool, void** ptrs, size_t count)
 {
-    SecondLevelPool* pool = (SecondLevelPool*)sub_pool_ctor(count,
-        elem_size,
-        meta_size ? meta_size : sizeof(*pool));
+    size_t taken = 0;
 
-    if (!pool)
+    PoolFreeBlock* fblock = pool->free_block;
+    while (taken < count && fblock)
     {
-        return NULL;
+        ptrs[taken++] = fblock;
+        fblock = fblock->next;
+    }
+    pool->free_block = fblock;
+
+    while (taken < count && pool->uncarved)
+    {
+        ptrs[taken++] = sub_pool_carve(pool);
     }
 
-    pool->next_pool_same_size = NULL;
+    pool->live += taken;
 
-    return pool;
+    return taken;
 }
 
-static FirstLevelPool* first_level_ctor(size_t count, size_t elem_size)
+/**
+ * Links count blocks of the subpool into a chain and pushes it onto the free
+ * list at once.
+ */
+static void sub_pool_deallocate_run(SubPool* pool, void** ptrs, size_t count)
 {
-    FirstLevelPool* pool =
-        (FirstLevelPool*)second_level_ctor(count, elem_size, sizeof(*pool));
-
-    if (!pool)
+    if (sub_pool_is_full(pool))
     {
-        return NULL;
+        size_class_push_partial(pool->size_class, pool);
     }
 
-    pool->next_pool_dif_size = NULL;
-    pool->elem_size = elem_size;
+    for (size_t i = 0; i + 1 < count; i++)
+    {
+        ((PoolFreeBlock*)ptrs[i])->next = ptrs[i + 1];
+    }
+    ((PoolFreeBlock*)ptrs[count - 1])->next = pool->free_block;
 
-    return pool;
+    pool->free_block = ptrs[0];
+    pool->live -= count;
 }
 
-static void*
-second_level_allocate(SecondLevelPool* pool, size_t count, size_t elem_size)
+static void size_class_dtor(PoolSizeClass* size_class)
 {
-    SecondLevelPool* prev = NULL;
-    SecondLevelPool* cur = pool;
+    SubPool* cur = size_class->sub_pools;
+    while (cur)
+    {
+        SubPool* next = cur->next;
+        sub_pool_free_slab(cur);
+        cur = next;
+    }
 
-    void* ret = sub_pool_allocate(&cur->base);
+    size_class->sub_pools = NULL;
+    size_class->partial = NULL;
+    size_class->empty_count = 0;
+}
 
-    while (cur && !ret)
+static void* size_class_allocate(PoolSizeClass* size_class, size_t count)
+{
+    if (!size_class->partial && !sub_pool_ctor(size_class, count))
     {
-        prev = cur;
-        cur = (SecondLevelPool*)cur->next_pool_same_size;
-        ret = sub_pool_allocate((SubPool*)cur);
+        return NULL;
     }
 
-    if (ret)
+    SubPool* sp = size_class->partial;
+    if (sp->live == 0)
     {
-        return ret;
+        size_class->empty_count--;
     }
 
-    SecondLevelPool* new_pool = second_level_ctor(count, elem_size, 0);
+    void* ret = sub_pool_allocate(sp);
 
-    ret = sub_pool_allocate((SubPool*)new_pool);
-    prev->next_pool_same_size = new_pool;
+    if (sub_pool_is_full(sp))
+    {
+        size_class_unlink_partial(size_class, sp);
+    }
 
     return ret;
 }
 
-static void* first_level_allocate(FirstLevelPool* pool, size_t count)
+/**
+ * Fills ptrs from the partial subpools of the class, creating subpools of
+ * count blocks when they run out.
+ *
+ * @return number of blocks allocated.
+ */
+static size_t size_class_allocate_bulk(PoolSizeClass* size_class,
+    size_t count,
+    void** ptrs,
+    size_t ptr_count)
 {
-    return second_level_allocate(&pool->base, count, pool->elem_size);
+    size_t allocated = 0;
+
+    while (allocated < ptr_count)
+    {
+        if (!size_class->partial && !sub_pool_ctor(size_class, count))
+        {
+            break;
+        }
+
+        SubPool* sp = size_class->partial;
+        if (sp->live == 0)
+        {
+            size_class->empty_count--;
+        }
+
+        allocated +=
+            sub_pool_allocate_run(sp, ptrs + allocated, ptr_count - allocated);
+
+        if (sub_pool_is_full(sp))
+        {
+            size_class_unlink_partial(size_class, sp);
+        }
+    }
+
+    return allocated;
 }
 
-static SubPool* find_sub_pool_containing_ptr(Pool* pool, void* ptr)
+static void size_class_push_partial(PoolSizeClass* size_class, SubPool* pool)
 {
-    FirstLevelPool* cur_f = pool->pool;
+    pool->prev_partial = NULL;
+    pool->next_partial = size_class->partial;
+    if (pool->next_partial)
+    {
+        pool->next_partial->prev_partial = pool;
+    }
+    size_class->partial = pool;
+}
 
-    char* p = (char*)ptr;
+static void size_class_unlink_partial(PoolSizeClass* size_class, SubPool* pool)
+{
+    if (pool->prev_partial)
+    {
+        pool->prev_partial->next_partial = pool->next_partial;
+    }
+    else if (size_class->partial == pool)
+    {
+        size_class->partial = pool->next_partial;
+    }
+    else
+    {
+        return;
+    }
 
-    while (cur_f)
+    if (pool->next_partial)
     {
-        char* start = (char*)(cur_f + 1);
-        char* end = start + pool->count * cur_f->elem_size;
+        pool->next_partial->prev_partial = pool->prev_partial;
+    }
+    pool->prev_partial = NULL;
+    pool->next_partial = NULL;
+}
 
-        if (start <= p && p < end)
+/**
+ * Releases empty subpools of the class until at most retained of them are
+ * left.
+ *
+ * @return number of released subpools.
+ */
+static size_t size_class_trim(PoolSizeClass* size_class, size_t retained)
+{
+    size_t released = 0;
+    SubPool* cur = size_class->sub_pools;
+
+    while (cur && size_class->empty_count > retained)
+    {
+        SubPool* next = cur->next;
+        if (cur->live == 0)
         {
-            return (SubPool*)cur_f;
+            sub_pool_dtor(cur);
+            released++;
         }
+        cur = next;
+    }
 
-        SecondLevelPool* cur_s =
-            (SecondLevelPool*)cur_f->base.next_pool_same_size;
+    return released;
+}
 
-        while (cur_s)
+/**
+ * Faults in the slabs of all subpools of the class.
+ *
+ * @return false if a slab could not be locked.
+ */
+static bool size_class_prefault(PoolSizeClass* size_class, bool lock)
+{
+    bool ok = true;
+
+    for (SubPool* cur = size_class->sub_pools; cur; cur = cur->next)
+    {
+        if (cmlib_details_prefault(cur, cur->slab_size, lock))
+        {
+            cur->locked |= lock;
+        }
+        else
         {
-            start = (char*)(cur_s + 1);
-            end = start + pool->count * cur_f->elem_size;
+            ok = false;
+        }
+    }
+
+    return ok;
+}
 
-            if (start <= p && p < end)
-            {
-                return (SubPool*)cur_s;
-            }
+/**
+ * Finds the class of blocks of elem_size, registering a new large class if
+ * there is none yet.
+ */
+static PoolSizeClass* pool_get_size_class(Pool* pool, size_t elem_size)
+{
+    if (elem_size <= POOL_SMALL_CLASS_MAX)
+    {
+        return &pool->small_classes[elem_size / POOL_CLASS_GRANULARITY - 1];
+    }
 
-            cur_s = cur_s->next_pool_same_size;
+    PoolSizeClass** bucket = &pool->large_classes[pool_large_bucket(elem_size)];
+
+    for (PoolSizeClass* cur = *bucket; cur; cur = cur->next)
+    {
+        if (cur->elem_size == elem_size)
+        {
+            return cur;
         }
+    }
+
+    PoolSizeClass* size_class = cmlib_details_malloc(sizeof(PoolSizeClass));
+    if (!size_class)
+    {
+        return NULL;
+    }
+
+    *size_class = (PoolSizeClass) {
+        .elem_size = elem_size,
+        .next = *bucket,
+        .huge_pages = pool->huge_pages,
+    };
+    *bucket = size_class;
+
+    return size_class;
+}
+
+static size_t pool_large_bucket(size_t elem_size)
+{
+    return POOL_LARGE_BUCKET_COUNT - 1 - (size_t)__builtin_clzl(elem_size);
+}
+
+static size_t pool_block_alignment(size_t elem_size)
+{
+    return MIN(elem_size & -elem_size, POOL_MAX_ALIGNMENT);
+}
 
-        cur_f = cur_f->next_pool_dif_size;
+/**
+ * Number of blocks starting at offset that fit into the slab unit containing
+ * offset. A block larger than the rest of the unit takes the whole unit and
+ * spills over the following ones.
+ */
+static size_t sub_pool_unit_capacity(size_t offset, size_t elem_size)
+{
+    size_t unit_end =
+        offset - offset % POOL_SLAB_ALIGNMENT + POOL_SLAB_ALIGNMENT;
+
+    if (offset + elem_size > unit_end)
+    {
+        return 1;
     }
 
-    return NULL;
+    return (unit_end - offset) / elem_size;
 }
 
-static FindResult find_first_level_by_size(FirstLevelPool* pool,
-    size_t elem_size)
+static size_t
+sub_pool_slab_size(size_t count, size_t elem_size, size_t meta_size)
 {
-    FirstLevelPool* prev = NULL;
-    FirstLevelPool* cur = pool;
+    size_t alignment = pool_block_alignment(elem_size);
+    size_t tag_size = align_size(sizeof(PoolSlabTag), alignment);
+    size_t offset = align_size(meta_size, alignment);
 
-    while (cur && cur->elem_size != elem_size)
+    for (;;)
     {
-        prev = cur;
-        cur = cur->next_pool_dif_size;
+        size_t fit = sub_pool_unit_capacity(offset, elem_size);
+        if (fit >= count)
+        {
+            // aligned_alloc expects a multiple of the alignment
+            return align_size(offset + count * elem_size, POOL_SLAB_ALIGNMENT);
+        }
+
+        count -= fit;
+        offset = align_size(offset + fit * elem_size, POOL_SLAB_ALIGNMENT)
+            + tag_size;
     }
+}
 
-    return (FindResult) {prev, cur};
+/**
+ * Number of blocks that fit into a slab of slab_size bytes, the inverse of
+ * sub_pool_slab_size.
+ */
+static size_t
+sub_pool_slab_count(size_t slab_size, size_t elem_size, size_t meta_size)
+{
+    size_t alignment = pool_block_alignment(elem_size);
+    size_t tag_size = align_size(sizeof(PoolSlabTag), alignment);
+    size_t offset = align_size(meta_size, alignment);
+    size_t count = 0;
+
+    for (;;)
+    {
+        size_t fit = sub_pool_unit_capacity(offset, elem_size);
+        if (offset >= slab_size || fit * elem_size > slab_size - offset)
+        {
+            return count;
+        }
+
+        count += fit;
+        offset = align_size(offset + fit * elem_size, POOL_SLAB_ALIGNMENT)
+            + tag_size;
+    }
+}
+
+static SubPool* find_sub_pool_containing_ptr(void* ptr)
+{
+    auto tag = (PoolSlabTag*)((uintptr_t)ptr & ~(POOL_SLAB_ALIGNMENT - 1));
+    return tag->sub_pool;
 }
@@ -5,6 +5,13 @@ DECLARE_RESULT_SOURCE(PoolResource);
 static void*
 pool_resource_allocate(void* resource, size_t size, size_t alignment);
 static void pool_resource_deallocate(void* resource, void* ptr);
+static size_t pool_resource_allocate_bulk(void* resource,
+    size_t size,
+    size_t alignment,
+    size_t count,
+    void** ptrs);
+static void
+pool_resource_deallocate_bulk(void* resource, void** ptrs, size_t count);
 
 Result_PoolResource pool_resource_ctor(size_t count)
 {
@@ -17,6 +24,30 @@ Result_PoolResource pool_resource_ctor(size_t count)
     return Result_PoolResource_ctor(pool_to_resource(pool), EVERYTHING_FINE);
 }
 
+Result_PoolResource pool_resource_ctor_classes(size_t count,
+    const size_t* elem_sizes,
+    size_t class_count)
+{
+    Pool* pool = pool_ctor_classes(count, elem_sizes, class_count);
+    if (!pool)
+    {
+        return Result_PoolResource_ctor((PoolResource) {}, ERROR_NULLPTR);
+    }
+
+    return Result_PoolResource_ctor(pool_to_resource(pool), EVERYTHING_FINE);
+}
+
+Result_PoolResource pool_resource_ctor_huge(size_t count)
+{
+    Pool* pool = pool_ctor_huge(count);
+    if (!pool)
+    {
+        return Result_PoolResource_ctor((PoolResource) {}, ERROR_NULLPTR);
+    }
+
+    return Result_PoolResource_ctor(pool_to_resource(pool), EVERYTHING_FINE);
+}
+
 PoolResource pool_to_resource(Pool* pool)
 {
     if (!pool)
@@ -29,6 +60,8 @@ PoolResource pool_to_resource(Pool* pool)
             (MemoryResource) {
                 .allocate = pool_resource_allocate,
                 .deallocate = pool_resource_deallocate,
+                .allocate_bulk = pool_resource_allocate_bulk,
+                .deallocate_bulk = pool_resource_deallocate_bulk,
             },
         .pool = pool,
     };
@@ -58,3 +91,22 @@ static void pool_resource_deallocate(void* resource, void* ptr)
     PoolResource* pr = (PoolResource*)(resource);
     return pool_deallocate(pr->pool, ptr);
 }
+
+static size_t pool_resource_allocate_bulk(void* resource,
+    size_t size,
+    size_t alignment,
+    size_t count,
+    void** ptrs)
+{
+    assert(resource);
+    PoolResource* pr = (PoolResource*)(resource);
+    return pool_allocate_bulk(pr->pool, size, alignment, count, ptrs);
+}
+
+static void
+pool_resource_deallocate_bulk(void* resource, void** ptrs, size_t count)
+{
+    assert(resource);
+    PoolResource* pr = (PoolResource*)(resource);
+    pool_deallocate_bulk(pr->pool, ptrs, count);
+}
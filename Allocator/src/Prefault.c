@@ -0,0 +1,67 @@
+#include "details/Prefault.h"
+
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "Allocator.h"
+
+static void prefault_touch(char* begin, char* end, size_t page_size);
+
+bool cmlib_details_prefault(void* ptr, size_t size, bool lock)
+{
+    if (!ptr || size == 0)
+    {
+        return true;
+    }
+
+    if (lock)
+    {
+        // mlock faults the pages in by itself
+        return mlock(ptr, size) == 0;
+    }
+
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    char* begin = ptr;
+    char* end = begin + size;
+
+#ifdef MADV_POPULATE_WRITE
+    // populates whole pages in one call instead of a fault per page
+    char* first_page = align_ptr(begin, page_size);
+    char* last_page = (char*)((uintptr_t)end & ~(page_size - 1));
+    if (first_page < last_page
+        && madvise(first_page,
+               (size_t)(last_page - first_page),
+               MADV_POPULATE_WRITE)
+            == 0)
+    {
+        prefault_touch(begin, first_page, page_size);
+        prefault_touch(last_page, end, page_size);
+        return true;
+    }
+#endif
+
+    prefault_touch(begin, end, page_size);
+
+    return true;
+}
+
+void cmlib_details_unlock(void* ptr, size_t size)
+{
+    if (ptr && size)
+    {
+        munlock(ptr, size);
+    }
+}
+
+/**
+ * Writes the first byte of every page in [begin, end) back to itself.
+ */
+static void prefault_touch(char* begin, char* end, size_t page_size)
+{
+    for (char* page = begin; page < end; page = align_ptr(page + 1, page_size))
+    {
+        volatile char* byte = page;
+        *byte = *byte;
+    }
+}
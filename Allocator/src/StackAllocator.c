@@ -0,0 +1,198 @@
+#include "StackAllocator.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "Allocator.h"
+#include "details/CountingMalloc.h"
+
+/**
+ * Header in front of every block. Headers are aligned to 8 bytes, so the low
+ * bit of prev is free to mark a block freed out of order.
+ */
+typedef struct StackHeader StackHeader;
+struct StackHeader
+{
+    char* prev_top; /**< Top of the stack before the allocation. */
+    uintptr_t prev; /**< Header of the previous block | STACK_FREED. */
+};
+
+static constexpr uintptr_t STACK_FREED = 1;
+
+struct StackAllocator
+{
+    char* buffer;      /**< Start of owned storage. */
+    char* top;         /**< Next available byte. */
+    char* end;         /**< One-past-end pointer. */
+    StackHeader* last; /**< Header of the top block. */
+};
+
+static void stack_allocator_pop(StackAllocator* stack);
+static StackHeader* stack_header(void* ptr);
+static StackHeader* stack_header_prev(const StackHeader* header);
+
+StackAllocator* stack_allocator_ctor(size_t capacity)
+{
+    if (capacity == 0)
+    {
+        return NULL;
+    }
+
+    StackAllocator* stack =
+        cmlib_details_malloc(sizeof(StackAllocator) + capacity);
+    if (!stack)
+    {
+        return NULL;
+    }
+
+    char* buf = (char*)(stack + 1);
+
+    *stack = (StackAllocator) {
+        .buffer = buf,
+        .top = buf,
+        .end = buf + capacity,
+    };
+
+    return stack;
+}
+
+void stack_allocator_dtor(StackAllocator* stack)
+{
+    cmlib_details_free(stack);
+}
+
+void* stack_allocator_allocate(StackAllocator* stack,
+    size_t size,
+    size_t alignment)
+{
+    if (!stack || size == 0 || alignment == 0)
+    {
+        return NULL;
+    }
+
+    alignment = MAX(alignment, alignof(StackHeader));
+
+    char* allocated_ptr =
+        align_ptr(stack->top + sizeof(StackHeader), alignment);
+
+    if (allocated_ptr > stack->end
+        || size > (size_t)(stack->end - allocated_ptr))
+    {
+        return NULL;
+    }
+
+    StackHeader* header = stack_header(allocated_ptr);
+    *header = (StackHeader) {
+        .prev_top = stack->top,
+        .prev = (uintptr_t)stack->last,
+    };
+
+    stack->last = header;
+    stack->top = allocated_ptr + size;
+
+    return allocated_ptr;
+}
+
+void* stack_allocator_reallocate(StackAllocator* stack,
+    void* ptr,
+    size_t old_size,
+    size_t new_size,
+    size_t alignment)
+{
+    if (!ptr)
+    {
+        return stack_allocator_allocate(stack, new_size, alignment);
+    }
+
+    if (!stack || new_size == 0 || alignment == 0)
+    {
+        return NULL;
+    }
+
+    char* block = ptr;
+
+    if (stack_header(ptr) == stack->last && (uintptr_t)ptr % alignment == 0
+        && new_size <= (size_t)(stack->end - block))
+    {
+        stack->top = block + new_size;
+        return ptr;
+    }
+
+    void* new_ptr = stack_allocator_allocate(stack, new_size, alignment);
+    if (!new_ptr)
+    {
+        return NULL;
+    }
+
+    memcpy(new_ptr, ptr, MIN(old_size, new_size));
+    stack_allocator_deallocate(stack, ptr);
+
+    return new_ptr;
+}
+
+void stack_allocator_deallocate(StackAllocator* stack, void* ptr)
+{
+    if (!stack || !ptr)
+    {
+        return;
+    }
+
+    StackHeader* header = stack_header(ptr);
+
+    assert((char*)ptr > stack->buffer && (char*)ptr <= stack->top);
+    assert(!(header->prev & STACK_FREED) && "block freed twice");
+
+    if (header != stack->last)
+    {
+        header->prev |= STACK_FREED;
+        return;
+    }
+
+    stack_allocator_pop(stack);
+    while (stack->last && stack->last->prev & STACK_FREED)
+    {
+        stack_allocator_pop(stack);
+    }
+}
+
+void stack_allocator_clear(StackAllocator* stack)
+{
+    if (!stack)
+    {
+        return;
+    }
+
+    stack->top = stack->buffer;
+    stack->last = NULL;
+}
+
+size_t stack_allocator_used(const StackAllocator* stack)
+{
+    if (!stack)
+    {
+        return 0;
+    }
+
+    return (size_t)(stack->top - stack->buffer);
+}
+
+/**
+ * Drops the top block, making the one below it the top.
+ */
+static void stack_allocator_pop(StackAllocator* stack)
+{
+    StackHeader* header = stack->last;
+    stack->top = header->prev_top;
+    stack->last = stack_header_prev(header);
+}
+
+static StackHeader* stack_header(void* ptr)
+{
+    return (StackHeader*)ptr - 1;
+}
+
+static StackHeader* stack_header_prev(const StackHeader* header)
+{
+    return (StackHeader*)(header->prev & ~STACK_FREED);
+}
@@ -0,0 +1,81 @@
+#include "StackResource.h"
+
+DECLARE_RESULT_SOURCE(StackResource);
+
+static void*
+stack_resource_allocate(void* resource, size_t size, size_t alignment);
+static void stack_resource_deallocate(void* resource, void* ptr);
+static void* stack_resource_reallocate(void* resource,
+    void* ptr,
+    size_t old_size,
+    size_t new_size,
+    size_t alignment);
+
+Result_StackResource stack_resource_ctor(size_t capacity)
+{
+    StackAllocator* stack = stack_allocator_ctor(capacity);
+    if (!stack)
+    {
+        return Result_StackResource_ctor((StackResource) {}, ERROR_NULLPTR);
+    }
+
+    return Result_StackResource_ctor(stack_to_resource(stack), EVERYTHING_FINE);
+}
+
+StackResource stack_to_resource(StackAllocator* stack)
+{
+    if (!stack)
+    {
+        return (StackResource) {};
+    }
+
+    return (StackResource) {
+        .base =
+            (MemoryResource) {
+                .allocate = stack_resource_allocate,
+                .deallocate = stack_resource_deallocate,
+                .reallocate = stack_resource_reallocate,
+            },
+        .stack = stack,
+    };
+}
+
+void stack_resource_dtor(StackResource* resource)
+{
+    if (!resource)
+    {
+        return;
+    }
+
+    stack_allocator_dtor(resource->stack);
+}
+
+static void*
+stack_resource_allocate(void* resource, size_t size, size_t alignment)
+{
+    assert(resource);
+    StackResource* sr = (StackResource*)resource;
+    return stack_allocator_allocate(sr->stack, size, alignment);
+}
+
+static void stack_resource_deallocate(void* resource, void* ptr)
+{
+    assert(resource);
+    StackResource* sr = (StackResource*)resource;
+    stack_allocator_deallocate(sr->stack, ptr);
+}
+
+static void* stack_resource_reallocate(void* resource,
+    void* ptr,
+    size_t old_size,
+    size_t new_size,
+    size_t alignment)
+{
+    assert(resource);
+    StackResource* sr = (StackResource*)resource;
+    return stack_allocator_reallocate(sr->stack,
+        ptr,
+        old_size,
+        new_size,
+        alignment);
+}
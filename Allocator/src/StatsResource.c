@@ -0,0 +1,502 @@
+#include "StatsResource.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "details/CountingMalloc.h"
+#include "details/ThreadCounters.h"
+
+DECLARE_RESULT_SOURCE(StatsResource);
+
+/**
+ * A thread adds its live byte changes to the shared live counter, and checks
+ * the peak, only once they add up to STATS_PEAK_BATCH in either direction.
+ */
+static constexpr size_t STATS_PEAK_BATCH = 64 * 1024;
+
+typedef struct StatsBlockHeader
+{
+    size_t size;
+    size_t alignment; /**< Alignment of the upstream block. */
+} StatsBlockHeader;
+
+typedef enum StatsEvent
+{
+    STATS_ALLOCATION,
+    STATS_FREE,
+    STATS_REALLOCATION,
+    STATS_FAILURE,
+} StatsEvent;
+
+/**
+ * Counters of a thread, indices into the counters the registry hands out.
+ * Requested sizes and alignments take a run of bucket counters each.
+ */
+typedef enum StatsCounter
+{
+    STATS_ALLOCATIONS,
+    STATS_FREES,
+    STATS_REALLOCATIONS,
+    STATS_FAILURES,
+    STATS_ALLOCATED_BYTES,
+    STATS_FREED_BYTES,
+    STATS_PENDING, /**< Live byte change not flushed yet. */
+    STATS_SIZES,
+    STATS_ALIGNMENTS = STATS_SIZES + CMLIB_STATS_SIZE_BUCKET_COUNT,
+    STATS_COUNTER_COUNT = STATS_ALIGNMENTS + CMLIB_STATS_ALIGNMENT_BUCKET_COUNT,
+} StatsCounter;
+
+struct StatsState
+{
+    ThreadCounters* counters;
+    atomic_size_t live; /**< Live bytes flushed by all threads. */
+    atomic_size_t peak;
+};
+
+static void* stats_resource_allocate(void* resource,
+    size_t size,
+    size_t alignment);
+static void stats_resource_deallocate(void* resource, void* ptr);
+static void* stats_resource_reallocate(void* resource,
+    void* ptr,
+    size_t old_size,
+    size_t new_size,
+    size_t alignment);
+
+static void stats_record(StatsState* state,
+    StatsEvent event,
+    size_t old_size,
+    size_t new_size,
+    size_t alignment);
+static void stats_flush(StatsState* state, size_t change);
+
+static void stats_thread_exit(void* state, atomic_size_t* counters);
+
+static void counters_record(atomic_size_t* counters,
+    StatsEvent event,
+    size_t old_size,
+    size_t new_size,
+    size_t alignment);
+static void counters_sum(MemoryStats* stats, const size_t* sums);
+
+static size_t stats_header_offset(size_t alignment);
+static size_t stats_size_bucket(size_t size);
+static size_t stats_alignment_bucket(size_t alignment);
+
+Result_StatsResource stats_resource_ctor(MemoryResource* upstream)
+{
+    if (!upstream)
+    {
+        return Result_StatsResource_ctor((StatsResource) {}, ERROR_NULLPTR);
+    }
+
+    StatsState* state = cmlib_details_calloc(1, sizeof(StatsState));
+    if (!state)
+    {
+        return Result_StatsResource_ctor((StatsResource) {}, ERROR_NO_MEMORY);
+    }
+
+    state->counters = cmlib_details_thread_counters_ctor(STATS_COUNTER_COUNT,
+        stats_thread_exit,
+        state);
+    if (!state->counters)
+    {
+        cmlib_details_free(state);
+        return Result_StatsResource_ctor((StatsResource) {}, ERROR_NO_MEMORY);
+    }
+
+    return Result_StatsResource_ctor(
+        (StatsResource) {
+            .base =
+                (MemoryResource) {
+                    .allocate = stats_resource_allocate,
+                    .deallocate = stats_resource_deallocate,
+                    .reallocate = stats_resource_reallocate,
+                },
+            .upstream = upstream,
+            .state = state,
+        },
+        EVERYTHING_FINE);
+}
+
+void stats_resource_dtor(StatsResource* resource)
+{
+    if (!resource || !resource->state)
+    {
+        return;
+    }
+
+    StatsState* state = resource->state;
+
+    cmlib_details_thread_counters_dtor(state->counters);
+    cmlib_details_free(state);
+
+    resource->state = NULL;
+}
+
+MemoryStats stats_resource_collect(const StatsResource* resource)
+{
+    MemoryStats stats = {};
+
+    if (!resource || !resource->state)
+    {
+        return stats;
+    }
+
+    StatsState* state = resource->state;
+
+    size_t sums[STATS_COUNTER_COUNT] = {};
+    cmlib_details_thread_counters_sum(state->counters, sums);
+    counters_sum(&stats, sums);
+
+    stats.peak_bytes =
+        MAX(cmlib_details_counter_load(&state->peak), stats.live_bytes);
+
+    return stats;
+}
+
+void memory_stats_dump(const MemoryStats* stats, FILE* out)
+{
+    if (!stats || !out)
+    {
+        return;
+    }
+
+    fprintf(out, "allocations:   %zu\n", stats->allocations);
+    fprintf(out, "frees:         %zu\n", stats->frees);
+    fprintf(out, "reallocations: %zu\n", stats->reallocations);
+    fprintf(out, "failures:      %zu\n", stats->failures);
+    fprintf(out, "live bytes:    %zu\n", stats->live_bytes);
+    fprintf(out, "peak bytes:    %zu\n", stats->peak_bytes);
+
+    fprintf(out, "sizes:\n");
+    for (size_t i = 0; i < CMLIB_STATS_SIZE_BUCKET_COUNT; i++)
+    {
+        if (stats->sizes[i])
+        {
+            fprintf(out, "  <= 2^%-2zu %zu\n", i, stats->sizes[i]);
+        }
+    }
+
+    fprintf(out, "alignments:\n");
+    for (size_t i = 0; i < CMLIB_STATS_ALIGNMENT_BUCKET_COUNT; i++)
+    {
+        if (stats->alignments[i])
+        {
+            fprintf(out, "  %-7zu %zu\n", (size_t)1 << i, stats->alignments[i]);
+        }
+    }
+}
+
+void memory_stats_dump_json(const MemoryStats* stats, FILE* out)
+{
+    if (!stats || !out)
+    {
+        return;
+    }
+
+    fprintf(out,
+        "{\"allocations\": %zu, \"frees\": %zu, \"reallocations\": %zu, "
+        "\"failures\": %zu, \"live_bytes\": %zu, \"peak_bytes\": %zu, ",
+        stats->allocations,
+        stats->frees,
+        stats->reallocations,
+        stats->failures,
+        stats->live_bytes,
+        stats->peak_bytes);
+
+    fprintf(out, "\"sizes\": [");
+    const char* separator = "";
+    for (size_t i = 0; i < CMLIB_STATS_SIZE_BUCKET_COUNT; i++)
+    {
+        if (stats->sizes[i])
+        {
+            fprintf(out,
+                "%s{\"max_log2\": %zu, \"count\": %zu}",
+                separator,
+                i,
+                stats->sizes[i]);
+            separator = ", ";
+        }
+    }
+
+    fprintf(out, "], \"alignments\": [");
+    separator = "";
+    for (size_t i = 0; i < CMLIB_STATS_ALIGNMENT_BUCKET_COUNT; i++)
+    {
+        if (stats->alignments[i])
+        {
+            fprintf(out,
+                "%s{\"alignment\": %zu, \"count\": %zu}",
+                separator,
+                (size_t)1 << i,
+                stats->alignments[i]);
+            separator = ", ";
+        }
+    }
+
+    fprintf(out, "]}\n");
+}
+
+static void* stats_resource_allocate(void* resource,
+    size_t size,
+    size_t alignment)
+{
+    assert(resource);
+    StatsResource* sr = (StatsResource*)resource;
+
+    size_t upstream_alignment = MAX(alignment, alignof(StatsBlockHeader));
+    size_t offset = stats_header_offset(upstream_alignment);
+
+    MemoryResource* upstream = sr->upstream;
+    char* block = size <= SIZE_MAX - offset
+        ? upstream->allocate(upstream, size + offset, upstream_alignment)
+        : NULL;
+    if (!block)
+    {
+        stats_record(sr->state, STATS_FAILURE, 0, 0, 0);
+        return NULL;
+    }
+
+    StatsBlockHeader* header = (StatsBlockHeader*)(block + offset) - 1;
+    *header = (StatsBlockHeader) {
+        .size = size,
+        .alignment = upstream_alignment,
+    };
+
+    stats_record(sr->state, STATS_ALLOCATION, 0, size, alignment);
+
+    return block + offset;
+}
+
+static void stats_resource_deallocate(void* resource, void* ptr)
+{
+    assert(resource);
+    StatsResource* sr = (StatsResource*)resource;
+
+    if (!ptr)
+    {
+        return;
+    }
+
+    StatsBlockHeader header = ((StatsBlockHeader*)ptr)[-1];
+    size_t offset = stats_header_offset(header.alignment);
+
+    stats_record(sr->state, STATS_FREE, header.size, 0, 0);
+
+    memory_resource_deallocate_sized(sr->upstream,
+        (char*)ptr - offset,
+        header.size + offset,
+        header.alignment);
+}
+
+static void* stats_resource_reallocate(void* resource,
+    void* ptr,
+    size_t old_size,
+    size_t new_size,
+    size_t alignment)
+{
+    (void)old_size;
+    assert(resource);
+    StatsResource* sr = (StatsResource*)resource;
+
+    if (!ptr)
+    {
+        return stats_resource_allocate(resource, new_size, alignment);
+    }
+
+    StatsBlockHeader* header = (StatsBlockHeader*)ptr - 1;
+    size_t offset = stats_header_offset(header->alignment);
+
+    if (header->alignment != MAX(alignment, alignof(StatsBlockHeader)))
+    {
+        // the header offset depends on the alignment, so the block moves
+        void* new_ptr = stats_resource_allocate(resource, new_size, alignment);
+        if (new_ptr)
+        {
+            memcpy(new_ptr, ptr, MIN(header->size, new_size));
+            stats_resource_deallocate(resource, ptr);
+        }
+        return new_ptr;
+    }
+
+    char* block = new_size <= SIZE_MAX - offset
+        ? memory_resource_reallocate(sr->upstream,
+              (char*)ptr - offset,
+              header->size + offset,
+              new_size + offset,
+              header->alignment)
+        : NULL;
+    if (!block)
+    {
+        stats_record(sr->state, STATS_FAILURE, 0, 0, 0);
+        return NULL;
+    }
+
+    header = (StatsBlockHeader*)(block + offset) - 1;
+    stats_record(sr->state, STATS_REALLOCATION, header->size, new_size, 0);
+    header->size = new_size;
+
+    return block + offset;
+}
+
+/**
+ * Counts an event in the counters of the calling thread, or in the retired
+ * counters if the thread has none.
+ */
+static void stats_record(StatsState* state,
+    StatsEvent event,
+    size_t old_size,
+    size_t new_size,
+    size_t alignment)
+{
+    atomic_size_t* counters =
+        cmlib_details_thread_counters_get(state->counters);
+    if (!counters)
+    {
+        counters_record(
+            cmlib_details_thread_counters_lock_retired(state->counters),
+            event,
+            old_size,
+            new_size,
+            alignment);
+        cmlib_details_thread_counters_unlock_retired(state->counters);
+
+        stats_flush(state, new_size - old_size);
+        return;
+    }
+
+    counters_record(counters, event, old_size, new_size, alignment);
+
+    size_t pending = cmlib_details_counter_load(&counters[STATS_PENDING])
+        + new_size - old_size;
+    if ((ptrdiff_t)pending >= (ptrdiff_t)STATS_PEAK_BATCH
+        || (ptrdiff_t)pending <= -(ptrdiff_t)STATS_PEAK_BATCH)
+    {
+        stats_flush(state, pending);
+        pending = 0;
+    }
+    atomic_store_explicit(&counters[STATS_PENDING],
+        pending,
+        memory_order_relaxed);
+}
+
+/**
+ * Adds a live byte change to the shared live counter and raises the peak if
+ * it was exceeded.
+ */
+static void stats_flush(StatsState* state, size_t change)
+{
+    size_t live =
+        atomic_fetch_add_explicit(&state->live, change, memory_order_relaxed)
+        + change;
+
+    // frees of blocks other threads have not flushed yet go below zero
+    if ((ptrdiff_t)live <= 0)
+    {
+        return;
+    }
+
+    size_t peak = atomic_load_explicit(&state->peak, memory_order_relaxed);
+    while (peak < live
+        && !atomic_compare_exchange_weak_explicit(&state->peak,
+            &peak,
+            live,
+            memory_order_relaxed,
+            memory_order_relaxed))
+    {
+    }
+}
+
+/**
+ * Runs at thread exit, before the counters of the thread are retired:
+ * flushes the live byte change the thread has not flushed yet.
+ */
+static void stats_thread_exit(void* state, atomic_size_t* counters)
+{
+    stats_flush(state, cmlib_details_counter_load(&counters[STATS_PENDING]));
+    atomic_store_explicit(&counters[STATS_PENDING], 0, memory_order_relaxed);
+}
+
+static void counters_record(atomic_size_t* counters,
+    StatsEvent event,
+    size_t old_size,
+    size_t new_size,
+    size_t alignment)
+{
+    switch (event)
+    {
+        case STATS_ALLOCATION:
+            cmlib_details_counter_add(&counters[STATS_ALLOCATIONS], 1);
+            cmlib_details_counter_add(
+                &counters[STATS_SIZES + stats_size_bucket(new_size)],
+                1);
+            cmlib_details_counter_add(
+                &counters[STATS_ALIGNMENTS + stats_alignment_bucket(alignment)],
+                1);
+            break;
+
+        case STATS_FREE:
+            cmlib_details_counter_add(&counters[STATS_FREES], 1);
+            break;
+
+        case STATS_REALLOCATION:
+            cmlib_details_counter_add(&counters[STATS_REALLOCATIONS], 1);
+            break;
+
+        case STATS_FAILURE:
+            cmlib_details_counter_add(&counters[STATS_FAILURES], 1);
+            break;
+    }
+
+    cmlib_details_counter_add(&counters[STATS_ALLOCATED_BYTES], new_size);
+    cmlib_details_counter_add(&counters[STATS_FREED_BYTES], old_size);
+}
+
+static void counters_sum(MemoryStats* stats, const size_t* sums)
+{
+    stats->allocations = sums[STATS_ALLOCATIONS];
+    stats->frees = sums[STATS_FREES];
+    stats->reallocations = sums[STATS_REALLOCATIONS];
+    stats->failures = sums[STATS_FAILURES];
+    stats->live_bytes = sums[STATS_ALLOCATED_BYTES] - sums[STATS_FREED_BYTES];
+
+    for (size_t i = 0; i < CMLIB_STATS_SIZE_BUCKET_COUNT; i++)
+    {
+        stats->sizes[i] = sums[STATS_SIZES + i];
+    }
+    for (size_t i = 0; i < CMLIB_STATS_ALIGNMENT_BUCKET_COUNT; i++)
+    {
+        stats->alignments[i] = sums[STATS_ALIGNMENTS + i];
+    }
+}
+
+/**
+ * Distance from the upstream block to the payload. The header sits right
+ * before the payload.
+ */
+static size_t stats_header_offset(size_t alignment)
+{
+    return align_size(sizeof(StatsBlockHeader), alignment);
+}
+
+static size_t stats_size_bucket(size_t size)
+{
+    if (size <= 1)
+    {
+        return 0;
+    }
+
+    return sizeof(size_t) * CHAR_BIT - (size_t)__builtin_clzl(size - 1);
+}
+
+static size_t stats_alignment_bucket(size_t alignment)
+{
+    if (alignment == 0)
+    {
+        return 0;
+    }
+
+    return (size_t)__builtin_ctzl(alignment);
+}
@@ -0,0 +1,218 @@
+#include "details/ThreadCounters.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#include "Allocator.h"
+
+static constexpr size_t THREAD_COUNTERS_CACHE_LINE = 64;
+
+/**
+ * Counters of one thread. They start on a cache line of their own and the
+ * block is rounded up to whole cache lines, so threads counting at the same
+ * time do not invalidate each other's lines.
+ */
+typedef struct ThreadCounterBlock ThreadCounterBlock;
+struct ThreadCounterBlock
+{
+    ThreadCounters* registry;
+    ThreadCounterBlock *prev, *next; /**< Counters of all running threads. */
+    alignas(THREAD_COUNTERS_CACHE_LINE) atomic_size_t counters[];
+};
+
+struct ThreadCounters
+{
+    mtx_t lock; /**< Guards threads and retired. */
+    tss_t thread_key;
+    size_t count;
+    thread_counters_exit_t on_exit;
+    void* context;
+    ThreadCounterBlock* threads;
+    atomic_size_t retired[]; /**< Counters of exited threads. */
+};
+
+void cmlib_details_counter_add(atomic_size_t* counter, size_t value);
+size_t cmlib_details_counter_load(const atomic_size_t* counter);
+
+static void thread_counters_block_dtor(void* block);
+static void thread_counters_unlink(ThreadCounterBlock* block);
+
+ThreadCounters* cmlib_details_thread_counters_ctor(size_t count,
+    thread_counters_exit_t on_exit,
+    void* context)
+{
+    if (count == 0)
+    {
+        return NULL;
+    }
+
+    ThreadCounters* registry =
+        calloc(1, sizeof(ThreadCounters) + count * sizeof(atomic_size_t));
+    if (!registry)
+    {
+        return NULL;
+    }
+
+    if (mtx_init(&registry->lock, mtx_plain) != thrd_success)
+    {
+        free(registry);
+        return NULL;
+    }
+
+    if (tss_create(&registry->thread_key, thread_counters_block_dtor)
+        != thrd_success)
+    {
+        mtx_destroy(&registry->lock);
+        free(registry);
+        return NULL;
+    }
+
+    registry->count = count;
+    registry->on_exit = on_exit;
+    registry->context = context;
+
+    return registry;
+}
+
+void cmlib_details_thread_counters_dtor(ThreadCounters* registry)
+{
+    if (!registry)
+    {
+        return;
+    }
+
+    tss_delete(registry->thread_key);
+
+    ThreadCounterBlock* cur = registry->threads;
+    while (cur)
+    {
+        ThreadCounterBlock* next = cur->next;
+        free(cur);
+        cur = next;
+    }
+
+    mtx_destroy(&registry->lock);
+    free(registry);
+}
+
+atomic_size_t* cmlib_details_thread_counters_get(ThreadCounters* registry)
+{
+    ThreadCounterBlock* block = tss_get(registry->thread_key);
+    if (block)
+    {
+        return block->counters;
+    }
+
+    size_t size = align_size(sizeof(ThreadCounterBlock)
+            + registry->count * sizeof(atomic_size_t),
+        THREAD_COUNTERS_CACHE_LINE);
+
+    block = aligned_alloc(THREAD_COUNTERS_CACHE_LINE, size);
+    if (!block)
+    {
+        return NULL;
+    }
+    memset(block, 0, size);
+    block->registry = registry;
+
+    mtx_lock(&registry->lock);
+    block->next = registry->threads;
+    if (block->next)
+    {
+        block->next->prev = block;
+    }
+    registry->threads = block;
+    mtx_unlock(&registry->lock);
+
+    if (tss_set(registry->thread_key, block) != thrd_success)
+    {
+        mtx_lock(&registry->lock);
+        thread_counters_unlink(block);
+        mtx_unlock(&registry->lock);
+
+        free(block);
+        return NULL;
+    }
+
+    return block->counters;
+}
+
+atomic_size_t*
+cmlib_details_thread_counters_lock_retired(ThreadCounters* registry)
+{
+    mtx_lock(&registry->lock);
+    return registry->retired;
+}
+
+void cmlib_details_thread_counters_unlock_retired(ThreadCounters* registry)
+{
+    mtx_unlock(&registry->lock);
+}
+
+void cmlib_details_thread_counters_sum(ThreadCounters* registry, size_t* sums)
+{
+    mtx_lock(&registry->lock);
+
+    for (size_t i = 0; i < registry->count; i++)
+    {
+        sums[i] = cmlib_details_counter_load(&registry->retired[i]);
+    }
+
+    for (ThreadCounterBlock* cur = registry->threads; cur; cur = cur->next)
+    {
+        for (size_t i = 0; i < registry->count; i++)
+        {
+            sums[i] += cmlib_details_counter_load(&cur->counters[i]);
+        }
+    }
+
+    mtx_unlock(&registry->lock);
+}
+
+/**
+ * Runs at thread exit: moves the counters of the thread into the retired
+ * ones and unregisters them. Destructors of other thread-specific data that
+ * run later register new counters.
+ */
+static void thread_counters_block_dtor(void* block)
+{
+    ThreadCounterBlock* tc = block;
+    ThreadCounters* registry = tc->registry;
+
+    if (registry->on_exit)
+    {
+        registry->on_exit(registry->context, tc->counters);
+    }
+
+    mtx_lock(&registry->lock);
+
+    for (size_t i = 0; i < registry->count; i++)
+    {
+        cmlib_details_counter_add(&registry->retired[i],
+            cmlib_details_counter_load(&tc->counters[i]));
+    }
+    thread_counters_unlink(tc);
+
+    mtx_unlock(&registry->lock);
+
+    free(tc);
+}
+
+static void thread_counters_unlink(ThreadCounterBlock* block)
+{
+    ThreadCounters* registry = block->registry;
+
+    if (block->prev)
+    {
+        block->prev->next = block->next;
+    }
+    else
+    {
+        registry->threads = block->next;
+    }
+    if (block->next)
+    {
+        block->next->prev = block->prev;
+    }
+}
@@ -0,0 +1,344 @@
+#include "TraceResource.h"
+
+#include <stdatomic.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+
+#include "details/CountingMalloc.h"
+
+DECLARE_RESULT_SOURCE(TraceResource);
+
+static const char TRACE_MAGIC[8] = "CMTRACE";
+static constexpr uint32_t TRACE_VERSION = 1;
+
+/**
+ * Records are collected in a stdio buffer of TRACE_BUFFER_SIZE bytes, so a
+ * write syscall covers thousands of them.
+ */
+static constexpr size_t TRACE_BUFFER_SIZE = 1024 * 1024;
+
+typedef struct TraceBlockHeader
+{
+    uint64_t id;
+    size_t size;
+    size_t alignment; /**< Alignment of the upstream block. */
+} TraceBlockHeader;
+
+struct TraceState
+{
+    FILE* file;
+    uint64_t start; /**< Monotonic time of the ctor in nanoseconds. */
+    atomic_uint_least64_t next_id;
+    atomic_bool failed; /**< Some record could not be written. */
+};
+
+/**
+ * Threads are numbered in the order they first record something in any
+ * trace.
+ */
+static atomic_uint_least16_t trace_thread_count;
+static thread_local uint16_t trace_thread;
+
+static void* trace_resource_allocate(void* resource,
+    size_t size,
+    size_t alignment);
+static void trace_resource_deallocate(void* resource, void* ptr);
+static void* trace_resource_reallocate(void* resource,
+    void* ptr,
+    size_t old_size,
+    size_t new_size,
+    size_t alignment);
+
+static void trace_write(TraceState* state,
+    TraceOp op,
+    uint64_t id,
+    size_t size,
+    size_t alignment);
+static uint64_t trace_now(void);
+static uint16_t trace_thread_number(void);
+static size_t trace_header_offset(size_t alignment);
+
+Result_TraceResource trace_resource_ctor(MemoryResource* upstream,
+    const char* path)
+{
+    if (!upstream || !path)
+    {
+        return Result_TraceResource_ctor((TraceResource) {}, ERROR_NULLPTR);
+    }
+
+    TraceState* state = cmlib_details_calloc(1, sizeof(TraceState));
+    if (!state)
+    {
+        return Result_TraceResource_ctor((TraceResource) {}, ERROR_NO_MEMORY);
+    }
+
+    state->file = fopen(path, "wb");
+    if (!state->file)
+    {
+        cmlib_details_free(state);
+        return Result_TraceResource_ctor((TraceResource) {}, ERROR_BAD_FILE);
+    }
+    setvbuf(state->file, NULL, _IOFBF, TRACE_BUFFER_SIZE);
+
+    TraceHeader header = {
+        .version = TRACE_VERSION,
+        .record_size = sizeof(TraceRecord),
+    };
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+
+    if (fwrite(&header, sizeof(header), 1, state->file) != 1)
+    {
+        fclose(state->file);
+        cmlib_details_free(state);
+        return Result_TraceResource_ctor((TraceResource) {}, ERROR_BAD_FILE);
+    }
+
+    state->start = trace_now();
+    atomic_init(&state->next_id, 1);
+
+    return Result_TraceResource_ctor(
+        (TraceResource) {
+            .base =
+                (MemoryResource) {
+                    .allocate = trace_resource_allocate,
+                    .deallocate = trace_resource_deallocate,
+                    .reallocate = trace_resource_reallocate,
+                },
+            .upstream = upstream,
+            .state = state,
+        },
+        EVERYTHING_FINE);
+}
+
+ErrorCode trace_resource_flush(TraceResource* resource)
+{
+    if (!resource || !resource->state)
+    {
+        return ERROR_NULLPTR;
+    }
+
+    TraceState* state = resource->state;
+
+    if (fflush(state->file) != 0)
+    {
+        atomic_store_explicit(&state->failed, true, memory_order_relaxed);
+    }
+
+    return atomic_load_explicit(&state->failed, memory_order_relaxed)
+        ? ERROR_BAD_FILE
+        : EVERYTHING_FINE;
+}
+
+void trace_resource_dtor(TraceResource* resource)
+{
+    if (!resource || !resource->state)
+    {
+        return;
+    }
+
+    fclose(resource->state->file);
+    cmlib_details_free(resource->state);
+
+    resource->state = NULL;
+}
+
+ErrorCode trace_read_header(FILE* file)
+{
+    if (!file)
+    {
+        return ERROR_NULLPTR;
+    }
+
+    TraceHeader header = {};
+    if (fread(&header, sizeof(header), 1, file) != 1
+        || memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0
+        || header.version != TRACE_VERSION
+        || header.record_size != sizeof(TraceRecord))
+    {
+        return ERROR_BAD_FILE;
+    }
+
+    return EVERYTHING_FINE;
+}
+
+static void* trace_resource_allocate(void* resource,
+    size_t size,
+    size_t alignment)
+{
+    assert(resource);
+    TraceResource* tr = (TraceResource*)resource;
+
+    size_t upstream_alignment = MAX(alignment, alignof(TraceBlockHeader));
+    size_t offset = trace_header_offset(upstream_alignment);
+
+    MemoryResource* upstream = tr->upstream;
+    char* block = size <= SIZE_MAX - offset
+        ? upstream->allocate(upstream, size + offset, upstream_alignment)
+        : NULL;
+    if (!block)
+    {
+        trace_write(tr->state, TRACE_ALLOCATE, 0, size, alignment);
+        return NULL;
+    }
+
+    uint64_t id = atomic_fetch_add_explicit(&tr->state->next_id,
+        1,
+        memory_order_relaxed);
+
+    TraceBlockHeader* header = (TraceBlockHeader*)(block + offset) - 1;
+    *header = (TraceBlockHeader) {
+        .id = id,
+        .size = size,
+        .alignment = upstream_alignment,
+    };
+
+    trace_write(tr->state, TRACE_ALLOCATE, id, size, alignment);
+
+    return block + offset;
+}
+
+static void trace_resource_deallocate(void* resource, void* ptr)
+{
+    assert(resource);
+    TraceResource* tr = (TraceResource*)resource;
+
+    if (!ptr)
+    {
+        return;
+    }
+
+    TraceBlockHeader header = ((TraceBlockHeader*)ptr)[-1];
+    size_t offset = trace_header_offset(header.alignment);
+
+    // recorded first, another thread may get the memory right after the free
+    trace_write(tr->state, TRACE_DEALLOCATE, header.id, 0, 0);
+
+    memory_resource_deallocate_sized(tr->upstream,
+        (char*)ptr - offset,
+        header.size + offset,
+        header.alignment);
+}
+
+/**
+ * The block keeps its id. A failed reallocation is not recorded, the block
+ * stays as it was.
+ */
+static void* trace_resource_reallocate(void* resource,
+    void* ptr,
+    size_t old_size,
+    size_t new_size,
+    size_t alignment)
+{
+    (void)old_size;
+    assert(resource);
+    TraceResource* tr = (TraceResource*)resource;
+
+    if (!ptr)
+    {
+        return trace_resource_allocate(resource, new_size, alignment);
+    }
+
+    TraceBlockHeader header = ((TraceBlockHeader*)ptr)[-1];
+    size_t old_offset = trace_header_offset(header.alignment);
+    size_t upstream_alignment = MAX(alignment, alignof(TraceBlockHeader));
+    size_t offset = trace_header_offset(upstream_alignment);
+
+    if (new_size > SIZE_MAX - offset)
+    {
+        return NULL;
+    }
+
+    MemoryResource* upstream = tr->upstream;
+    char* block = NULL;
+
+    if (header.alignment == upstream_alignment)
+    {
+        block = memory_resource_reallocate(upstream,
+            (char*)ptr - old_offset,
+            header.size + old_offset,
+            new_size + offset,
+            upstream_alignment);
+    }
+    else
+    {
+        // the header offset depends on the alignment, so the block moves
+        block = upstream->allocate(upstream,
+            new_size + offset,
+            upstream_alignment);
+        if (block)
+        {
+            memcpy(block + offset, ptr, MIN(header.size, new_size));
+            memory_resource_deallocate_sized(upstream,
+                (char*)ptr - old_offset,
+                header.size + old_offset,
+                header.alignment);
+        }
+    }
+
+    if (!block)
+    {
+        return NULL;
+    }
+
+    TraceBlockHeader* new_header = (TraceBlockHeader*)(block + offset) - 1;
+    *new_header = (TraceBlockHeader) {
+        .id = header.id,
+        .size = new_size,
+        .alignment = upstream_alignment,
+    };
+
+    trace_write(tr->state, TRACE_REALLOCATE, header.id, new_size, alignment);
+
+    return block + offset;
+}
+
+/**
+ * Appends a record to the trace. stdio locks the file for the duration of
+ * fwrite, so records of different threads do not interleave.
+ */
+static void trace_write(TraceState* state,
+    TraceOp op,
+    uint64_t id,
+    size_t size,
+    size_t alignment)
+{
+    TraceRecord record = {
+        .timestamp = trace_now() - state->start,
+        .id = id,
+        .size = size,
+        .alignment = (uint32_t)alignment,
+        .thread = trace_thread_number(),
+        .op = (uint8_t)op,
+    };
+
+    if (fwrite(&record, sizeof(record), 1, state->file) != 1)
+    {
+        atomic_store_explicit(&state->failed, true, memory_order_relaxed);
+    }
+}
+
+static uint64_t trace_now(void)
+{
+    struct timespec time = {};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000 + (uint64_t)time.tv_nsec;
+}
+
+static uint16_t trace_thread_number(void)
+{
+    if (!trace_thread)
+    {
+        trace_thread = (uint16_t)(atomic_fetch_add_explicit(&trace_thread_count,
+                                      1,
+                                      memory_order_relaxed)
+            + 1);
+    }
+
+    return trace_thread;
+}
+
+static size_t trace_header_offset(size_t alignment)
+{
+    return align_size(sizeof(TraceBlockHeader), alignment);
+}
@@ -39,14 +39,53 @@ typedef struct List
 
 // List* list_ctor(void* memory_resource);
 
+/**
+ * @brief Destructs a List.
+ * Nodes are returned to the memory resource in batches through
+ * memory_resource_deallocate_bulk.
+ *
+ * @param list
+ */
 void list_dtor(List* list);
 
+/**
+ * @brief Destructs a List whose nodes all hold a value of type.
+ * Passes the node size to the memory resource, which may then skip looking
+ * it up.
+ *
+ * @param list
+ * @param type
+ */
+#define list_dtor_type(list, type)                                             \
+    (cmlib_details_list_dtor_sized(list, sizeof(type), alignof(type)))
+
+void cmlib_details_list_dtor_sized(List* list,
+    size_t payload_size,
+    size_t payload_alignment);
+
 ListNode* list_begin(List* list);
 
 ListNode* list_end(List* list);
 
 void list_erase(List* list, ListNode* node);
 
+/**
+ * @brief Erases a node that holds a value of type.
+ * Passes the node size to the memory resource, which may then skip looking
+ * it up.
+ *
+ * @param list
+ * @param node
+ * @param type
+ */
+#define list_erase_type(list, node, type)                                      \
+    (cmlib_details_list_erase_sized(list, node, sizeof(type), alignof(type)))
+
+void cmlib_details_list_erase_sized(List* list,
+    ListNode* node,
+    size_t payload_size,
+    size_t payload_alignment);
+
 ListNode* list_extract(List* list, ListNode* node);
 
 ListNode*
@@ -59,6 +98,42 @@ ListNode* cmlib_details_list_node_ctor(List* list,
     size_t payload_size,
     size_t payload_alignment);
 
+/**
+ * Values follow the node links at the alignment of their type, so
+ * over-aligned values stay aligned.
+ */
+INLINE size_t cmlib_details_list_payload_offset(size_t payload_alignment)
+{
+    return align_size(sizeof(ListNode), payload_alignment);
+}
+
+ListNode* cmlib_details_list_insert_array_after(List* list,
+    ListNode* node,
+    const void* values,
+    size_t payload_size,
+    size_t payload_alignment,
+    size_t count);
+
+/**
+ * @brief Inserts count values from an array after node, in array order.
+ * Nodes are allocated in batches through memory_resource_allocate_bulk.
+ *
+ * @param list
+ * @param node
+ * @param values
+ * @param count
+ *
+ * @return the last inserted node, node if count is 0, or NULL on failure,
+ * in which case nothing is inserted.
+ */
+#define list_insert_array_after(list, node, values, count)                     \
+    (cmlib_details_list_insert_array_after(list,                               \
+        node,                                                                  \
+        values,                                                                \
+        sizeof(*(values)),                                                     \
+        alignof(typeof(*(values))),                                            \
+        count))
+
 #define LIST_ITER(list, iter_name, ...)                                        \
     assert(list && "Iterating over NULL list");                                \
     for (ListNode* iter_name = list_begin(list),                               \
@@ -75,7 +150,9 @@ ListNode* cmlib_details_list_node_ctor(List* list,
         iter_name = iter_name->prev)
 
 #define list_node_get_value(node, type)                                        \
-    ((type*)((node) ? (void*)((node) + 1) : NULL))
+    ((type*)((node) ? (void*)((char*)(node)                                    \
+                          + cmlib_details_list_payload_offset(alignof(type)))  \
+                    : NULL))
 
 // NOLINTBEGIN(bugprone-sizeof-expression)
 #define list_node_ctor_(list, value)                                           \
@@ -86,7 +163,8 @@ ListNode* cmlib_details_list_node_ctor(List* list,
             alignof(typeof(value)));                                           \
         if (cmlib_list_node_ctor_list_node__)                                  \
         {                                                                      \
-            *(typeof(value)*)(cmlib_list_node_ctor_list_node__ + 1) = value;    \
+            *list_node_get_value(cmlib_list_node_ctor_list_node__,             \
+                typeof(value)) = value;                                        \
         }                                                                      \
         cmlib_list_node_ctor_list_node__;                                      \
     })
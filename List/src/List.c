@@ -1,8 +1,24 @@
 #include "List.h"
 
+#include <string.h>
+
 #include "../../common.h"
 #include "List.h"
 
+/**
+ * Number of nodes allocated or freed per call to the memory resource.
+ */
+static constexpr size_t LIST_BULK_SIZE = 64;
+
+size_t cmlib_details_list_payload_offset(size_t);
+
+static void list_node_dtor(List* list,
+    ListNode* node,
+    size_t payload_size,
+    size_t payload_alignment);
+static void
+list_node_chain_dtor(MemoryResource* resource, ListNode* node, ListNode* end);
+
 // List* list_ctor(void* memory_resource)
 // {
 //     List* ptr = NULL;
@@ -32,12 +48,30 @@ void list_dtor(List* list)
         return;
     }
 
-    MemoryResource* resource = list->memory_resource;
+    list_node_chain_dtor(list->memory_resource, list->base.next, &list->base);
+}
+
+void cmlib_details_list_dtor_sized(List* list,
+    size_t payload_size,
+    size_t payload_alignment)
+{
+    if (!list)
+    {
+        return;
+    }
+
+    // batches save more than sizes when the resource cannot use the size
+    if (!list->memory_resource->deallocate_sized)
+    {
+        list_dtor(list);
+        return;
+    }
+
     ListNode* current = list->base.next;
     while (current != &list->base)
     {
         ListNode* next = current->next;
-        resource->deallocate(resource, current);
+        list_node_dtor(list, current, payload_size, payload_alignment);
         current = next;
     }
 }
@@ -60,6 +94,17 @@ void list_erase(List* list, ListNode* node)
     }
 }
 
+void cmlib_details_list_erase_sized(List* list,
+    ListNode* node,
+    size_t payload_size,
+    size_t payload_alignment)
+{
+    if (list_extract(list, node))
+    {
+        list_node_dtor(list, node, payload_size, payload_alignment);
+    }
+}
+
 ListNode* list_extract(List* list, ListNode* node)
 {
     if (!list || !node || node == &list->base || !node->prev || !node->next)
@@ -109,7 +154,7 @@ ListNode* cmlib_details_list_node_ctor(List* list,
 
     MemoryResource* resource = list->memory_resource;
     ListNode* node = resource->allocate(resource,
-        sizeof(ListNode) + payload_size,
+        cmlib_details_list_payload_offset(payload_alignment) + payload_size,
         MAX(alignof(ListNode), payload_alignment));
     if (!node)
     {
@@ -119,3 +164,98 @@ ListNode* cmlib_details_list_node_ctor(List* list,
     *node = (ListNode) {};
     return node;
 }
+
+ListNode* cmlib_details_list_insert_array_after(List* list,
+    ListNode* node,
+    const void* values,
+    size_t payload_size,
+    size_t payload_alignment,
+    size_t count)
+{
+    if (!list || !list->memory_resource || !node || (!values && count))
+    {
+        return NULL;
+    }
+
+    MemoryResource* resource = list->memory_resource;
+    size_t payload_offset =
+        cmlib_details_list_payload_offset(payload_alignment);
+    size_t node_size = payload_offset + payload_size;
+    size_t node_alignment = MAX(alignof(ListNode), payload_alignment);
+
+    const char* value = values;
+    ListNode* last = node;
+    size_t inserted = 0;
+
+    while (inserted < count)
+    {
+        void* nodes[LIST_BULK_SIZE];
+        size_t batch_size = MIN(count - inserted, LIST_BULK_SIZE);
+        size_t allocated = memory_resource_allocate_bulk(resource,
+            node_size,
+            node_alignment,
+            batch_size,
+            nodes);
+
+        for (size_t i = 0; i < allocated; i++)
+        {
+            ListNode* new_node = nodes[i];
+            memcpy((char*)new_node + payload_offset, value, payload_size);
+            value += payload_size;
+            last = list_insert_node_after(list, last, new_node);
+        }
+
+        if (allocated < batch_size)
+        {
+            ListNode* first = node->next;
+            ListNode* end = last->next;
+            node->next = end;
+            end->prev = node;
+            list_node_chain_dtor(resource, first, end);
+            return NULL;
+        }
+
+        inserted += allocated;
+    }
+
+    return last;
+}
+
+/**
+ * Frees the nodes from node up to end in batches.
+ */
+static void
+list_node_chain_dtor(MemoryResource* resource, ListNode* node, ListNode* end)
+{
+    void* nodes[LIST_BULK_SIZE];
+    size_t count = 0;
+
+    while (node != end)
+    {
+        nodes[count++] = node;
+        node = node->next;
+
+        if (count == LIST_BULK_SIZE)
+        {
+            memory_resource_deallocate_bulk(resource, nodes, count);
+            count = 0;
+        }
+    }
+
+    memory_resource_deallocate_bulk(resource, nodes, count);
+}
+
+/**
+ * Frees node with the size and alignment cmlib_details_list_node_ctor
+ * allocated it with.
+ */
+static void list_node_dtor(List* list,
+    ListNode* node,
+    size_t payload_size,
+    size_t payload_alignment)
+{
+    memory_resource_deallocate_sized(list->memory_resource,
+        node,
+        cmlib_details_list_payload_offset(payload_alignment) + payload_size,
+        MAX(alignof(ListNode), payload_alignment));
+}
@@ -109,7 +109,10 @@ void string_dtor(String* this)
 
     if (this->memory_resource)
     {
-        this->memory_resource->deallocate(this->memory_resource, this->data);
+        memory_resource_deallocate_sized(this->memory_resource,
+            this->data,
+            this->capacity + 1,
+            alignof(char));
     }
     *this = (String) {};
 }
@@ -265,7 +268,9 @@ ErrorCode string_realloc(String* this, size_t new_capacity)
         return EVERYTHING_FINE;
     }
 
-    char* new_data = this->memory_resource->allocate(this->memory_resource,
+    char* new_data = memory_resource_reallocate(this->memory_resource,
+        this->data,
+        this->data ? this->capacity + 1 : 0,
         new_capacity + 1,
         alignof(char));
     if (!new_data)
@@ -273,13 +278,8 @@ ErrorCode string_realloc(String* this, size_t new_capacity)
         return ERROR_NO_MEMORY;
     }
 
-    if (this->data && this->size)
-    {
-        memcpy(new_data, this->data, this->size);
-    }
     new_data[this->size] = '\0';
 
-    this->memory_resource->deallocate(this->memory_resource, this->data);
     this->data = new_data;
     this->capacity = new_capacity;
 
@@ -418,7 +418,10 @@ ErrorCode string_replace_all(String* this, Str from, Str to)
     }
     out.value.data[out.value.size] = '\0';
 
-    this->memory_resource->deallocate(this->memory_resource, this->data);
+    memory_resource_deallocate_sized(this->memory_resource,
+        this->data,
+        this->capacity + 1,
+        alignof(char));
     *this = out.value;
     return EVERYTHING_FINE;
 }
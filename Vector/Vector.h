@@ -18,17 +18,28 @@ typedef struct VHeader_
 } cmlib_details_VHeader_;
 
 INLINE cmlib_details_VHeader_* cmlib_details_get_vec_header(void* vec);
-void* cmlib_details_vec_realloc(void* vec, size_t elem_size);
-
+INLINE size_t cmlib_details_vec_prefix_size(size_t alignment);
+void* cmlib_details_vec_realloc(void* vec, size_t elem_size, size_t alignment);
+
+/**
+ * The header sits right before the elements. The block starts
+ * cmlib_details_vec_prefix_size bytes before them and is allocated at the
+ * alignment of the elements, so over-aligned elements stay aligned.
+ */
 void* cmlib_details_vec_ctor(void* memory_resource,
     size_t elem_size,
+    size_t alignment,
     size_t capacity);
 #define vec_ctor(memory_resource, type)                                        \
     (cmlib_details_vec_ctor(memory_resource,                                   \
         sizeof(type),                                                          \
+        alignof(type),                                                         \
         CMLIB_VEC_DEFAULT_CAPACITY))
 
-INLINE void vec_dtor(void* vec);
+INLINE void
+cmlib_details_vec_dtor(void* vec, size_t elem_size, size_t alignment);
+#define vec_dtor(vec)                                                          \
+    (cmlib_details_vec_dtor((vec), sizeof(*(vec)), alignof(typeof(*(vec)))))
 
 INLINE size_t vec_size(void* vec);
 
@@ -40,7 +51,8 @@ INLINE void vec_clear(void* vec);
     ({                                                                         \
         ErrorCode cmlib_vec_add_error__ = ERROR_NO_MEMORY;                     \
         void* cmlib_vec_add_temp__ = cmlib_details_vec_realloc((vec),          \
-            sizeof(*vec));                                                     \
+            sizeof(*vec),                                                      \
+            alignof(typeof(*vec)));                                            \
         if (cmlib_vec_add_temp__)                                              \
         {                                                                      \
             cmlib_vec_add_error__ = EVERYTHING_FINE;                           \
@@ -71,6 +83,7 @@ INLINE void vec_clear(void* vec);
         void* cmlib_vec_reserve_temp__ =                                       \
             cmlib_details_vec_ctor(cmlib_vec_reserve_resource__,               \
                 sizeof(*vec),                                                  \
+                alignof(typeof(*vec)),                                         \
                 cmlib_vec_reserve_new_capacity__);                             \
         if (cmlib_vec_reserve_temp__)                                          \
         {                                                                      \
@@ -104,12 +117,17 @@ INLINE void vec_clear(void* vec);
             iter_name++),                                                      \
         __VA_ARGS__)
 
-INLINE void vec_dtor(void* vec)
+INLINE void
+cmlib_details_vec_dtor(void* vec, size_t elem_size, size_t alignment)
 {
     if (vec)
     {
         cmlib_details_VHeader_* header = cmlib_details_get_vec_header(vec);
-        header->memory_resource->deallocate(header->memory_resource, header);
+        size_t prefix_size = cmlib_details_vec_prefix_size(alignment);
+        memory_resource_deallocate_sized(header->memory_resource,
+            (char*)vec - prefix_size,
+            header->capacity * elem_size + prefix_size,
+            MAX(alignment, alignof(cmlib_details_VHeader_)));
     }
 }
 
@@ -151,4 +169,9 @@ INLINE cmlib_details_VHeader_* cmlib_details_get_vec_header(void* vec)
     return &((cmlib_details_VHeader_*)vec)[-1];
 }
 
+INLINE size_t cmlib_details_vec_prefix_size(size_t alignment)
+{
+    return align_size(sizeof(cmlib_details_VHeader_), alignment);
+}
+
 #endif // CMLIB_VECTOR_H_
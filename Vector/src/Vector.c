@@ -1,16 +1,18 @@
 #include "../Vector.h"
 
 cmlib_details_VHeader_* cmlib_details_get_vec_header(void*);
-void vec_dtor(void*);
+size_t cmlib_details_vec_prefix_size(size_t);
+void cmlib_details_vec_dtor(void*, size_t, size_t);
 size_t vec_size(void*);
 size_t vec_capacity(void*);
 void vec_clear(void*);
 
 void* cmlib_details_vec_ctor(void* memory_resource,
     size_t elem_size,
+    size_t alignment,
     size_t capacity)
 {
-    if (elem_size == 0 || capacity == 0)
+    if (elem_size == 0 || capacity == 0 || alignment == 0)
     {
         return NULL;
     }
@@ -21,21 +23,24 @@ void* cmlib_details_vec_ctor(void* memory_resource,
         return NULL;
     }
 
-    cmlib_details_VHeader_* header = resource->allocate(resource,
-        capacity * elem_size + sizeof(cmlib_details_VHeader_),
-        elem_size);
+    size_t prefix_size = cmlib_details_vec_prefix_size(alignment);
+    char* block = resource->allocate(resource,
+        capacity * elem_size + prefix_size,
+        MAX(alignment, alignof(cmlib_details_VHeader_)));
 
-    if (!header)
+    if (!block)
     {
         return NULL;
     }
 
-    *header = (cmlib_details_VHeader_) {resource, 0, capacity};
+    void* vec = block + prefix_size;
+    *cmlib_details_get_vec_header(vec) =
+        (cmlib_details_VHeader_) {resource, 0, capacity};
 
-    return &header[1];
+    return vec;
 }
 
-void* cmlib_details_vec_realloc(void* vec, size_t elem_size)
+void* cmlib_details_vec_realloc(void* vec, size_t elem_size, size_t alignment)
 {
     if (!vec)
     {
@@ -50,24 +55,20 @@ void* cmlib_details_vec_realloc(void* vec, size_t elem_size)
     }
 
     size_t new_capacity = header->capacity * 2;
-
-    void* new_vec = cmlib_details_vec_ctor(header->memory_resource,
-        elem_size,
-        new_capacity);
-    if (!new_vec)
+    size_t prefix_size = cmlib_details_vec_prefix_size(alignment);
+
+    char* new_block = memory_resource_reallocate(header->memory_resource,
+        (char*)vec - prefix_size,
+        header->capacity * elem_size + prefix_size,
+        new_capacity * elem_size + prefix_size,
+        MAX(alignment, alignof(cmlib_details_VHeader_)));
+    if (!new_block)
     {
         return NULL;
     }
 
-    memcpy(new_vec, vec, elem_size * header->size);
-
-    *cmlib_details_get_vec_header(new_vec) = (cmlib_details_VHeader_) {
-        header->memory_resource,
-        header->size,
-        new_capacity
-    };
-
-    header->memory_resource->deallocate(header->memory_resource, header);
+    void* new_vec = new_block + prefix_size;
+    cmlib_details_get_vec_header(new_vec)->capacity = new_capacity;
 
     return new_vec;
 }
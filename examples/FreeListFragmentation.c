@@ -0,0 +1,106 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "FreeList.h"
+#include "details/CountingMalloc.h"
+
+enum
+{
+    POOL_SIZE = 64 * 1024,
+    LIVE_COUNT = 512,
+    OP_COUNT = 20000,
+    ROUND_COUNT = 20,
+    MIN_BLOCK = 8,
+    MAX_BLOCK = 1024,
+};
+
+static uint64_t prng_next(uint64_t* state)
+{
+    uint64_t value = *state;
+    value ^= value >> 12;
+    value ^= value << 25;
+    value ^= value >> 27;
+    *state = value;
+    return value * 2685821657736338717ull;
+}
+
+static double millis_now(void)
+{
+    struct timespec time = {};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double)time.tv_sec * 1e3 + (double)time.tv_nsec * 1e-6;
+}
+
+static size_t random_size(uint64_t* state)
+{
+    return MIN_BLOCK + prng_next(state) % (MAX_BLOCK - MIN_BLOCK + 1);
+}
+
+/**
+ * Every round keeps LIVE_COUNT blocks of random sizes alive, replaces random
+ * ones OP_COUNT times and then frees everything. Without merging of free
+ * neighbours the pools fill up with slivers and the free list keeps growing.
+ */
+int main(void)
+{
+    FreeList* free_list = free_list_ctor(POOL_SIZE);
+    if (!free_list)
+    {
+        fprintf(stderr, "failed to construct free list\n");
+        return 1;
+    }
+
+    void* blocks[LIVE_COUNT] = {};
+    uint64_t random_state = 0x123456789abcdef0ull;
+    size_t first_allocations = standard_allocations_count;
+    double begin = millis_now();
+
+    printf("pool: %d bytes, live blocks: %d, sizes: %d..%d bytes\n\n",
+        POOL_SIZE,
+        LIVE_COUNT,
+        MIN_BLOCK,
+        MAX_BLOCK);
+
+    for (size_t round = 0; round < ROUND_COUNT; ++round)
+    {
+        for (size_t i = 0; i < LIVE_COUNT; ++i)
+        {
+            blocks[i] =
+                free_list_allocate(free_list, random_size(&random_state), 8);
+        }
+
+        for (size_t i = 0; i < OP_COUNT; ++i)
+        {
+            size_t index = prng_next(&random_state) % LIVE_COUNT;
+            free_list_deallocate(free_list, blocks[index]);
+            blocks[index] =
+                free_list_allocate(free_list, random_size(&random_state), 8);
+        }
+
+        for (size_t i = 0; i < LIVE_COUNT; ++i)
+        {
+            free_list_deallocate(free_list, blocks[i]);
+        }
+
+        printf("round %2zu: pools %4zu\n",
+            round + 1,
+            standard_allocations_count - first_allocations + 1);
+    }
+
+    double elapsed = millis_now() - begin;
+
+    size_t pools_before = standard_allocations_count;
+    void* whole_pool = free_list_allocate(free_list, POOL_SIZE / 2, 8);
+
+    printf("\ntime: %.3f ms\n", elapsed);
+    printf("pools: %zu\n", standard_allocations_count - first_allocations + 1);
+    printf("half-pool block after freeing everything: %s\n",
+        whole_pool && pools_before == standard_allocations_count
+            ? "served from existing pools"
+            : "needed a new pool");
+
+    free_list_dtor(free_list);
+
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "FreeList.h"
+
+enum
+{
+    POOL_SIZE = 1024 * 1024,
+    MAX_LIVE_COUNT = 16384,
+    OP_COUNT = 200000,
+    MIN_BLOCK = 8,
+    MAX_BLOCK = 1024,
+};
+
+static uint64_t prng_next(uint64_t* state)
+{
+    uint64_t value = *state;
+    value ^= value >> 12;
+    value ^= value << 25;
+    value ^= value >> 27;
+    *state = value;
+    return value * 2685821657736338717ull;
+}
+
+static uint64_t nanos_now(void)
+{
+    struct timespec time = {};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000ull + (uint64_t)time.tv_nsec;
+}
+
+static size_t random_size(uint64_t* state)
+{
+    return MIN_BLOCK + prng_next(state) % (MAX_BLOCK - MIN_BLOCK + 1);
+}
+
+/**
+ * Keeps live_count blocks of random sizes alive and replaces random ones,
+ * timing every replacement. The more blocks are live, the more free holes lie
+ * between them, so a search over all free blocks slows down while a bin
+ * lookup does not.
+ */
+static bool run_workload(size_t live_count)
+{
+    static void* blocks[MAX_LIVE_COUNT] = {};
+
+    FreeList* free_list = free_list_ctor(POOL_SIZE);
+    if (!free_list)
+    {
+        return false;
+    }
+
+    uint64_t random_state = 0x123456789abcdef0ull;
+
+    for (size_t i = 0; i < live_count; ++i)
+    {
+        blocks[i] =
+            free_list_allocate(free_list, random_size(&random_state), 8);
+    }
+
+    uint64_t total = 0;
+    uint64_t worst = 0;
+
+    for (size_t i = 0; i < OP_COUNT; ++i)
+    {
+        size_t index = prng_next(&random_state) % live_count;
+        size_t size = random_size(&random_state);
+
+        uint64_t begin = nanos_now();
+        free_list_deallocate(free_list, blocks[index]);
+        blocks[index] = free_list_allocate(free_list, size, 8);
+        uint64_t elapsed = nanos_now() - begin;
+
+        total += elapsed;
+        if (elapsed > worst)
+        {
+            worst = elapsed;
+        }
+    }
+
+    for (size_t i = 0; i < live_count; ++i)
+    {
+        free_list_deallocate(free_list, blocks[i]);
+    }
+
+    free_list_dtor(free_list);
+
+    printf("live %5zu: %8.1f ns/pair avg, %8" PRIu64 " ns worst\n",
+        live_count,
+        (double)total / OP_COUNT,
+        worst);
+
+    return true;
+}
+
+int main(void)
+{
+    printf("pool: %d bytes, replacements: %d, sizes: %d..%d bytes\n\n",
+        POOL_SIZE,
+        OP_COUNT,
+        MIN_BLOCK,
+        MAX_BLOCK);
+
+    for (size_t live_count = 256; live_count <= MAX_LIVE_COUNT; live_count *= 4)
+    {
+        if (!run_workload(live_count))
+        {
+            fprintf(stderr, "failed to construct free list\n");
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -1,18 +1,22 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <threads.h>
 #include <time.h>
 
+#include "ConcurrentPoolResource.h"
 #include "List.h"
 #include "PoolResource.h"
 
 enum
 {
     NODE_COUNT = 1000000,
+    SMALL_SUBPOOL_COUNT = 1024,
     NOOP_COUNT = 100000000,
     RANDOM_OP_COUNT = 4000000,
     REPEAT_COUNT = 10,
     WARMUP_COUNT = 2,
+    THREAD_COUNT = 4,
 };
 
 typedef struct BenchmarkStats
@@ -28,6 +32,15 @@ typedef struct BenchmarkResult
     uint64_t checksum;
 } BenchmarkResult;
 
+typedef struct ThreadBenchmarkArgs
+{
+    List list;
+    ListNode** nodes;
+    uint64_t random_state;
+    uint64_t checksum;
+    bool ok;
+} ThreadBenchmarkArgs;
+
 static uint64_t prng_next(uint64_t* state)
 {
     uint64_t value = *state;
@@ -98,35 +111,27 @@ static double measure_tsc_ghz(uint64_t* cycles, uint64_t* elapsed_nsec)
     return (double)*cycles / (double)*elapsed_nsec;
 }
 
-static BenchmarkResult run_list_benchmark(MemoryResource* resource,
-    bool destroy_list)
+static bool run_list_workload(List* list,
+    ListNode** nodes,
+    size_t node_count,
+    size_t op_count,
+    uint64_t random_state,
+    uint64_t* checksum_out)
 {
-    BenchmarkResult result = {};
     volatile uint64_t checksum = 0;
-    ListNode** nodes = (ListNode**)calloc(NODE_COUNT, sizeof(*nodes));
     size_t live_count = 0;
-    uint64_t random_state = 0x123456789abcdef0ull;
 
-    list_ctor(list, resource);
-
-    uint64_t begin_cycles = read_tsc();
-
-    for (int i = 0; i < NODE_COUNT; ++i)
+    for (size_t i = 0; i < node_count; ++i)
     {
-        ListNode* node = list_insert_after(list, list_end(list), i);
+        ListNode* node = list_insert_after(list, list_end(list), (int)i);
         if (!node)
         {
-            if (destroy_list)
-            {
-                list_dtor(list);
-                free(nodes);
-            }
-            return result;
+            return false;
         }
         nodes[live_count++] = node;
     }
 
-    for (size_t i = 0; i < RANDOM_OP_COUNT; ++i)
+    for (size_t i = 0; i < op_count; ++i)
     {
         uint64_t random = prng_next(&random_state);
         size_t index = random % live_count;
@@ -150,21 +155,16 @@ static BenchmarkResult run_list_benchmark(MemoryResource* resource,
                     list_insert_after(list, node, (int)(random >> 32));
                 if (!new_node)
                 {
-                    if (destroy_list)
-                    {
-                        list_dtor(list);
-                        free(nodes);
-                    }
-                    return result;
+                    return false;
                 }
 
-                if (live_count < NODE_COUNT)
+                if (live_count < node_count)
                 {
                     nodes[live_count++] = new_node;
                 }
                 else
                 {
-                    list_erase(list, nodes[index]);
+                    list_erase_type(list, nodes[index], int);
                     nodes[index] = new_node;
                 }
                 break;
@@ -177,36 +177,162 @@ static BenchmarkResult run_list_benchmark(MemoryResource* resource,
                     break;
                 }
 
-                list_erase(list, node);
+                list_erase_type(list, node, int);
                 nodes[index] = nodes[--live_count];
                 break;
             }
         }
     }
 
+    *checksum_out = checksum;
+    return true;
+}
+
+static BenchmarkResult run_list_benchmark(MemoryResource* resource,
+    bool destroy_list)
+{
+    BenchmarkResult result = {};
+    ListNode** nodes = (ListNode**)calloc(NODE_COUNT, sizeof(*nodes));
+    uint64_t checksum = 0;
+
+    list_ctor(list, resource);
+
+    uint64_t begin_cycles = read_tsc();
+
+    bool ok = run_list_workload(list,
+        nodes,
+        NODE_COUNT,
+        RANDOM_OP_COUNT,
+        0x123456789abcdef0ull,
+        &checksum);
+
     if (destroy_list)
     {
-        list_dtor(list);
+        list_dtor_type(list, int);
     }
 
     uint64_t end_cycles = read_tsc();
 
     free(nodes);
 
+    if (!ok)
+    {
+        return result;
+    }
+
     result.ok = true;
     result.cycles = end_cycles - begin_cycles;
     result.checksum = checksum;
     return result;
 }
 
+static int run_thread_workload(void* arg)
+{
+    ThreadBenchmarkArgs* args = arg;
+
+    args->ok = run_list_workload(&args->list,
+        args->nodes,
+        NODE_COUNT / THREAD_COUNT,
+        RANDOM_OP_COUNT / THREAD_COUNT,
+        args->random_state,
+        &args->checksum);
+
+    return 0;
+}
+
+static int run_thread_dtor(void* arg)
+{
+    list_dtor_type(&((ThreadBenchmarkArgs*)arg)->list, int);
+    return 0;
+}
+
+/**
+ * Every thread runs the list workload on its own list with a share of the
+ * nodes and operations, then destroys the list of its neighbour, so half of
+ * the frees cross threads.
+ */
+static BenchmarkResult run_threaded_list_benchmark(MemoryResource* resource)
+{
+    BenchmarkResult result = {};
+    ThreadBenchmarkArgs args[THREAD_COUNT] = {};
+    thrd_t threads[THREAD_COUNT] = {};
+    size_t started = 0;
+
+    for (size_t i = 0; i < THREAD_COUNT; ++i)
+    {
+        args[i].list = (List) {
+            .base = (ListNode) {&args[i].list.base, &args[i].list.base},
+            .memory_resource = resource,
+        };
+        args[i].nodes =
+            (ListNode**)calloc(NODE_COUNT / THREAD_COUNT, sizeof(ListNode*));
+        args[i].random_state = 0x123456789abcdef0ull + i;
+    }
+
+    uint64_t begin_cycles = read_tsc();
+
+    for (; started < THREAD_COUNT; ++started)
+    {
+        if (thrd_create(&threads[started], run_thread_workload, &args[started])
+            != thrd_success)
+        {
+            break;
+        }
+    }
+    for (size_t i = 0; i < started; ++i)
+    {
+        thrd_join(threads[i], NULL);
+    }
+
+    bool ok = started == THREAD_COUNT;
+    for (size_t i = 0; i < THREAD_COUNT; ++i)
+    {
+        ok &= args[i].ok;
+        result.checksum += args[i].checksum;
+    }
+
+    for (started = 0; started < THREAD_COUNT; ++started)
+    {
+        if (thrd_create(&threads[started],
+                run_thread_dtor,
+                &args[(started + 1) % THREAD_COUNT])
+            != thrd_success)
+        {
+            break;
+        }
+    }
+    for (size_t i = 0; i < started; ++i)
+    {
+        thrd_join(threads[i], NULL);
+    }
+
+    uint64_t end_cycles = read_tsc();
+
+    for (size_t i = started; i < THREAD_COUNT; ++i)
+    {
+        list_dtor_type(&args[(i + 1) % THREAD_COUNT].list, int);
+    }
+    for (size_t i = 0; i < THREAD_COUNT; ++i)
+    {
+        free(args[i].nodes);
+    }
+
+    result.ok = ok;
+    result.cycles = end_cycles - begin_cycles;
+    return result;
+}
+
 static BenchmarkResult run_malloc_sample(void)
 {
     return run_list_benchmark(get_malloc_resource(), true);
 }
 
-static BenchmarkResult run_pool_sample(void)
+static BenchmarkResult run_pool_benchmark(size_t subpool_count,
+    bool huge_pages)
 {
-    Result_PoolResource resource = pool_resource_ctor(NODE_COUNT);
+    Result_PoolResource resource = huge_pages
+        ? pool_resource_ctor_huge(subpool_count)
+        : pool_resource_ctor(subpool_count);
     if (resource.error_code != EVERYTHING_FINE)
     {
         return (BenchmarkResult) {};
@@ -218,6 +344,41 @@ static BenchmarkResult run_pool_sample(void)
     return result;
 }
 
+static BenchmarkResult run_pool_sample(void)
+{
+    return run_pool_benchmark(NODE_COUNT, false);
+}
+
+static BenchmarkResult run_huge_pool_sample(void)
+{
+    return run_pool_benchmark(NODE_COUNT, true);
+}
+
+static BenchmarkResult run_small_pool_sample(void)
+{
+    return run_pool_benchmark(SMALL_SUBPOOL_COUNT, false);
+}
+
+static BenchmarkResult run_threaded_malloc_sample(void)
+{
+    return run_threaded_list_benchmark(get_malloc_resource());
+}
+
+static BenchmarkResult run_threaded_pool_sample(void)
+{
+    Result_ConcurrentPoolResource resource =
+        concurrent_pool_resource_ctor(SMALL_SUBPOOL_COUNT);
+    if (resource.error_code != EVERYTHING_FINE)
+    {
+        return (BenchmarkResult) {};
+    }
+
+    BenchmarkResult result = run_threaded_list_benchmark(&resource.value.base);
+    concurrent_pool_resource_dtor(&resource.value);
+
+    return result;
+}
+
 static void print_sample(const char* name,
     size_t run_index,
     uint64_t cycles,
@@ -321,6 +482,10 @@ int main(void)
 
     BenchmarkStats malloc_stats = {};
     BenchmarkStats pool_stats = {};
+    BenchmarkStats huge_pool_stats = {};
+    BenchmarkStats small_pool_stats = {};
+    BenchmarkStats mt_malloc_stats = {};
+    BenchmarkStats mt_pool_stats = {};
 
     if (!benchmark_resource("malloc", run_malloc_sample, tsc_ghz, &malloc_stats))
     {
@@ -334,11 +499,59 @@ int main(void)
     }
     printf("\n");
 
+    if (!benchmark_resource("poolhp",
+            run_huge_pool_sample,
+            tsc_ghz,
+            &huge_pool_stats))
+    {
+        return 1;
+    }
+    printf("\n");
+
+    if (!benchmark_resource("pool1k",
+            run_small_pool_sample,
+            tsc_ghz,
+            &small_pool_stats))
+    {
+        return 1;
+    }
+    printf("\n");
+
+    if (!benchmark_resource("mtmall",
+            run_threaded_malloc_sample,
+            tsc_ghz,
+            &mt_malloc_stats))
+    {
+        return 1;
+    }
+    printf("\n");
+
+    if (!benchmark_resource("mtpool",
+            run_threaded_pool_sample,
+            tsc_ghz,
+            &mt_pool_stats))
+    {
+        return 1;
+    }
+    printf("\n");
+
     print_summary("malloc", malloc_stats, tsc_ghz);
     print_summary("pool", pool_stats, tsc_ghz);
+    print_summary("poolhp", huge_pool_stats, tsc_ghz);
+    print_summary("pool1k", small_pool_stats, tsc_ghz);
+    print_summary("mtmall", mt_malloc_stats, tsc_ghz);
+    print_summary("mtpool", mt_pool_stats, tsc_ghz);
 
     printf("\npool/malloc avg ratio: %.3f\n",
         (double)pool_stats.total_cycles / (double)malloc_stats.total_cycles);
+    printf("poolhp/pool avg ratio: %.3f\n",
+        (double)huge_pool_stats.total_cycles / (double)pool_stats.total_cycles);
+    printf("pool1k/malloc avg ratio: %.3f\n",
+        (double)small_pool_stats.total_cycles
+            / (double)malloc_stats.total_cycles);
+    printf("mtpool/mtmall avg ratio: %.3f\n",
+        (double)mt_pool_stats.total_cycles
+            / (double)mt_malloc_stats.total_cycles);
 
     return 0;
 }
@@ -0,0 +1,113 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "List.h"
+#include "PoolResource.h"
+
+enum
+{
+    NODE_COUNT = 1000000,
+    SUBPOOL_COUNT = 4096,
+    REPEAT_COUNT = 10,
+};
+
+typedef struct Timings
+{
+    uint64_t build;
+    uint64_t teardown;
+} Timings;
+
+static uint64_t nanos_now(void)
+{
+    struct timespec time = {};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000ull + (uint64_t)time.tv_nsec;
+}
+
+/**
+ * Builds a list of NODE_COUNT ints and tears it down, either one node per
+ * call to the memory resource or in batches.
+ */
+static bool run_workload(int* values, bool bulk, Timings* timings)
+{
+    Result_PoolResource resource = pool_resource_ctor(SUBPOOL_COUNT);
+    if (resource.error_code != EVERYTHING_FINE)
+    {
+        return false;
+    }
+
+    list_ctor(list, &resource.value.base);
+    bool ok = true;
+
+    uint64_t begin = nanos_now();
+
+    if (bulk)
+    {
+        ok = list_insert_array_after(list, list_end(list), values, NODE_COUNT);
+    }
+    else
+    {
+        for (size_t i = 0; i < NODE_COUNT && ok; ++i)
+        {
+            ok = list_insert_before(list, list_end(list), values[i]);
+        }
+    }
+
+    uint64_t built = nanos_now();
+
+    if (bulk)
+    {
+        list_dtor(list);
+    }
+    else
+    {
+        while (list_begin(list) != list_end(list))
+        {
+            list_erase(list, list_begin(list));
+        }
+    }
+
+    uint64_t end = nanos_now();
+
+    pool_resource_dtor(&resource.value);
+
+    timings->build = MIN(timings->build, built - begin);
+    timings->teardown = MIN(timings->teardown, end - built);
+
+    return ok;
+}
+
+int main(void)
+{
+    static int values[NODE_COUNT] = {};
+    for (size_t i = 0; i < NODE_COUNT; ++i)
+    {
+        values[i] = (int)i;
+    }
+
+    printf("nodes: %d, best of %d runs\n\n", NODE_COUNT, REPEAT_COUNT);
+
+    Timings single = {UINT64_MAX, UINT64_MAX};
+    Timings bulk = {UINT64_MAX, UINT64_MAX};
+
+    for (size_t i = 0; i < REPEAT_COUNT; ++i)
+    {
+        if (!run_workload(values, false, &single)
+            || !run_workload(values, true, &bulk))
+        {
+            fprintf(stderr, "list workload failed\n");
+            return 1;
+        }
+    }
+
+    printf("         build      teardown\n");
+    printf("single %6.2f ms  %6.2f ms\n",
+        (double)single.build / 1e6,
+        (double)single.teardown / 1e6);
+    printf("bulk   %6.2f ms  %6.2f ms\n",
+        (double)bulk.build / 1e6,
+        (double)bulk.teardown / 1e6);
+
+    return 0;
+}
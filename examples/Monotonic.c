@@ -0,0 +1,57 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "MonotonicResource.h"
+#include "StatsResource.h"
+#include "Vector.h"
+
+static const char* LINES[] = {
+    "the quick brown fox jumps over the lazy dog",
+    "short line",
+    "a line with enough words in it to need more than the stack buffer "
+    "holds, so the resource has to take a block from the upstream resource "
+    "to keep going without failing the request",
+};
+
+int main(void)
+{
+    StatsResource stats = stats_resource_ctor(get_malloc_resource()).value;
+
+    char buffer[256];
+    Result_MonotonicResource monotonic_res =
+        monotonic_resource_ctor(buffer, sizeof(buffer), &stats.base);
+    if (monotonic_res.error_code)
+    {
+        return 1;
+    }
+    MonotonicResource monotonic = monotonic_res.value;
+
+    for (size_t i = 0; i < ARRAY_SIZE(LINES); i++)
+    {
+        // every line gets scratch memory that is thrown away at once
+        size_t* word_lengths = vec_ctor(&monotonic.base, size_t);
+        const char* line = LINES[i];
+        while (*line)
+        {
+            size_t length = strcspn(line, " ");
+            vec_add(word_lengths, length);
+            line += length + (line[length] == ' ');
+        }
+
+        printf("%zu words:", vec_size(word_lengths));
+        for (size_t j = 0; j < vec_size(word_lengths); j++)
+        {
+            printf(" %zu", word_lengths[j]);
+        }
+        putchar('\n');
+
+        monotonic_resource_release(&monotonic);
+    }
+
+    MemoryStats totals = stats_resource_collect(&stats);
+    printf("upstream allocations: %zu\n", totals.allocations);
+
+    monotonic_resource_dtor(&monotonic);
+    stats_resource_dtor(&stats);
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include <stdint.h>
+#include <stdio.h>
+
+#include "MultiPoolResource.h"
+#include "PoolResource.h"
+#include "String.h"
+#include "Vector.h"
+#include "details/CountingMalloc.h"
+
+enum
+{
+    STRING_COUNT = 1000,
+    MAX_LENGTH = 2048,
+    SUBPOOL_COUNT = 64,
+    MAX_BLOCK_SIZE = 4096,
+};
+
+static uint64_t prng_next(uint64_t* state)
+{
+    uint64_t value = *state;
+    value ^= value >> 12;
+    value ^= value << 25;
+    value ^= value >> 27;
+    *state = value;
+    return value * 2685821657736338717ull;
+}
+
+/**
+ * Builds STRING_COUNT strings of random length one character at a time and
+ * a vector of their lengths, and returns how many bytes the allocators hold
+ * while they are alive.
+ */
+static size_t run(MemoryResource* resource)
+{
+    static String strings[STRING_COUNT];
+    uint64_t random_state = 0x123456789abcdef0ull;
+
+    MallocStats before = cmlib_details_malloc_stats();
+
+    size_t* lengths = vec_ctor(resource, size_t);
+    for (size_t i = 0; i < STRING_COUNT; i++)
+    {
+        size_t length = 1 + prng_next(&random_state) % MAX_LENGTH;
+        strings[i] = string_ctor(resource, "").value;
+        for (size_t j = 0; j < length; j++)
+        {
+            string_append_char(&strings[i], 'x');
+        }
+        vec_add(lengths, length);
+    }
+
+    MallocStats diff =
+        cmlib_details_malloc_stats_diff(before, cmlib_details_malloc_stats());
+
+    for (size_t i = 0; i < STRING_COUNT; i++)
+    {
+        string_dtor(&strings[i]);
+    }
+    vec_dtor(lengths);
+
+    return diff.bytes_live;
+}
+
+int main(void)
+{
+    Result_PoolResource pool_res = pool_resource_ctor(SUBPOOL_COUNT);
+    Result_MultiPoolResource multi_res = multi_pool_resource_ctor(
+        SUBPOOL_COUNT, MAX_BLOCK_SIZE, get_malloc_resource());
+    if (pool_res.error_code || multi_res.error_code)
+    {
+        fprintf(stderr, "failed to construct resources\n");
+        return 1;
+    }
+
+    printf("%d strings of 1..%d characters\n\n", STRING_COUNT, MAX_LENGTH);
+    printf("pool:       %8zu KiB\n", run(&pool_res.value.base) / 1024);
+    printf("multi pool: %8zu KiB\n", run(&multi_res.value.base) / 1024);
+
+    multi_pool_resource_dtor(&multi_res.value);
+    pool_resource_dtor(&pool_res.value);
+
+    return 0;
+}
@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <threads.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ConcurrentPoolResource.h"
+#include "LockFreePoolResource.h"
+
+enum
+{
+    ROUND_COUNT = 100000,
+    BATCH_SIZE = 32,
+    BLOCK_SIZE = 64,
+    CHUNK_COUNT = 4096,
+    MAX_THREADS = 256,
+};
+
+typedef struct WorkerArgs
+{
+    MemoryResource* resource;
+    bool ok;
+} WorkerArgs;
+
+static double seconds_now(void)
+{
+    struct timespec time = {};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double)time.tv_sec + (double)time.tv_nsec * 1e-9;
+}
+
+/**
+ * Every round allocates a batch of blocks, touches them and frees them again,
+ * so all threads hammer the same free list.
+ */
+static int run_worker(void* arg)
+{
+    WorkerArgs* args = arg;
+    void* blocks[BATCH_SIZE] = {};
+
+    args->ok = true;
+
+    for (size_t round = 0; round < ROUND_COUNT; ++round)
+    {
+        for (size_t i = 0; i < BATCH_SIZE; ++i)
+        {
+            blocks[i] = args->resource->allocate(args->resource,
+                BLOCK_SIZE,
+                alignof(max_align_t));
+            if (!blocks[i])
+            {
+                args->ok = false;
+                return 0;
+            }
+            *(volatile size_t*)blocks[i] = round;
+        }
+
+        for (size_t i = 0; i < BATCH_SIZE; ++i)
+        {
+            args->resource->deallocate(args->resource, blocks[i]);
+        }
+    }
+
+    return 0;
+}
+
+static bool run_threads(MemoryResource* resource,
+    size_t thread_count,
+    double* elapsed)
+{
+    thrd_t threads[MAX_THREADS] = {};
+    WorkerArgs args[MAX_THREADS] = {};
+    size_t started = 0;
+    bool ok = true;
+
+    double begin = seconds_now();
+
+    for (; started < thread_count; ++started)
+    {
+        args[started].resource = resource;
+        if (thrd_create(&threads[started], run_worker, &args[started])
+            != thrd_success)
+        {
+            ok = false;
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < started; ++i)
+    {
+        thrd_join(threads[i], NULL);
+        ok &= args[i].ok;
+    }
+
+    *elapsed = seconds_now() - begin;
+    return ok;
+}
+
+static void print_result(const char* name, size_t thread_count, double elapsed)
+{
+    double ops = 2.0 * ROUND_COUNT * BATCH_SIZE * (double)thread_count;
+    printf("%-9s threads %3zu: %8.3f ms  %8.2f Mops/s\n",
+        name,
+        thread_count,
+        elapsed * 1e3,
+        ops / elapsed * 1e-6);
+}
+
+int main(int argc, char** argv)
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t max_threads = cores > 0 ? (size_t)cores : 1;
+
+    if (argc > 1)
+    {
+        max_threads = strtoul(argv[1], NULL, 10);
+    }
+    max_threads = MIN(MAX(max_threads, 1ul), (size_t)MAX_THREADS);
+
+    printf("rounds: %d, batch: %d, block: %d bytes, threads: 1..%zu\n\n",
+        ROUND_COUNT,
+        BATCH_SIZE,
+        BLOCK_SIZE,
+        max_threads);
+
+    Result_LockFreePoolResource lock_free =
+        lock_free_pool_resource_ctor(BLOCK_SIZE,
+            alignof(max_align_t),
+            CHUNK_COUNT);
+    Result_ConcurrentPoolResource concurrent =
+        concurrent_pool_resource_ctor(CHUNK_COUNT);
+
+    if (lock_free.error_code != EVERYTHING_FINE
+        || concurrent.error_code != EVERYTHING_FINE)
+    {
+        fprintf(stderr, "failed to construct resources\n");
+        return 1;
+    }
+
+    struct
+    {
+        const char* name;
+        MemoryResource* resource;
+    } resources[] = {
+        {"lockfree", &lock_free.value.base},
+        {"magazine", &concurrent.value.base},
+        {"malloc", get_malloc_resource()},
+    };
+
+    for (size_t threads = 1; threads <= max_threads; ++threads)
+    {
+        for (size_t i = 0; i < ARRAY_SIZE(resources); ++i)
+        {
+            double elapsed = 0.0;
+            if (!run_threads(resources[i].resource, threads, &elapsed))
+            {
+                fprintf(stderr, "%s failed\n", resources[i].name);
+                return 1;
+            }
+            print_result(resources[i].name, threads, elapsed);
+        }
+        printf("\n");
+    }
+
+    lock_free_pool_resource_dtor(&lock_free.value);
+    concurrent_pool_resource_dtor(&concurrent.value);
+
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include <stdio.h>
+
+#include "StackResource.h"
+#include "Vector.h"
+
+/**
+ * Parses a nested list like [1,[2,3]] and returns the sum of its numbers,
+ * each weighted by its depth. Every level collects the values of its items
+ * in a vector of its own, which is freed before the level returns, so the
+ * stack reuses the same memory for every sibling.
+ */
+static long parse_list(const char** text, MemoryResource* resource, int depth)
+{
+    long* values = vec_ctor(resource, long);
+
+    ++*text; // '['
+    while (**text && **text != ']')
+    {
+        if (**text == '[')
+        {
+            vec_add(values, parse_list(text, resource, depth + 1));
+        }
+        else if (**text >= '0' && **text <= '9')
+        {
+            long number = 0;
+            while (**text >= '0' && **text <= '9')
+            {
+                number = number * 10 + (*(*text)++ - '0');
+            }
+            vec_add(values, number * depth);
+        }
+        else
+        {
+            ++*text; // ','
+        }
+    }
+    if (**text)
+    {
+        ++*text; // ']'
+    }
+
+    long sum = 0;
+    for (size_t i = 0; i < vec_size(values); i++)
+    {
+        sum += values[i];
+    }
+
+    vec_dtor(values);
+    return sum;
+}
+
+int main(void)
+{
+    Result_StackResource stack_res = stack_resource_ctor(64 * 1024);
+    if (stack_res.error_code)
+    {
+        return 1;
+    }
+    StackResource stack = stack_res.value;
+
+    const char* inputs[] = {
+        "[1,2,3]",
+        "[1,[2,3],[[4],5]]",
+        "[[[[[[6]]]]],[7,[8,[9]]]]",
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(inputs); i++)
+    {
+        const char* text = inputs[i];
+        long sum = parse_list(&text, &stack.base, 1);
+        printf("%-28s sum %3ld, stack in use %zu bytes\n",
+            inputs[i],
+            sum,
+            stack_allocator_used(stack.stack));
+    }
+
+    stack_resource_dtor(&stack);
+    return 0;
+}
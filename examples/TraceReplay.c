@@ -0,0 +1,485 @@
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ArenaResource.h"
+#include "FreeListResource.h"
+#include "List.h"
+#include "PoolResource.h"
+#include "String.h"
+#include "TraceResource.h"
+#include "Vector.h"
+
+/**
+ * Replays an allocation trace recorded with TraceResource against malloc,
+ * Arena, Pool and FreeList and reports time, peak RSS and fragmentation.
+ * Without arguments a demo workload is recorded to demo.trace first.
+ *
+ * Records are replayed in file order on one thread, whatever thread recorded
+ * them. Every allocated or grown block is written once, like the traced
+ * program would, so the time includes the page faults of the allocator.
+ * The RSS is sampled every RSS_SAMPLE_INTERVAL records and where the trace
+ * peaks, the time spent sampling is not counted. Fragmentation is the share
+ * of the RSS growth not covered by the peak of requested live bytes.
+ */
+
+enum
+{
+    RSS_SAMPLE_INTERVAL = 4096,
+    DEMO_LIST_SIZE = 100000,
+    DEMO_STRING_COUNT = 2000,
+};
+
+typedef enum ReplayTarget
+{
+    REPLAY_MALLOC,
+    REPLAY_ARENA,
+    REPLAY_POOL,
+    REPLAY_FREE_LIST,
+    REPLAY_TARGET_COUNT,
+} ReplayTarget;
+
+static const char* TARGET_NAMES[REPLAY_TARGET_COUNT] = {
+    "malloc",
+    "arena",
+    "pool",
+    "freelist",
+};
+
+typedef struct Trace
+{
+    TraceRecord* records;
+    size_t count;
+    uint64_t max_id;
+    size_t thread_count;
+    size_t peak_live;  /**< Highest sum of requested live bytes. */
+    size_t peak_index; /**< Record after which peak_live was reached. */
+} Trace;
+
+typedef struct ReplayResult
+{
+    double millis;
+    size_t rss_growth; /**< Peak RSS growth in KiB. */
+} ReplayResult;
+
+typedef struct ReplayTask
+{
+    const Trace* trace;
+    ReplayTarget target;
+} ReplayTask;
+
+typedef struct ReplaySlot
+{
+    void* ptr;
+    size_t size;
+    size_t alignment;
+} ReplaySlot;
+
+static double millis_now(void)
+{
+    struct timespec time = {};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double)time.tv_sec * 1e3 + (double)time.tv_nsec * 1e-6;
+}
+
+/**
+ * Builds and tears down a list, strings and a vector the way a program
+ * mixing containers would.
+ */
+static ErrorCode record_demo(const char* path)
+{
+    Result_TraceResource trace_res =
+        trace_resource_ctor(get_malloc_resource(), path);
+    if (trace_res.error_code)
+    {
+        return trace_res.error_code;
+    }
+    TraceResource trace = trace_res.value;
+    MemoryResource* resource = &trace.base;
+
+    list_ctor(list, resource);
+    for (int i = 0; i < DEMO_LIST_SIZE; i++)
+    {
+        list_insert_before(list, list_end(list), i);
+    }
+
+    String* strings = vec_ctor(resource, String);
+    for (size_t i = 0; i < DEMO_STRING_COUNT; i++)
+    {
+        String string = string_ctor(resource, "").value;
+        for (size_t j = 0; j < i % 500; j++)
+        {
+            string_append_char(&string, 'x');
+        }
+        vec_add(strings, string);
+
+        // drop every third list node while the strings grow
+        for (size_t j = 0; j < DEMO_LIST_SIZE / DEMO_STRING_COUNT / 3; j++)
+        {
+            list_erase_type(list, list_begin(list), int);
+        }
+    }
+
+    for (size_t i = 0; i < vec_size(strings); i += 2)
+    {
+        string_dtor(&strings[i]);
+    }
+    list_dtor_type(list, int);
+    for (size_t i = 1; i < vec_size(strings); i += 2)
+    {
+        string_dtor(&strings[i]);
+    }
+    vec_dtor(strings);
+
+    ErrorCode error = trace_resource_flush(&trace);
+    trace_resource_dtor(&trace);
+    return error;
+}
+
+/**
+ * Reads the records of a trace into one array, so the heap of the replays
+ * does not start with the holes a growing array leaves behind.
+ */
+static ErrorCode trace_load(const char* path, Trace* trace)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file)
+    {
+        return ERROR_BAD_FILE;
+    }
+
+    ErrorCode error = trace_read_header(file);
+    long begin = ftell(file);
+    if (error || begin < 0 || fseek(file, 0, SEEK_END) != 0)
+    {
+        fclose(file);
+        return error ? error : ERROR_BAD_FILE;
+    }
+
+    long end = ftell(file);
+    size_t capacity = end > begin
+        ? (size_t)(end - begin) / sizeof(TraceRecord)
+        : 0;
+    trace->records = malloc(MAX(capacity, (size_t)1) * sizeof(TraceRecord));
+    if (!trace->records)
+    {
+        fclose(file);
+        return ERROR_NO_MEMORY;
+    }
+
+    fseek(file, begin, SEEK_SET);
+    trace->count = fread(trace->records, sizeof(TraceRecord), capacity, file);
+    fclose(file);
+
+    for (size_t i = 0; i < trace->count; i++)
+    {
+        trace->max_id = MAX(trace->max_id, trace->records[i].id);
+        trace->thread_count =
+            MAX(trace->thread_count, (size_t)trace->records[i].thread);
+    }
+
+    size_t* sizes = calloc(trace->max_id + 1, sizeof(*sizes));
+    if (!sizes)
+    {
+        return ERROR_NO_MEMORY;
+    }
+
+    size_t live = 0;
+    for (size_t i = 0; i < trace->count; i++)
+    {
+        const TraceRecord* record = &trace->records[i];
+        live -= sizes[record->id];
+        sizes[record->id] = record->op == TRACE_DEALLOCATE || !record->id
+            ? 0
+            : (size_t)record->size;
+        live += sizes[record->id];
+        if (live > trace->peak_live)
+        {
+            trace->peak_live = live;
+            trace->peak_index = i;
+        }
+    }
+    free(sizes);
+
+    return EVERYTHING_FINE;
+}
+
+/**
+ * Resident set size in KiB, read from statm_fd with pread so sampling costs
+ * a single syscall.
+ */
+static size_t rss_kib(int statm_fd)
+{
+    char buffer[128] = {};
+    if (pread(statm_fd, buffer, sizeof(buffer) - 1, 0) <= 0)
+    {
+        return 0;
+    }
+
+    size_t pages = 0;
+    size_t resident = 0;
+    if (sscanf(buffer, "%zu %zu", &pages, &resident) != 2)
+    {
+        return 0;
+    }
+
+    return resident * (size_t)sysconf(_SC_PAGESIZE) / 1024;
+}
+
+/**
+ * Replays the trace and frees the blocks it leaves behind.
+ */
+static ReplayResult replay(const Trace* trace, MemoryResource* resource)
+{
+    ReplayResult result = {.millis = -1};
+
+    size_t slot_count = trace->max_id + 1;
+    ReplaySlot* slots = malloc(slot_count * sizeof(*slots));
+    int statm_fd = open("/proc/self/statm", O_RDONLY);
+    if (!slots || statm_fd < 0)
+    {
+        free(slots);
+        return result;
+    }
+
+    // the slots are faulted in before the RSS the growth is measured from
+    memset(slots, 0, slot_count * sizeof(*slots));
+    size_t base_rss = rss_kib(statm_fd);
+    size_t peak_rss = base_rss;
+
+    double sampling = 0;
+    double begin = millis_now();
+
+    for (size_t i = 0; i < trace->count; i++)
+    {
+        const TraceRecord* record = &trace->records[i];
+        ReplaySlot* slot = &slots[record->id];
+
+        switch (record->id ? record->op : UINT8_MAX)
+        {
+        case TRACE_ALLOCATE:
+            slot->ptr = resource->allocate(resource,
+                record->size,
+                record->alignment);
+            slot->size = record->size;
+            slot->alignment = record->alignment;
+            if (slot->ptr)
+            {
+                memset(slot->ptr, 1, slot->size);
+            }
+            break;
+        case TRACE_DEALLOCATE:
+            memory_resource_deallocate_sized(resource,
+                slot->ptr,
+                slot->size,
+                slot->alignment);
+            slot->ptr = NULL;
+            break;
+        case TRACE_REALLOCATE:
+        {
+            char* ptr = memory_resource_reallocate(resource,
+                slot->ptr,
+                slot->size,
+                record->size,
+                slot->alignment);
+            if (ptr)
+            {
+                if (record->size > slot->size)
+                {
+                    memset(ptr + slot->size, 1, record->size - slot->size);
+                }
+                slot->ptr = ptr;
+                slot->size = record->size;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+        if (i % RSS_SAMPLE_INTERVAL == 0 || i == trace->peak_index)
+        {
+            double sample_begin = millis_now();
+            peak_rss = MAX(peak_rss, rss_kib(statm_fd));
+            sampling += millis_now() - sample_begin;
+        }
+    }
+
+    result.millis = millis_now() - begin - sampling;
+    result.rss_growth = MAX(peak_rss, rss_kib(statm_fd)) - base_rss;
+
+    for (uint64_t id = 1; id <= trace->max_id; id++)
+    {
+        memory_resource_deallocate_sized(resource,
+            slots[id].ptr,
+            slots[id].size,
+            slots[id].alignment);
+    }
+    free(slots);
+    close(statm_fd);
+
+    return result;
+}
+
+static int record_demo_child(const void* path)
+{
+    return record_demo(path) != EVERYTHING_FINE;
+}
+
+static int replay_child(const void* arg)
+{
+    const ReplayTask* task = arg;
+    const Trace* trace = task->trace;
+    ReplayTarget target = task->target;
+
+    ArenaResource arena = {};
+    PoolResource pool = {};
+    FreeListResource free_list = {};
+    MemoryResource* resource = NULL;
+    ErrorCode error = EVERYTHING_FINE;
+
+    switch (target)
+    {
+    case REPLAY_MALLOC:
+        resource = get_malloc_resource();
+        break;
+    case REPLAY_ARENA:
+    {
+        Result_ArenaResource res = arena_resource_ctor_growable(1 << 20, 2);
+        arena = res.value;
+        error = res.error_code;
+        resource = &arena.base;
+        break;
+    }
+    case REPLAY_POOL:
+    {
+        Result_PoolResource res = pool_resource_ctor(256);
+        pool = res.value;
+        error = res.error_code;
+        resource = &pool.base;
+        break;
+    }
+    case REPLAY_FREE_LIST:
+    {
+        Result_FreeListResource res = free_list_resource_ctor(1 << 20);
+        free_list = res.value;
+        error = res.error_code;
+        resource = &free_list.base;
+        break;
+    }
+    default:
+        return 1;
+    }
+
+    if (error)
+    {
+        fprintf(stderr, "failed to construct %s\n", TARGET_NAMES[target]);
+        return 1;
+    }
+
+    ReplayResult result = replay(trace, resource);
+
+    size_t growth = result.rss_growth;
+    size_t peak_live = trace->peak_live / 1024;
+    double fragmentation =
+        growth > peak_live ? 100.0 * (double)(growth - peak_live) / growth : 0;
+
+    printf("%-10s %10.2f ms %10zu KiB %12.1f%%\n",
+        TARGET_NAMES[target],
+        result.millis,
+        growth,
+        fragmentation);
+
+    switch (target)
+    {
+    case REPLAY_ARENA:
+        arena_resource_dtor(&arena);
+        break;
+    case REPLAY_POOL:
+        pool_resource_dtor(&pool);
+        break;
+    case REPLAY_FREE_LIST:
+        free_list_resource_dtor(&free_list);
+        break;
+    default:
+        break;
+    }
+
+    return result.millis < 0;
+}
+
+/**
+ * Runs func in a forked child and returns its exit code, 1 if it did not
+ * exit normally.
+ */
+static int run_in_child(int (*func)(const void* arg), const void* arg)
+{
+    fflush(stdout);
+
+    pid_t child = fork();
+    if (child == 0)
+    {
+        int code = func(arg);
+        fflush(stdout);
+        _exit(code);
+    }
+
+    int status = 0;
+    if (child < 0 || waitpid(child, &status, 0) < 0 || !WIFEXITED(status))
+    {
+        return 1;
+    }
+
+    return WEXITSTATUS(status);
+}
+
+int main(int argc, char* argv[])
+{
+    const char* path = argc > 1 ? argv[1] : "demo.trace";
+
+    // recorded in a child, so the replays do not inherit its heap
+    if (argc <= 1 && run_in_child(record_demo_child, path) != 0)
+    {
+        fprintf(stderr, "failed to record %s\n", path);
+        return 1;
+    }
+
+    Trace trace = {};
+    if (trace_load(path, &trace) != EVERYTHING_FINE)
+    {
+        fprintf(stderr, "failed to load %s\n", path);
+        free(trace.records);
+        return 1;
+    }
+
+    printf("%s: %zu records, %zu threads, peak live %zu KiB\n\n",
+        path,
+        trace.count,
+        trace.thread_count,
+        trace.peak_live / 1024);
+    printf("%-10s %13s %14s %13s\n",
+        "allocator",
+        "time",
+        "RSS growth",
+        "fragmentation");
+    fflush(stdout);
+
+    // every allocator starts from the same process state
+    int status = 0;
+    for (size_t i = 0; i < REPLAY_TARGET_COUNT; i++)
+    {
+        ReplayTask task = {
+            .trace = &trace,
+            .target = (ReplayTarget)i,
+        };
+        status |= run_in_child(replay_child, &task);
+    }
+
+    free(trace.records);
+    return status;
+}
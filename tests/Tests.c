@@ -3,17 +3,30 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <threads.h>
 
 #include "Allocator.h"
 #include "Arena.h"
 #include "ArenaResource.h"
+#include "ConcurrentPool.h"
+#include "ConcurrentPoolResource.h"
 #include "Error.h"
 #include "FreeList.h"
 #include "FreeListResource.h"
 #include "IO.h"
 #include "List.h"
+#include "LockFreePool.h"
+#include "LockFreePoolResource.h"
+#include "MonotonicResource.h"
+#include "MultiPoolResource.h"
 #include "Pool.h"
+#include "PoolResource.h"
+#include "StackAllocator.h"
+#include "StackResource.h"
+#include "StatsResource.h"
 #include "String.h"
+#include "TraceResource.h"
 #include "Vector.h"
 #include "details/CountingMalloc.h"
 
@@ -74,6 +87,38 @@ static size_t find_max_int_count(size_t size)
     return max_ints;
 }
 
+/**
+ * Number of blocks of size bytes a subpool of pool_ctor(count) holds.
+ */
+static size_t find_pool_capacity(size_t count, size_t size)
+{
+    Pool* pool = pool_ctor(count);
+    if (!pool || !pool_allocate(pool, size, 8))
+    {
+        pool_dtor(pool);
+        return 0;
+    }
+
+    size_t prev_allocations = standard_allocations_count;
+
+    size_t capacity = 1;
+
+    while (prev_allocations == standard_allocations_count)
+    {
+        if (!pool_allocate(pool, size, 8))
+        {
+            pool_dtor(pool);
+            return 0;
+        }
+        capacity++;
+    }
+    capacity--;
+
+    pool_dtor(pool);
+
+    return capacity;
+}
+
 static bool test_arena(void)
 {
     bool result = true;
@@ -119,6 +164,174 @@ static bool test_arena(void)
     return result;
 }
 
+static bool test_arena_growable(void)
+{
+    bool result = true;
+
+    constexpr size_t block_size = 256;
+    constexpr size_t int_count = 1000;
+
+    ASSERT_NULL(arena_ctor_growable(0, 2));
+    ASSERT_NULL(arena_ctor_growable(block_size, 0));
+
+    size_t prev_live = standard_allocations_count - standard_frees_count;
+
+    Arena* arena = arena_ctor_growable(block_size, 2);
+    ASSERT_NOT_NULL(arena);
+
+    int* ints[int_count] = {};
+    for (size_t i = 0; i < int_count; i++)
+    {
+        ints[i] = arena_allocate_type(arena, int);
+        ASSERT_NOT_NULL(ints[i]);
+        *ints[i] = (int)i;
+    }
+
+    // larger than any block so far
+    char* large = arena_allocate(arena, 64 * block_size, 64);
+    ASSERT_NOT_NULL(large);
+    ASSERT_TRUE((uintptr_t)large % 64 == 0);
+
+    for (size_t i = 0; i < int_count; i++)
+    {
+        ASSERT_TRUE(*ints[i] == (int)i);
+    }
+
+    // the largest block is kept and fits the workload again
+    for (size_t round = 0; round < 3; round++)
+    {
+        arena_flush(arena);
+
+        size_t prev_allocations = standard_allocations_count;
+        for (size_t i = 0; i < int_count; i++)
+        {
+            ASSERT_NOT_NULL(arena_allocate_type(arena, int));
+        }
+        ASSERT_TRUE(prev_allocations == standard_allocations_count);
+    }
+
+    arena_dtor(arena);
+
+    ASSERT_TRUE(prev_live == standard_allocations_count - standard_frees_count);
+
+    return result;
+}
+
+static bool test_arena_mark(void)
+{
+    bool result = true;
+
+    Arena* arena = arena_ctor(1024);
+    ASSERT_NOT_NULL(arena);
+
+    int* kept = arena_allocate_type(arena, int);
+    ASSERT_NOT_NULL(kept);
+
+    ArenaMark mark = arena_mark(arena);
+    char* temp = arena_allocate(arena, 512, 1);
+    ASSERT_NOT_NULL(temp);
+    arena_rewind(arena, mark);
+    ASSERT_TRUE(arena_allocate(arena, 512, 1) == temp);
+    arena_rewind(arena, mark);
+
+    char* outer = NULL;
+    char* inner = NULL;
+    ARENA_SCOPE(arena)
+    {
+        outer = arena_allocate(arena, 256, 1);
+        ARENA_SCOPE(arena)
+        {
+            inner = arena_allocate(arena, 256, 1);
+        }
+        ASSERT_TRUE(arena_allocate(arena, 256, 1) == inner);
+    }
+    ASSERT_NOT_NULL(outer);
+    ASSERT_TRUE(arena_allocate(arena, 256, 1) == outer);
+
+    arena_dtor(arena);
+
+    // blocks chained inside a scope are reused by the next one
+    arena = arena_ctor_growable(128, 2);
+    ASSERT_NOT_NULL(arena);
+
+    size_t prev_allocations = standard_allocations_count;
+    for (size_t round = 0; round < 4; round++)
+    {
+        ARENA_SCOPE(arena)
+        {
+            for (size_t i = 0; i < 100; i++)
+            {
+                ASSERT_NOT_NULL(arena_allocate(arena, 24, 8));
+            }
+        }
+
+        if (round == 0)
+        {
+            prev_allocations = standard_allocations_count;
+        }
+    }
+    ASSERT_TRUE(prev_allocations == standard_allocations_count);
+
+    arena_dtor(arena);
+
+    return result;
+}
+
+static bool test_arena_virtual(void)
+{
+    bool result = true;
+
+    constexpr size_t reserve_size = 1ul << 30;
+    constexpr size_t int_count = 100'000;
+
+    ASSERT_NULL(arena_ctor_virtual(0));
+
+    Result_ArenaResource resource_res =
+        arena_resource_ctor_virtual(reserve_size);
+    ASSERT_NO_ERROR(resource_res.error_code);
+    ArenaResource resource = resource_res.value;
+    Arena* arena = resource.arena;
+
+    char* first = arena_allocate(arena, 8, 8);
+    ASSERT_NOT_NULL(first);
+
+    // a vector grown in place of the arena keeps all its old copies
+    int* vec = vec_ctor(&resource.base, int);
+    ASSERT_NOT_NULL(vec);
+    for (size_t i = 0; i < int_count; i++)
+    {
+        ASSERT_NO_ERROR(vec_add(vec, (int)i));
+    }
+    VEC_ITER(vec, i)
+    {
+        ASSERT_TRUE(vec[i] == (int)i);
+    }
+
+    char* large = arena_allocate(arena, 3 * 1024 * 1024, 4096);
+    ASSERT_NOT_NULL(large);
+    ASSERT_TRUE((uintptr_t)large % 4096 == 0);
+    ASSERT_TRUE(large > first && large - first < 8 * 1024 * 1024);
+    if (large)
+    {
+        large[3 * 1024 * 1024 - 1] = 1;
+    }
+
+    ASSERT_NULL(arena_allocate(arena, reserve_size, 1));
+
+    arena_flush(arena);
+    ASSERT_TRUE(arena_allocate(arena, 8, 8) == first);
+
+    // flush drops the pages above the first MiB, they read back as zeros
+    if (large)
+    {
+        ASSERT_TRUE(large[3 * 1024 * 1024 - 1] == 0);
+    }
+
+    arena_resource_dtor(&resource);
+
+    return result;
+}
+
 static bool test_free_list(void)
 {
     constexpr size_t free_list_size = 20000;
@@ -134,7 +347,7 @@ static bool test_free_list(void)
     ASSERT_NOT_NULL(free_list);
     ASSERT_TRUE(prev_allocations + 1 == standard_allocations_count);
 
-    ASSERT_NULL(free_list_allocate(free_list, UINT32_MAX, 8));
+    ASSERT_NULL(free_list_allocate(free_list, SIZE_MAX, 8));
 
     prev_allocations = standard_allocations_count;
     int* p1 = free_list_allocate_type(free_list, int);
@@ -159,7 +372,7 @@ static bool test_free_list(void)
 
     for (size_t i = 0; i < int_count / 7; i++)
     {
-        size_t random_index = rand() % int_count;
+        size_t random_index = rand() % (int_count - 4);
         for (size_t j = 0; j < 5; j++)
         {
             free_list_deallocate(free_list, ptrs[random_index + j]);
@@ -196,6 +409,184 @@ static bool test_free_list(void)
     return result;
 }
 
+static bool test_free_list_coalescing(void)
+{
+    bool result = true;
+
+    constexpr size_t free_list_size = 4096;
+    constexpr size_t block_count = 32;
+
+    FreeList* free_list = free_list_ctor(free_list_size);
+    ASSERT_NOT_NULL(free_list);
+
+    size_t prev_allocations = standard_allocations_count;
+
+    void* ptrs[block_count] = {};
+    for (size_t i = 0; i < block_count; i++)
+    {
+        ptrs[i] = free_list_allocate(free_list, 16 + i % 5 * 24, 8);
+        ASSERT_NOT_NULL(ptrs[i]);
+    }
+
+    // free every other block first, then the rest, so both neighbours merge
+    for (size_t i = 0; i < block_count; i += 2)
+    {
+        free_list_deallocate(free_list, ptrs[i]);
+    }
+    for (size_t i = 1; i < block_count; i += 2)
+    {
+        free_list_deallocate(free_list, ptrs[i]);
+    }
+
+    ASSERT_NOT_NULL(free_list_allocate(free_list, free_list_size - 64, 8));
+    ASSERT_TRUE(prev_allocations == standard_allocations_count);
+
+    free_list_dtor(free_list);
+    return result;
+}
+
+static bool test_free_list_size_classes(void)
+{
+    bool result = true;
+
+    constexpr size_t free_list_size = 64 * 1024;
+    constexpr size_t block_count = 128;
+
+    FreeList* free_list = free_list_ctor(free_list_size);
+    ASSERT_NOT_NULL(free_list);
+
+    size_t prev_allocations = standard_allocations_count;
+
+    char* ptrs[block_count] = {};
+    for (size_t i = 0; i < block_count; i++)
+    {
+        ptrs[i] = free_list_allocate(free_list, 8 + i * 3, 8);
+        ASSERT_NOT_NULL(ptrs[i]);
+    }
+
+    // leave holes of every size between live blocks
+    for (size_t i = 0; i < block_count; i += 2)
+    {
+        free_list_deallocate(free_list, ptrs[i]);
+    }
+
+    for (size_t i = 0; i < block_count; i += 2)
+    {
+        size_t size = 8 + i * 3;
+        ptrs[i] = free_list_allocate(free_list, size, 8);
+        ASSERT_NOT_NULL(ptrs[i]);
+        memset(ptrs[i], (int)i, size);
+    }
+
+    char* large = free_list_allocate(free_list, 20000, 64);
+    ASSERT_NOT_NULL(large);
+    ASSERT_TRUE((uintptr_t)large % 64 == 0);
+    ASSERT_TRUE(prev_allocations == standard_allocations_count);
+
+    for (size_t i = 0; i < block_count; i += 2)
+    {
+        ASSERT_TRUE(ptrs[i][0] == (char)i && ptrs[i][7 + i * 3] == (char)i);
+    }
+
+    // too large for any bin, needs a new pool that later requests find
+    void* huge = free_list_allocate(free_list, free_list_size, 8);
+    ASSERT_NOT_NULL(huge);
+    ASSERT_TRUE(prev_allocations + 1 == standard_allocations_count);
+    free_list_deallocate(free_list, huge);
+    ASSERT_NOT_NULL(free_list_allocate(free_list, free_list_size, 8));
+    ASSERT_TRUE(prev_allocations + 1 == standard_allocations_count);
+
+    free_list_dtor(free_list);
+    return result;
+}
+
+static bool test_free_list_many_pools(void)
+{
+    bool result = true;
+
+    constexpr size_t free_list_size = 1024;
+    constexpr size_t block_count = 100;
+
+    size_t prev_live = standard_allocations_count - standard_frees_count;
+
+    FreeList* free_list = free_list_ctor(free_list_size);
+    ASSERT_NOT_NULL(free_list);
+
+    // every block takes a pool of its own
+    char* ptrs[block_count] = {};
+    for (size_t i = 0; i < block_count; i++)
+    {
+        ptrs[i] = free_list_allocate(free_list, free_list_size - 100, 8);
+        ASSERT_NOT_NULL(ptrs[i]);
+    }
+
+    for (size_t i = 0; i < block_count; i += 3)
+    {
+        free_list_deallocate(free_list, ptrs[i]);
+    }
+    for (size_t i = block_count; i-- > 0;)
+    {
+        if (i % 3 != 0)
+        {
+            free_list_deallocate(free_list, ptrs[i]);
+        }
+    }
+
+    size_t prev_allocations = standard_allocations_count;
+    for (size_t i = 0; i < block_count; i++)
+    {
+        ptrs[i] = free_list_allocate(free_list, free_list_size - 100, 8);
+        ASSERT_NOT_NULL(ptrs[i]);
+    }
+    ASSERT_TRUE(prev_allocations == standard_allocations_count);
+
+    free_list_dtor(free_list);
+
+    ASSERT_TRUE(prev_live == standard_allocations_count - standard_frees_count);
+
+    return result;
+}
+
+static bool test_free_list_large_blocks(void)
+{
+    bool result = true;
+
+    constexpr size_t free_list_size = 4096;
+    constexpr size_t large_size = (size_t)UINT32_MAX + 4096;
+
+    FreeList* free_list = free_list_ctor(free_list_size);
+    ASSERT_NOT_NULL(free_list);
+
+    size_t prev_allocations = standard_allocations_count;
+
+    // too large for a block header, served by a mapping of its own
+    char* huge = free_list_allocate(free_list, large_size, 8);
+    ASSERT_NOT_NULL(huge);
+    if (huge)
+    {
+        huge[0] = 1;
+        huge[large_size - 1] = 2;
+        ASSERT_TRUE(huge[0] + huge[large_size - 1] == 3);
+    }
+
+    char* aligned = free_list_allocate(free_list, 1024 * 1024, 1024 * 1024);
+    ASSERT_NOT_NULL(aligned);
+    ASSERT_TRUE((uintptr_t)aligned % (1024 * 1024) == 0);
+
+    int* small = free_list_allocate_type(free_list, int);
+    ASSERT_NOT_NULL(small);
+
+    free_list_deallocate(free_list, huge);
+    free_list_deallocate(free_list, small);
+
+    // the side table is the only allocation on the heap
+    ASSERT_TRUE(prev_allocations + 1 == standard_allocations_count);
+
+    // aligned is left for free_list_dtor to unmap
+    free_list_dtor(free_list);
+    return result;
+}
+
 static bool test_free_list_dump(void)
 {
     bool result = true;
@@ -288,47 +679,1580 @@ static bool test_pool(void)
     return result;
 }
 
-static bool test_list(void)
+static bool test_pool_classes(void)
 {
     bool result = true;
 
-    size_t prev_allocations = standard_allocations_count;
-    list_ctor(list, get_malloc_resource());
-    ASSERT_TRUE(prev_allocations == standard_allocations_count);
+    constexpr size_t count = 64;
+    const size_t sizes[] = {sizeof(int), 100, 4000, 0, 100};
 
-    ASSERT_TRUE(list_begin(list) == list_end(list));
+    size_t prev_allocations = standard_allocations_count;
 
-    ListNode* ten = list_insert_after(list, list_end(list), 10);
-    ListNode* twenty = list_insert_after(list, ten, 20);
-    ListNode* five = list_insert_before(list, ten, 5);
+    Pool* pool = pool_ctor_classes(count, sizes, sizeof(sizes) / sizeof(*sizes));
+    ASSERT_NOT_NULL(pool);
+    // pool, three subpools and the descriptor of the 4000 bytes class
+    ASSERT_TRUE(prev_allocations + 5 == standard_allocations_count);
 
-    ASSERT_NOT_NULL(ten);
-    ASSERT_NOT_NULL(twenty);
-    ASSERT_NOT_NULL(five);
+    prev_allocations = standard_allocations_count;
 
-    int expected[] = {5, 10, 20};
-    size_t i = 0;
-    LIST_ITER(list, node)
+    for (size_t i = 0; i < count; i++)
     {
-        ASSERT_TRUE(i < ARRAY_SIZE(expected));
-        ASSERT_TRUE(*list_node_get_value(node, int) == expected[i]);
-        i++;
+        ASSERT_NOT_NULL(pool_allocate_type(pool, int));
+        ASSERT_NOT_NULL(pool_allocate(pool, 100, 4));
+        ASSERT_NOT_NULL(pool_allocate(pool, 4000, 8));
     }
-    ASSERT_TRUE(i == ARRAY_SIZE(expected));
+    ASSERT_TRUE(prev_allocations == standard_allocations_count);
 
-    list_erase(list, ten);
+    ASSERT_NOT_NULL(pool_allocate(pool, 4000, 8));
+    ASSERT_TRUE(prev_allocations + 1 == standard_allocations_count);
 
-    int expected_after_erase[] = {5, 20};
-    i = 0;
-    LIST_ITER(list, node)
-    {
-        ASSERT_TRUE(i < ARRAY_SIZE(expected_after_erase));
-        ASSERT_TRUE(*list_node_get_value(node, int) == expected_after_erase[i]);
-        i++;
-    }
-    ASSERT_TRUE(i == ARRAY_SIZE(expected_after_erase));
+    pool_dtor(pool);
+    return result;
+}
 
-    list_dtor(list);
+static bool test_pool_trim(void)
+{
+    bool result = true;
+
+    constexpr size_t count = 4;
+    constexpr size_t block_size = 1024;
+    constexpr size_t max_blocks = 256;
+
+    size_t capacity = find_pool_capacity(count, block_size);
+    size_t total = capacity * 3;
+    ASSERT_TRUE(capacity >= count && total <= max_blocks);
+
+    Pool* pool = pool_ctor(count);
+    ASSERT_NOT_NULL(pool);
+
+    void* ptrs[max_blocks] = {};
+    for (size_t i = 0; i < total; i++)
+    {
+        ptrs[i] = pool_allocate(pool, block_size, 8);
+        ASSERT_NOT_NULL(ptrs[i]);
+    }
+
+    size_t prev_allocations = standard_allocations_count;
+    size_t prev_frees = standard_frees_count;
+
+    // the first emptied subpool is retained, the next ones are released
+    for (size_t i = 0; i < total; i++)
+    {
+        pool_deallocate(pool, ptrs[i]);
+    }
+    ASSERT_TRUE(prev_frees + 2 == standard_frees_count);
+
+    // alloc/free at the boundary reuses the retained subpool
+    for (size_t i = 0; i < 3; i++)
+    {
+        pool_deallocate(pool, pool_allocate(pool, block_size, 8));
+    }
+    ASSERT_TRUE(prev_allocations == standard_allocations_count);
+
+    ASSERT_TRUE(pool_trim(pool) == 1);
+    ASSERT_TRUE(prev_frees + 3 == standard_frees_count);
+    ASSERT_TRUE(pool_trim(pool) == 0);
+
+    pool_set_retained_empty(pool, 0);
+    pool_deallocate(pool, pool_allocate(pool, block_size, 8));
+    ASSERT_TRUE(prev_allocations + 1 == standard_allocations_count);
+    ASSERT_TRUE(prev_frees + 4 == standard_frees_count);
+
+    pool_dtor(pool);
+    return result;
+}
+
+static bool test_pool_small_count(void)
+{
+    bool result = true;
+
+    constexpr size_t count = 8;
+    constexpr size_t block_count = 100'000;
+    constexpr size_t block_size = 16;
+
+    MallocStats before = cmlib_details_malloc_stats();
+
+    Pool* pool = pool_ctor(count);
+    ASSERT_NOT_NULL(pool);
+
+    bool allocated = true;
+    for (size_t i = 0; i < block_count; i++)
+    {
+        allocated &= pool_allocate(pool, block_size, 8) != NULL;
+    }
+    ASSERT_TRUE(allocated);
+
+    MallocStats used =
+        cmlib_details_malloc_stats_diff(before, cmlib_details_malloc_stats());
+
+    // subpools fill their 64 KiB slabs instead of holding count blocks each
+    ASSERT_TRUE(used.allocations < block_count / 1000);
+    ASSERT_TRUE(used.bytes_live < 2 * block_count * block_size);
+
+    pool_dtor(pool);
+    return result;
+}
+
+static bool test_pool_bulk(void)
+{
+    bool result = true;
+
+    constexpr size_t count = 3000;
+
+    Pool* pool = pool_ctor(1024);
+    ASSERT_NOT_NULL(pool);
+
+    static size_t* ptrs[count] = {};
+    ASSERT_TRUE(pool_allocate_bulk(pool, 24, 8, count, (void**)ptrs) == count);
+    for (size_t i = 0; i < count; i++)
+    {
+        ASSERT_NOT_NULL(ptrs[i]);
+        ASSERT_TRUE((uintptr_t)ptrs[i] % 8 == 0);
+        *ptrs[i] = i;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        ASSERT_TRUE(*ptrs[i] == i);
+    }
+
+    // freed runs are reused before new subpools are created
+    size_t prev_allocations = standard_allocations_count;
+    pool_deallocate_bulk(pool, (void**)ptrs, 100);
+    pool_deallocate(pool, ptrs[100]);
+    ASSERT_TRUE(pool_allocate_bulk(pool, 24, 8, 101, (void**)ptrs) == 101);
+    ASSERT_TRUE(prev_allocations == standard_allocations_count);
+
+    // single blocks and bulk runs mix, NULL entries are skipped
+    size_t* last = ptrs[count - 1];
+    ptrs[count - 1] = NULL;
+    pool_deallocate(pool, pool_allocate(pool, 24, 8));
+    pool_deallocate_bulk(pool, (void**)ptrs, count);
+    pool_deallocate(pool, last);
+
+    // every subpool became empty, the first one is retained
+    ASSERT_TRUE(pool_trim(pool) == 1);
+
+    pool_dtor(pool);
+    return result;
+}
+
+static bool test_pool_large_blocks(void)
+{
+    bool result = true;
+
+    constexpr size_t count = 3;
+    constexpr size_t size = 100'000;
+
+    Pool* pool = pool_ctor(count);
+    ASSERT_NOT_NULL(pool);
+
+    char* ptrs[count] = {};
+    for (size_t i = 0; i < count; i++)
+    {
+        ptrs[i] = pool_allocate(pool, size, 8);
+        ASSERT_NOT_NULL(ptrs[i]);
+        ptrs[i][0] = (char)i;
+        ptrs[i][size - 1] = (char)i;
+    }
+
+    size_t prev_allocations = standard_allocations_count;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        ASSERT_TRUE(ptrs[i][0] == (char)i && ptrs[i][size - 1] == (char)i);
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        pool_deallocate(pool, ptrs[i]);
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        ASSERT_NOT_NULL(pool_allocate(pool, size, 8));
+    }
+    ASSERT_TRUE(prev_allocations == standard_allocations_count);
+
+    pool_dtor(pool);
+    return result;
+}
+
+enum
+{
+    CONCURRENT_TEST_THREADS = 4,
+    CONCURRENT_TEST_BLOCKS = 10'000,
+};
+
+typedef struct ConcurrentPoolTestArgs
+{
+    ConcurrentPool* pool;
+    size_t* blocks[CONCURRENT_TEST_BLOCKS];
+    size_t id;
+    bool ok;
+} ConcurrentPoolTestArgs;
+
+static bool test_huge_pages(void)
+{
+    bool result = true;
+
+    constexpr size_t huge_page = 2 * 1024 * 1024;
+    constexpr size_t node_count = 100'000;
+
+    ASSERT_NULL(arena_ctor_huge(0));
+    ASSERT_NULL(pool_ctor_huge(0));
+    ASSERT_NULL(free_list_ctor_huge(0));
+
+    // the capacity is rounded up to a whole huge page
+    Arena* arena = arena_ctor_huge(1);
+    ASSERT_NOT_NULL(arena);
+    char* buf = arena_allocate(arena, huge_page, 1);
+    ASSERT_NOT_NULL(buf);
+    ASSERT_TRUE((uintptr_t)buf % huge_page == 0);
+    ASSERT_NULL(arena_allocate(arena, 1, 1));
+    arena_flush(arena);
+    ASSERT_TRUE(arena_allocate(arena, 8, 8) == buf);
+    arena_dtor(arena);
+
+    // a subpool of 16 blocks takes every block that fits its huge page slab
+    size_t prev_allocations = standard_allocations_count;
+    Result_PoolResource pool_res = pool_resource_ctor_huge(16);
+    ASSERT_NO_ERROR(pool_res.error_code);
+    Pool* pool = pool_res.value.pool;
+
+    static void* nodes[node_count] = {};
+    for (size_t i = 0; i < node_count; i++)
+    {
+        nodes[i] = pool_allocate(pool, 16, 8);
+        ASSERT_NOT_NULL(nodes[i]);
+        ASSERT_TRUE((uintptr_t)nodes[i] / huge_page
+            == (uintptr_t)nodes[0] / huge_page);
+    }
+    // the pool itself, slabs are mapped
+    ASSERT_TRUE(prev_allocations + 1 == standard_allocations_count);
+
+    pool_deallocate_bulk(pool, nodes, node_count);
+    pool_resource_dtor(&pool_res.value);
+
+    // the first pool grows to fill the huge page holding the free-list
+    FreeList* free_list = free_list_ctor_huge(4096);
+    ASSERT_NOT_NULL(free_list);
+    ASSERT_TRUE((uintptr_t)free_list % huge_page == 0);
+
+    char* block = free_list_allocate(free_list, 1024 * 1024, 8);
+    ASSERT_NOT_NULL(block);
+    ASSERT_TRUE(block - (char*)free_list < (ptrdiff_t)huge_page);
+
+    char* other = free_list_allocate(free_list, 1536 * 1024, 8);
+    ASSERT_NOT_NULL(other);
+    ASSERT_TRUE((uintptr_t)other / huge_page != (uintptr_t)block / huge_page);
+    if (block && other)
+    {
+        memset(block, 1, 1024 * 1024);
+        memset(other, 2, 1536 * 1024);
+    }
+
+    free_list_deallocate(free_list, block);
+    free_list_deallocate(free_list, other);
+    free_list_dtor(free_list);
+
+    return result;
+}
+
+static bool test_prefault(void)
+{
+    bool result = true;
+
+    constexpr size_t block_count = 1000;
+
+    ASSERT_FALSE(arena_prefault(NULL, 4096, false));
+    ASSERT_FALSE(pool_prefault(NULL, false));
+    ASSERT_FALSE(free_list_prefault(NULL, false));
+
+    Arena* arena = arena_ctor(1 << 20);
+    ASSERT_NOT_NULL(arena);
+    ASSERT_TRUE(arena_prefault(arena, 2 << 20, false));
+    ASSERT_TRUE(arena_prefault(arena, 16 * 1024, true));
+    ASSERT_NOT_NULL(arena_allocate(arena, 1 << 20, 1));
+    arena_dtor(arena);
+
+    // prefaulted pages of a virtual arena survive a flush
+    arena = arena_ctor_virtual(1 << 30);
+    ASSERT_NOT_NULL(arena);
+    ASSERT_TRUE(arena_prefault(arena, 4 << 20, false));
+    char* large = arena_allocate(arena, 3 << 20, 1);
+    ASSERT_NOT_NULL(large);
+    if (large)
+    {
+        large[(3 << 20) - 1] = 1;
+        arena_flush(arena);
+        ASSERT_TRUE(large[(3 << 20) - 1] == 1);
+    }
+    arena_dtor(arena);
+
+    Pool* pool = pool_ctor(64);
+    ASSERT_NOT_NULL(pool);
+    ASSERT_FALSE(pool_reserve(pool, 0, 1));
+    ASSERT_TRUE(pool_reserve(pool, 24, block_count));
+    ASSERT_TRUE(pool_prefault(pool, false));
+
+    size_t prev_allocations = standard_allocations_count;
+    ASSERT_TRUE(pool_reserve(pool, 24, block_count));
+    for (size_t i = 0; i < block_count; i++)
+    {
+        ASSERT_NOT_NULL(pool_allocate(pool, 24, 8));
+    }
+    ASSERT_TRUE(prev_allocations == standard_allocations_count);
+    pool_dtor(pool);
+
+    FreeList* free_list = free_list_ctor(4096);
+    ASSERT_NOT_NULL(free_list);
+    ASSERT_FALSE(free_list_reserve(free_list, 1 << 20));
+    ASSERT_TRUE(free_list_reserve(free_list, 10000));
+    ASSERT_TRUE(free_list_prefault(free_list, false));
+
+    prev_allocations = standard_allocations_count;
+    ASSERT_TRUE(free_list_reserve(free_list, 10000));
+    ASSERT_NOT_NULL(free_list_allocate(free_list, 10000, 8));
+    ASSERT_TRUE(prev_allocations == standard_allocations_count);
+    free_list_dtor(free_list);
+
+    return result;
+}
+
+static int concurrent_pool_test_allocate(void* arg)
+{
+    ConcurrentPoolTestArgs* args = arg;
+    args->ok = true;
+
+    for (size_t i = 0; i < CONCURRENT_TEST_BLOCKS; i++)
+    {
+        // churn the magazine before keeping the block
+        concurrent_pool_deallocate(args->pool,
+            concurrent_pool_allocate_type(args->pool, size_t));
+
+        args->blocks[i] = concurrent_pool_allocate_type(args->pool, size_t);
+        if (!args->blocks[i])
+        {
+            args->ok = false;
+            return 0;
+        }
+        *args->blocks[i] = args->id * CONCURRENT_TEST_BLOCKS + i;
+    }
+
+    return 0;
+}
+
+static int concurrent_pool_test_free(void* arg)
+{
+    ConcurrentPoolTestArgs* args = arg;
+
+    for (size_t i = 0; i < CONCURRENT_TEST_BLOCKS; i++)
+    {
+        if (*args->blocks[i] != args->id * CONCURRENT_TEST_BLOCKS + i)
+        {
+            args->ok = false;
+        }
+        concurrent_pool_deallocate(args->pool, args->blocks[i]);
+    }
+
+    return 0;
+}
+
+static bool test_stack_allocator(void)
+{
+    bool result = true;
+
+    ASSERT_NULL(stack_allocator_ctor(0));
+
+    StackAllocator* stack = stack_allocator_ctor(4096);
+    ASSERT_NOT_NULL(stack);
+
+    // freeing the top block gives its memory back right away
+    char* first = stack_allocator_allocate(stack, 100, 8);
+    ASSERT_NOT_NULL(first);
+    size_t used = stack_allocator_used(stack);
+    char* second = stack_allocator_allocate(stack, 10, 64);
+    ASSERT_NOT_NULL(second);
+    ASSERT_TRUE((uintptr_t)second % 64 == 0 && second > first);
+    stack_allocator_deallocate(stack, second);
+    ASSERT_TRUE(stack_allocator_used(stack) == used);
+    ASSERT_TRUE(stack_allocator_allocate(stack, 10, 64) == second);
+
+    // a block freed out of order is popped with the blocks above it
+    char* third = stack_allocator_allocate(stack, 200, 8);
+    ASSERT_NOT_NULL(third);
+    stack_allocator_deallocate(stack, second);
+    ASSERT_TRUE(stack_allocator_used(stack) > used);
+    stack_allocator_deallocate(stack, third);
+    ASSERT_TRUE(stack_allocator_used(stack) == used);
+    stack_allocator_deallocate(stack, first);
+    ASSERT_TRUE(stack_allocator_used(stack) == 0);
+
+    // the top block resizes in place, others move
+    first = stack_allocator_allocate(stack, 16, 8);
+    memset(first, 7, 16);
+    ASSERT_TRUE(stack_allocator_reallocate(stack, first, 16, 1000, 8) == first);
+    second = stack_allocator_allocate(stack, 16, 8);
+    char* moved = stack_allocator_reallocate(stack, first, 1000, 1500, 8);
+    ASSERT_NOT_NULL(moved);
+    ASSERT_TRUE(moved > second && moved[15] == 7);
+    ASSERT_NULL(stack_allocator_allocate(stack, 4096, 8));
+    stack_allocator_deallocate(stack, moved);
+    stack_allocator_deallocate(stack, second);
+    ASSERT_TRUE(stack_allocator_used(stack) == 0);
+
+    // a top block that does not satisfy a larger alignment moves
+    first = stack_allocator_allocate(stack, 1, 64);
+    second = stack_allocator_allocate(stack, 8, 8);
+    ASSERT_TRUE((uintptr_t)second % 64 != 0);
+    memset(second, 7, 8);
+    moved = stack_allocator_reallocate(stack, second, 8, 16, 64);
+    ASSERT_NOT_NULL(moved);
+    ASSERT_TRUE((uintptr_t)moved % 64 == 0 && moved[7] == 7);
+    stack_allocator_deallocate(stack, moved);
+    stack_allocator_deallocate(stack, first);
+    ASSERT_TRUE(stack_allocator_used(stack) == 0);
+
+    ASSERT_NOT_NULL(stack_allocator_allocate_type(stack, double));
+    stack_allocator_clear(stack);
+    ASSERT_TRUE(stack_allocator_used(stack) == 0);
+
+    stack_allocator_dtor(stack);
+
+    // nested containers on the resource leave nothing behind
+    Result_StackResource stack_res = stack_resource_ctor(1 << 16);
+    ASSERT_NO_ERROR(stack_res.error_code);
+    StackResource stack_resource = stack_res.value;
+    MemoryResource* resource = &stack_resource.base;
+
+    int* outer = vec_ctor(resource, int);
+    ASSERT_NOT_NULL(outer);
+    for (int i = 0; i < 10; i++)
+    {
+        int* inner = vec_ctor(resource, int);
+        ASSERT_NOT_NULL(inner);
+        for (int j = 0; j <= i * 10; j++)
+        {
+            ASSERT_NO_ERROR(vec_add(inner, j));
+        }
+        ASSERT_NO_ERROR(vec_add(outer, inner[i * 10]));
+        vec_dtor(inner);
+    }
+    ASSERT_TRUE(vec_size(outer) == 10 && outer[9] == 90);
+    vec_dtor(outer);
+    ASSERT_TRUE(stack_allocator_used(stack_resource.stack) == 0);
+
+    stack_resource_dtor(&stack_resource);
+
+    return result;
+}
+
+static bool test_concurrent_pool(void)
+{
+    bool result = true;
+
+    ConcurrentPool* pool = concurrent_pool_ctor(256);
+    ASSERT_NOT_NULL(pool);
+
+    static ConcurrentPoolTestArgs args[CONCURRENT_TEST_THREADS] = {};
+    thrd_t threads[CONCURRENT_TEST_THREADS] = {};
+
+    for (size_t i = 0; i < CONCURRENT_TEST_THREADS; i++)
+    {
+        args[i].pool = pool;
+        args[i].id = i;
+        ASSERT_TRUE(thrd_create(&threads[i],
+                        concurrent_pool_test_allocate,
+                        &args[i])
+            == thrd_success);
+    }
+    for (size_t i = 0; i < CONCURRENT_TEST_THREADS; i++)
+    {
+        thrd_join(threads[i], NULL);
+        ASSERT_TRUE(args[i].ok);
+    }
+
+    // every thread frees the blocks allocated by its neighbour
+    for (size_t i = 0; i < CONCURRENT_TEST_THREADS; i++)
+    {
+        ASSERT_TRUE(thrd_create(&threads[i],
+                        concurrent_pool_test_free,
+                        &args[(i + 1) % CONCURRENT_TEST_THREADS])
+            == thrd_success);
+    }
+    for (size_t i = 0; i < CONCURRENT_TEST_THREADS; i++)
+    {
+        thrd_join(threads[i], NULL);
+    }
+    for (size_t i = 0; i < CONCURRENT_TEST_THREADS; i++)
+    {
+        ASSERT_TRUE(args[i].ok);
+    }
+
+    ASSERT_NOT_NULL(concurrent_pool_allocate(pool, 2000, 8));
+    ASSERT_NULL(concurrent_pool_allocate(pool, 8, 8192));
+
+    concurrent_pool_dtor(pool);
+    return result;
+}
+
+typedef struct LockFreePoolTestArgs
+{
+    LockFreePool* pool;
+    size_t id;
+    bool ok;
+} LockFreePoolTestArgs;
+
+static int lock_free_pool_test_churn(void* arg)
+{
+    LockFreePoolTestArgs* args = arg;
+    constexpr size_t batch = 64;
+    size_t* blocks[batch] = {};
+
+    args->ok = true;
+
+    for (size_t round = 0; round < 1000; round++)
+    {
+        for (size_t i = 0; i < batch; i++)
+        {
+            blocks[i] = lock_free_pool_allocate(args->pool,
+                sizeof(size_t),
+                alignof(size_t));
+            if (!blocks[i])
+            {
+                args->ok = false;
+                return 0;
+            }
+            *blocks[i] = args->id * batch + i;
+        }
+
+        for (size_t i = 0; i < batch; i++)
+        {
+            args->ok &= *blocks[i] == args->id * batch + i;
+            lock_free_pool_deallocate(args->pool, blocks[i]);
+        }
+    }
+
+    return 0;
+}
+
+static bool test_lock_free_pool(void)
+{
+    bool result = true;
+
+    ASSERT_NULL(lock_free_pool_ctor(0, 8, 16));
+    ASSERT_NULL(lock_free_pool_ctor(8, 3, 16));
+
+    LockFreePool* pool = lock_free_pool_ctor(sizeof(size_t), alignof(size_t), 16);
+    ASSERT_NOT_NULL(pool);
+
+    ASSERT_NULL(lock_free_pool_allocate(pool, 2 * sizeof(size_t), 8));
+    ASSERT_NULL(lock_free_pool_allocate(pool, sizeof(size_t), 64));
+
+    LockFreePoolTestArgs args[CONCURRENT_TEST_THREADS] = {};
+    thrd_t threads[CONCURRENT_TEST_THREADS] = {};
+
+    for (size_t i = 0; i < CONCURRENT_TEST_THREADS; i++)
+    {
+        args[i] = (LockFreePoolTestArgs) {.pool = pool, .id = i};
+        ASSERT_TRUE(
+            thrd_create(&threads[i], lock_free_pool_test_churn, &args[i])
+            == thrd_success);
+    }
+    for (size_t i = 0; i < CONCURRENT_TEST_THREADS; i++)
+    {
+        thrd_join(threads[i], NULL);
+        ASSERT_TRUE(args[i].ok);
+    }
+
+    lock_free_pool_dtor(pool);
+    return result;
+}
+
+static int counting_malloc_test_churn(void* arg)
+{
+    bool* ok = arg;
+
+    for (size_t i = 0; i < 1000; i++)
+    {
+        void* block = cmlib_details_malloc(48);
+        *ok &= block != NULL;
+        cmlib_details_free(block);
+    }
+
+    return 0;
+}
+
+static bool test_counting_malloc(void)
+{
+    bool result = true;
+
+    MallocStats before = cmlib_details_malloc_stats();
+
+    char* block = cmlib_details_malloc(100);
+    int* zeroed = cmlib_details_calloc(10, sizeof(int));
+    ASSERT_NOT_NULL(block);
+    ASSERT_NOT_NULL(zeroed);
+
+    MallocStats diff =
+        cmlib_details_malloc_stats_diff(before, cmlib_details_malloc_stats());
+    ASSERT_TRUE(diff.allocations == 2);
+    ASSERT_TRUE(diff.frees == 0);
+    ASSERT_TRUE(diff.bytes_requested == 100 + 10 * sizeof(int));
+    ASSERT_TRUE(diff.bytes_live >= 100 + 10 * sizeof(int));
+
+    block = cmlib_details_realloc(block, 1000);
+    ASSERT_NOT_NULL(block);
+    cmlib_details_free(block);
+    cmlib_details_free(zeroed);
+
+    diff =
+        cmlib_details_malloc_stats_diff(before, cmlib_details_malloc_stats());
+    ASSERT_TRUE(diff.allocations == 3);
+    ASSERT_TRUE(diff.frees == 3);
+    ASSERT_TRUE(diff.bytes_live == 0);
+
+    // threads count on their own and their totals outlive them
+    bool ok[CONCURRENT_TEST_THREADS] = {};
+    thrd_t threads[CONCURRENT_TEST_THREADS] = {};
+    before = cmlib_details_malloc_stats();
+    for (size_t i = 0; i < CONCURRENT_TEST_THREADS; i++)
+    {
+        ok[i] = true;
+        ASSERT_TRUE(
+            thrd_create(&threads[i], counting_malloc_test_churn, &ok[i])
+            == thrd_success);
+    }
+    for (size_t i = 0; i < CONCURRENT_TEST_THREADS; i++)
+    {
+        thrd_join(threads[i], NULL);
+        ASSERT_TRUE(ok[i]);
+    }
+
+    diff =
+        cmlib_details_malloc_stats_diff(before, cmlib_details_malloc_stats());
+    ASSERT_TRUE(diff.allocations == CONCURRENT_TEST_THREADS * 1000);
+    ASSERT_TRUE(diff.frees == CONCURRENT_TEST_THREADS * 1000);
+    ASSERT_TRUE(diff.bytes_requested == CONCURRENT_TEST_THREADS * 1000 * 48);
+    ASSERT_TRUE(diff.bytes_live == 0);
+
+    // adding within capacity does not allocate
+    int* vec = vec_ctor(get_malloc_resource(), int);
+    ASSERT_NOT_NULL(vec);
+    before = cmlib_details_malloc_stats();
+    for (size_t i = 0; i < CMLIB_VEC_DEFAULT_CAPACITY; i++)
+    {
+        ASSERT_NO_ERROR(vec_add(vec, (int)i));
+    }
+    diff =
+        cmlib_details_malloc_stats_diff(before, cmlib_details_malloc_stats());
+    ASSERT_TRUE(diff.allocations == 0);
+    vec_dtor(vec);
+
+    return result;
+}
+
+typedef struct StatsResourceTestArgs
+{
+    MemoryResource* resource;
+    bool ok;
+} StatsResourceTestArgs;
+
+static int stats_resource_test_churn(void* arg)
+{
+    StatsResourceTestArgs* args = arg;
+    void* blocks[100] = {};
+
+    args->ok = true;
+    for (size_t round = 0; round < 10; round++)
+    {
+        for (size_t i = 0; i < ARRAY_SIZE(blocks); i++)
+        {
+            blocks[i] = args->resource->allocate(args->resource, 32, 8);
+            args->ok &= blocks[i] != NULL;
+        }
+        for (size_t i = 0; i < ARRAY_SIZE(blocks); i++)
+        {
+            args->resource->deallocate(args->resource, blocks[i]);
+        }
+    }
+
+    return 0;
+}
+
+static bool test_stats_resource(void)
+{
+    bool result = true;
+
+    Result_StatsResource stats_res = stats_resource_ctor(get_malloc_resource());
+    ASSERT_NO_ERROR(stats_res.error_code);
+    StatsResource stats_resource = stats_res.value;
+    MemoryResource* resource = &stats_resource.base;
+
+    char* small = resource->allocate(resource, 100, 8);
+    char* large = resource->allocate(resource, 200 * 1024, 16);
+    char* tiny = resource->allocate(resource, 1, 64);
+    ASSERT_NOT_NULL(small);
+    ASSERT_NOT_NULL(large);
+    ASSERT_NOT_NULL(tiny);
+    memset(small, 7, 100);
+
+    resource->deallocate(resource, large);
+    small = memory_resource_reallocate(resource, small, 100, 1000, 8);
+    ASSERT_NOT_NULL(small);
+    ASSERT_TRUE(small[0] == 7 && small[99] == 7);
+
+    MemoryStats stats = stats_resource_collect(&stats_resource);
+    ASSERT_TRUE(stats.allocations == 3);
+    ASSERT_TRUE(stats.frees == 1);
+    ASSERT_TRUE(stats.reallocations == 1);
+    ASSERT_TRUE(stats.failures == 0);
+    ASSERT_TRUE(stats.live_bytes == 1001);
+    ASSERT_TRUE(stats.peak_bytes == 100 + 200 * 1024);
+    ASSERT_TRUE(stats.sizes[0] == 1 && stats.sizes[7] == 1);
+    ASSERT_TRUE(stats.sizes[18] == 1);
+    ASSERT_TRUE(stats.alignments[3] == 1 && stats.alignments[4] == 1);
+    ASSERT_TRUE(stats.alignments[6] == 1);
+
+    ASSERT_NULL(resource->allocate(resource, SIZE_MAX, 8));
+    ASSERT_TRUE(stats_resource_collect(&stats_resource).failures == 1);
+
+    FILE* report = tmpfile();
+    ASSERT_NOT_NULL(report);
+    if (report)
+    {
+        char buffer[1024] = {};
+        memory_stats_dump_json(&stats, report);
+        rewind(report);
+        ASSERT_NOT_NULL(fgets(buffer, sizeof(buffer), report));
+        ASSERT_NOT_NULL(strstr(buffer, "\"allocations\": 3,"));
+        ASSERT_NOT_NULL(strstr(buffer, "{\"max_log2\": 18, \"count\": 1}"));
+
+        rewind(report);
+        memory_stats_dump(&stats, report);
+        rewind(report);
+        ASSERT_NOT_NULL(fgets(buffer, sizeof(buffer), report));
+        ASSERT_NOT_NULL(strstr(buffer, "allocations:"));
+        fclose(report);
+    }
+
+    resource->deallocate(resource, small);
+    resource->deallocate(resource, tiny);
+    ASSERT_TRUE(stats_resource_collect(&stats_resource).live_bytes == 0);
+
+    stats_resource_dtor(&stats_resource);
+
+    // counters of exited threads are kept
+    Result_ConcurrentPoolResource pool_res = concurrent_pool_resource_ctor(64);
+    ASSERT_NO_ERROR(pool_res.error_code);
+    ConcurrentPoolResource pool_resource = pool_res.value;
+
+    stats_res = stats_resource_ctor(&pool_resource.base);
+    ASSERT_NO_ERROR(stats_res.error_code);
+    stats_resource = stats_res.value;
+
+    StatsResourceTestArgs args[CONCURRENT_TEST_THREADS] = {};
+    thrd_t threads[CONCURRENT_TEST_THREADS] = {};
+    for (size_t i = 0; i < CONCURRENT_TEST_THREADS; i++)
+    {
+        args[i].resource = &stats_resource.base;
+        ASSERT_TRUE(
+            thrd_create(&threads[i], stats_resource_test_churn, &args[i])
+            == thrd_success);
+    }
+    for (size_t i = 0; i < CONCURRENT_TEST_THREADS; i++)
+    {
+        thrd_join(threads[i], NULL);
+        ASSERT_TRUE(args[i].ok);
+    }
+
+    stats = stats_resource_collect(&stats_resource);
+    ASSERT_TRUE(stats.allocations == CONCURRENT_TEST_THREADS * 1000);
+    ASSERT_TRUE(stats.frees == CONCURRENT_TEST_THREADS * 1000);
+    ASSERT_TRUE(stats.live_bytes == 0);
+
+    stats_resource_dtor(&stats_resource);
+    concurrent_pool_resource_dtor(&pool_resource);
+
+    return result;
+}
+
+static bool test_list(void)
+{
+    bool result = true;
+
+    size_t prev_allocations = standard_allocations_count;
+    list_ctor(list, get_malloc_resource());
+    ASSERT_TRUE(prev_allocations == standard_allocations_count);
+
+    ASSERT_TRUE(list_begin(list) == list_end(list));
+
+    ListNode* ten = list_insert_after(list, list_end(list), 10);
+    ListNode* twenty = list_insert_after(list, ten, 20);
+    ListNode* five = list_insert_before(list, ten, 5);
+
+    ASSERT_NOT_NULL(ten);
+    ASSERT_NOT_NULL(twenty);
+    ASSERT_NOT_NULL(five);
+
+    int expected[] = {5, 10, 20};
+    size_t i = 0;
+    LIST_ITER(list, node)
+    {
+        ASSERT_TRUE(i < ARRAY_SIZE(expected));
+        ASSERT_TRUE(*list_node_get_value(node, int) == expected[i]);
+        i++;
+    }
+    ASSERT_TRUE(i == ARRAY_SIZE(expected));
+
+    list_erase(list, ten);
+
+    int expected_after_erase[] = {5, 20};
+    i = 0;
+    LIST_ITER(list, node)
+    {
+        ASSERT_TRUE(i < ARRAY_SIZE(expected_after_erase));
+        ASSERT_TRUE(*list_node_get_value(node, int) == expected_after_erase[i]);
+        i++;
+    }
+    ASSERT_TRUE(i == ARRAY_SIZE(expected_after_erase));
+
+    list_dtor(list);
+
+    return result;
+}
+
+typedef struct LimitedResource
+{
+    MemoryResource base;
+    size_t left;
+} LimitedResource;
+
+static void*
+limited_resource_allocate(void* resource, size_t size, size_t alignment)
+{
+    LimitedResource* limited = resource;
+    if (limited->left == 0)
+    {
+        return NULL;
+    }
+
+    limited->left--;
+    return get_malloc_resource()->allocate(get_malloc_resource(),
+        size,
+        alignment);
+}
+
+static void limited_resource_deallocate(void* resource, void* ptr)
+{
+    (void)resource;
+    get_malloc_resource()->deallocate(get_malloc_resource(), ptr);
+}
+
+static bool test_list_bulk(void)
+{
+    bool result = true;
+
+    constexpr size_t count = 1000;
+    static int values[count] = {};
+    for (size_t i = 0; i < count; i++)
+    {
+        values[i] = (int)i;
+    }
+
+    Result_PoolResource pool_res = pool_resource_ctor(256);
+    ASSERT_NO_ERROR(pool_res.error_code);
+    PoolResource pool_resource = pool_res.value;
+
+    list_ctor(list, &pool_resource.base);
+    ListNode* head = list_insert_after(list, list_end(list), -1);
+    ASSERT_NOT_NULL(head);
+    ASSERT_TRUE(list_insert_array_after(list, head, values, 0) == head);
+
+    ListNode* last = list_insert_array_after(list, head, values, count);
+    ASSERT_NOT_NULL(last);
+    ASSERT_TRUE(last == list_end(list)->prev);
+    ASSERT_TRUE(*list_node_get_value(last, int) == (int)count - 1);
+
+    int expected = -1;
+    LIST_ITER(list, node)
+    {
+        ASSERT_TRUE(*list_node_get_value(node, int) == expected);
+        expected++;
+    }
+    ASSERT_TRUE(expected == (int)count);
+
+    list_dtor(list);
+    ASSERT_TRUE(pool_trim(pool_resource.pool) > 0);
+    pool_resource_dtor(&pool_resource);
+
+    // a failed batch leaves the list as it was
+    LimitedResource limited = {
+        .base =
+            (MemoryResource) {
+                .allocate = limited_resource_allocate,
+                .deallocate = limited_resource_deallocate,
+            },
+        .left = 100,
+    };
+    size_t prev_allocations = standard_allocations_count;
+    size_t prev_frees = standard_frees_count;
+
+    list_ctor(limited_list, &limited.base);
+    ASSERT_NOT_NULL(list_insert_array_after(limited_list,
+        list_end(limited_list),
+        values,
+        30));
+    ASSERT_NULL(list_insert_array_after(limited_list,
+        list_begin(limited_list),
+        values,
+        100));
+
+    size_t length = 0;
+    LIST_ITER(limited_list, node)
+    {
+        ASSERT_TRUE(*list_node_get_value(node, int) == (int)length);
+        length++;
+    }
+    ASSERT_TRUE(length == 30);
+
+    list_dtor(limited_list);
+    ASSERT_TRUE(standard_allocations_count - prev_allocations
+        == standard_frees_count - prev_frees);
+
+    return result;
+}
+
+static bool test_resource_reallocate(void)
+{
+    bool result = true;
+
+    // the most recent arena allocation grows in place
+    Result_ArenaResource arena_res = arena_resource_ctor(4096);
+    ASSERT_NO_ERROR(arena_res.error_code);
+    ArenaResource arena_resource = arena_res.value;
+
+    int* vec = vec_ctor(&arena_resource.base, int);
+    ASSERT_NOT_NULL(vec);
+    int* first_vec = vec;
+    for (size_t i = 0; i < 500; i++)
+    {
+        ASSERT_NO_ERROR(vec_add(vec, (int)i));
+    }
+    ASSERT_TRUE(vec == first_vec);
+    VEC_ITER(vec, i)
+    {
+        ASSERT_TRUE(vec[i] == (int)i);
+    }
+
+    arena_flush(arena_resource.arena);
+
+    Result_String string_res = string_ctor_capacity(&arena_resource.base, 1);
+    ASSERT_NO_ERROR(string_res.error_code);
+    String string = string_res.value;
+    char* first_data = string.data;
+    for (size_t i = 0; i < 100; i++)
+    {
+        ASSERT_NO_ERROR(string_append(&string, "abc"));
+    }
+    ASSERT_TRUE(string.data == first_data);
+    ASSERT_TRUE(string.size == 300 && string.data[299] == 'c');
+
+    arena_resource_dtor(&arena_resource);
+
+    // a free-list block grows into its free neighbour, otherwise it moves
+    FreeList* free_list = free_list_ctor(4096);
+    ASSERT_NOT_NULL(free_list);
+
+    char* block = free_list_allocate(free_list, 64, 8);
+    char* next = free_list_allocate(free_list, 64, 8);
+    ASSERT_NOT_NULL(block);
+    ASSERT_NOT_NULL(next);
+    memset(block, 7, 64);
+
+    free_list_deallocate(free_list, next);
+    ASSERT_TRUE(free_list_reallocate(free_list, block, 512, 8) == block);
+
+    char* blocker = free_list_allocate(free_list, 64, 8);
+    ASSERT_NOT_NULL(blocker);
+    char* moved = free_list_reallocate(free_list, block, 2048, 8);
+    ASSERT_NOT_NULL(moved);
+    ASSERT_TRUE(moved != block);
+    ASSERT_TRUE(moved[0] == 7 && moved[63] == 7);
+
+    free_list_dtor(free_list);
+
+    // resources without reallocate fall back to allocate and copy
+    Result_PoolResource pool_res = pool_resource_ctor(16);
+    ASSERT_NO_ERROR(pool_res.error_code);
+    PoolResource pool_resource = pool_res.value;
+
+    size_t* values = pool_resource.base.allocate(&pool_resource.base,
+        sizeof(size_t) * 4,
+        alignof(size_t));
+    ASSERT_NOT_NULL(values);
+    for (size_t i = 0; i < 4; i++)
+    {
+        values[i] = i;
+    }
+    values = memory_resource_reallocate(&pool_resource.base,
+        values,
+        sizeof(size_t) * 4,
+        sizeof(size_t) * 8,
+        alignof(size_t));
+    ASSERT_NOT_NULL(values);
+    ASSERT_TRUE(values[0] == 0 && values[3] == 3);
+
+    pool_resource_dtor(&pool_resource);
+
+    return result;
+}
+
+static bool test_resource_deallocate_sized(void)
+{
+    bool result = true;
+
+    // the size tells pool blocks from mapped ones without searching
+    FreeList* free_list = free_list_ctor(4096);
+    ASSERT_NOT_NULL(free_list);
+
+    char* first = free_list_allocate(free_list, 64, 8);
+    char* second = free_list_allocate(free_list, 64, 8);
+    char* third = free_list_allocate(free_list, 64, 8);
+    ASSERT_NOT_NULL(first);
+    ASSERT_NOT_NULL(second);
+    ASSERT_NOT_NULL(third);
+
+    free_list_deallocate_sized(free_list, first, 64);
+    free_list_deallocate_sized(free_list, second, 64);
+    ASSERT_TRUE(free_list_allocate(free_list, 120, 8) == first);
+
+    char* large = free_list_allocate(free_list, 1 << 20, 8);
+    ASSERT_NOT_NULL(large);
+    free_list_deallocate_sized(free_list, large, 1 << 20);
+
+    // a mapped block shrunk below the threshold moves into a pool
+    large = free_list_allocate(free_list, 1 << 20, 8);
+    ASSERT_NOT_NULL(large);
+    large[0] = 42;
+    char* shrunk = free_list_reallocate(free_list, large, 64, 8);
+    ASSERT_NOT_NULL(shrunk);
+    ASSERT_TRUE(shrunk[0] == 42);
+    free_list_deallocate_sized(free_list, shrunk, 64);
+
+    free_list_dtor(free_list);
+
+    // the size picks the magazine of a concurrent pool
+    Result_ConcurrentPoolResource concurrent_res =
+        concurrent_pool_resource_ctor(64);
+    ASSERT_NO_ERROR(concurrent_res.error_code);
+    ConcurrentPoolResource concurrent_resource = concurrent_res.value;
+    MemoryResource* resource = &concurrent_resource.base;
+
+    void* block = resource->allocate(resource, 24, 16);
+    ASSERT_NOT_NULL(block);
+    memory_resource_deallocate_sized(resource, block, 24, 16);
+    ASSERT_TRUE(resource->allocate(resource, 32, 8) == block);
+
+    int* vec = vec_ctor(resource, int);
+    ASSERT_NOT_NULL(vec);
+    for (size_t i = 0; i < 100; i++)
+    {
+        ASSERT_NO_ERROR(vec_add(vec, (int)i));
+    }
+    vec_dtor(vec);
+
+    Result_String string_res = string_ctor(resource, "sized");
+    ASSERT_NO_ERROR(string_res.error_code);
+    String string = string_res.value;
+    ASSERT_NO_ERROR(string_append(&string, " deallocation"));
+    string_dtor(&string);
+
+    list_ctor(list, resource);
+    ListNode* node = list_insert_after(list, list_end(list), 1.0);
+    ASSERT_NOT_NULL(node);
+    ASSERT_NOT_NULL(list_insert_after(list, node, 2.0));
+    list_erase_type(list, node, double);
+    ASSERT_TRUE(*list_node_get_value(list_begin(list), double) == 2.0);
+    list_dtor_type(list, double);
+
+    concurrent_pool_resource_dtor(&concurrent_resource);
+
+    // resources without deallocate_sized fall back to deallocate
+    size_t prev_frees = standard_frees_count;
+    void* ptr = get_malloc_resource()->allocate(get_malloc_resource(), 16, 8);
+    ASSERT_NOT_NULL(ptr);
+    memory_resource_deallocate_sized(get_malloc_resource(), ptr, 16, 8);
+    ASSERT_TRUE(standard_frees_count == prev_frees + 1);
+
+    return result;
+}
+
+static bool test_monotonic_resource(void)
+{
+    bool result = true;
+
+    ASSERT_ERROR(monotonic_resource_ctor(NULL, 0, NULL).error_code);
+    ASSERT_ERROR(
+        monotonic_resource_ctor(NULL, 16, get_malloc_resource()).error_code);
+
+    Result_StatsResource stats_res = stats_resource_ctor(get_malloc_resource());
+    ASSERT_NO_ERROR(stats_res.error_code);
+    StatsResource stats = stats_res.value;
+
+    char buffer[512];
+    Result_MonotonicResource monotonic_res =
+        monotonic_resource_ctor(buffer, sizeof(buffer), &stats.base);
+    ASSERT_NO_ERROR(monotonic_res.error_code);
+    MonotonicResource monotonic = monotonic_res.value;
+    MemoryResource* resource = &monotonic.base;
+
+    // small allocations are served from the buffer
+    char* first = resource->allocate(resource, 100, 8);
+    char* second = resource->allocate(resource, 100, 16);
+    ASSERT_TRUE(first >= buffer && first + 100 <= buffer + sizeof(buffer));
+    ASSERT_TRUE(second >= first + 100
+                && second + 100 <= buffer + sizeof(buffer));
+    ASSERT_TRUE((uintptr_t)second % 16 == 0);
+    resource->deallocate(resource, first);
+    ASSERT_TRUE(stats_resource_collect(&stats).allocations == 0);
+
+    // the most recent allocation grows in place
+    ASSERT_TRUE(memory_resource_reallocate(resource, second, 100, 300, 16)
+                == second);
+
+    // the rest goes to the upstream in growing blocks
+    char* overflow = resource->allocate(resource, 200, 8);
+    ASSERT_NOT_NULL(overflow);
+    ASSERT_TRUE(overflow < buffer || overflow >= buffer + sizeof(buffer));
+    ASSERT_TRUE(stats_resource_collect(&stats).allocations == 1);
+
+    char* large = resource->allocate(resource, 1 << 16, 64);
+    ASSERT_NOT_NULL(large);
+    ASSERT_TRUE((uintptr_t)large % 64 == 0);
+    memset(large, 1, 1 << 16);
+    ASSERT_TRUE(stats_resource_collect(&stats).allocations == 2);
+
+    int* vec = vec_ctor(resource, int);
+    ASSERT_NOT_NULL(vec);
+    for (int i = 0; i < 10000; i++)
+    {
+        ASSERT_NO_ERROR(vec_add(vec, i));
+    }
+    ASSERT_TRUE(vec_size(vec) == 10000 && vec[9999] == 9999);
+    vec_dtor(vec);
+
+    // release gives back every block and reuses the buffer
+    monotonic_resource_release(&monotonic);
+    MemoryStats totals = stats_resource_collect(&stats);
+    ASSERT_TRUE(totals.frees == totals.allocations);
+    ASSERT_TRUE(totals.live_bytes == 0);
+    ASSERT_TRUE(resource->allocate(resource, 100, 8) == first);
+
+    monotonic_resource_dtor(&monotonic);
+    stats_resource_dtor(&stats);
+
+    // fixed size upstreams work too
+    Result_PoolResource pool_res = pool_resource_ctor(1024);
+    ASSERT_NO_ERROR(pool_res.error_code);
+    PoolResource pool_resource = pool_res.value;
+    Result_FreeListResource free_list_res = free_list_resource_ctor(1 << 16);
+    ASSERT_NO_ERROR(free_list_res.error_code);
+    FreeListResource free_list_resource = free_list_res.value;
+
+    MemoryResource* upstreams[] = {
+        &pool_resource.base,
+        &free_list_resource.base,
+    };
+    for (size_t i = 0; i < ARRAY_SIZE(upstreams); i++)
+    {
+        monotonic_res = monotonic_resource_ctor(NULL, 0, upstreams[i]);
+        ASSERT_NO_ERROR(monotonic_res.error_code);
+        monotonic = monotonic_res.value;
+        resource = &monotonic.base;
+
+        for (size_t j = 0; j < 3; j++)
+        {
+            list_ctor(list, resource);
+            for (int k = 0; k < 1000; k++)
+            {
+                ASSERT_NOT_NULL(list_insert_before(list, list_end(list), k));
+            }
+            ASSERT_TRUE(*list_node_get_value(list_begin(list), int) == 0);
+            list_dtor_type(list, int);
+            monotonic_resource_release(&monotonic);
+        }
+
+        monotonic_resource_dtor(&monotonic);
+    }
+
+    free_list_resource_dtor(&free_list_resource);
+    pool_resource_dtor(&pool_resource);
+
+    return result;
+}
+
+/**
+ * Allocates one block of every size up to 2048 bytes in resource and returns
+ * how much memory the allocators hold meanwhile.
+ */
+static size_t mixed_sizes_live_bytes(MemoryResource* resource)
+{
+    static void* blocks[2048];
+
+    MallocStats before = cmlib_details_malloc_stats();
+    for (size_t i = 0; i < ARRAY_SIZE(blocks); i++)
+    {
+        blocks[i] = resource->allocate(resource, i + 1, 8);
+    }
+    MallocStats diff =
+        cmlib_details_malloc_stats_diff(before, cmlib_details_malloc_stats());
+
+    for (size_t i = 0; i < ARRAY_SIZE(blocks); i++)
+    {
+        memory_resource_deallocate_sized(resource, blocks[i], i + 1, 8);
+    }
+
+    return diff.bytes_live;
+}
+
+static bool test_multi_pool_resource(void)
+{
+    bool result = true;
+
+    ASSERT_ERROR(multi_pool_resource_ctor(64, 4096, NULL).error_code);
+    ASSERT_ERROR(
+        multi_pool_resource_ctor(0, 4096, get_malloc_resource()).error_code);
+
+    Result_StatsResource stats_res = stats_resource_ctor(get_malloc_resource());
+    ASSERT_NO_ERROR(stats_res.error_code);
+    StatsResource stats = stats_res.value;
+
+    Result_MultiPoolResource multi_res =
+        multi_pool_resource_ctor(64, 4096, &stats.base);
+    ASSERT_NO_ERROR(multi_res.error_code);
+    MultiPoolResource multi = multi_res.value;
+    MemoryResource* resource = &multi.base;
+
+    // classes are 8 bytes apart up to 64 and four per power of two above
+    const size_t sizes[][3] = {
+        {1, 8, 8},
+        {64, 8, 64},
+        {65, 8, 80},
+        {100, 8, 112},
+        {1000, 8, 1024},
+        {1025, 8, 1280},
+        {65, 64, 128},
+        {100, 128, 128},
+        {3000, 8, 3072},
+        {5000, 8, 5000},
+        {100, 8192, 100},
+    };
+    for (size_t i = 0; i < ARRAY_SIZE(sizes); i++)
+    {
+        ASSERT_TRUE(
+            multi_pool_resource_block_size(&multi, sizes[i][0], sizes[i][1])
+            == sizes[i][2]);
+    }
+
+    // growing within a class keeps the block
+    char* block = resource->allocate(resource, 65, 8);
+    ASSERT_NOT_NULL(block);
+    memset(block, 3, 65);
+    ASSERT_TRUE(
+        memory_resource_reallocate(resource, block, 65, 80, 8) == block);
+    char* moved = memory_resource_reallocate(resource, block, 80, 81, 8);
+    ASSERT_NOT_NULL(moved);
+    ASSERT_TRUE(moved != block && moved[64] == 3);
+    memory_resource_deallocate_sized(resource, moved, 81, 8);
+    ASSERT_TRUE(stats_resource_collect(&stats).allocations == 0);
+
+    // large blocks go to upstream, with or without a size on the way back
+    char* large = resource->allocate(resource, 10000, 64);
+    ASSERT_NOT_NULL(large);
+    ASSERT_TRUE((uintptr_t)large % 64 == 0);
+    memset(large, 5, 10000);
+    char* other = resource->allocate(resource, 5000, 8);
+    ASSERT_NOT_NULL(other);
+    ASSERT_TRUE(stats_resource_collect(&stats).allocations == 2);
+
+    large = memory_resource_reallocate(resource, large, 10000, 20000, 64);
+    ASSERT_NOT_NULL(large);
+    ASSERT_TRUE((uintptr_t)large % 64 == 0 && large[9999] == 5);
+
+    // shrinking below the limit moves the block into the pool
+    char* small = memory_resource_reallocate(resource, large, 20000, 100, 64);
+    ASSERT_NOT_NULL(small);
+    ASSERT_TRUE(small[99] == 5);
+    resource->deallocate(resource, small);
+    resource->deallocate(resource, other);
+    MemoryStats totals = stats_resource_collect(&stats);
+    ASSERT_TRUE(totals.frees == totals.allocations && totals.live_bytes == 0);
+
+    String string = string_ctor(resource, "").value;
+    int* vec = vec_ctor(resource, int);
+    ASSERT_NOT_NULL(vec);
+    for (int i = 0; i < 10000; i++)
+    {
+        ASSERT_NO_ERROR(string_append_char(&string, 'a'));
+        ASSERT_NO_ERROR(vec_add(vec, i));
+    }
+    ASSERT_TRUE(vec[9999] == 9999);
+    vec_dtor(vec);
+    string_dtor(&string);
+
+    list_ctor(list, resource);
+    for (int i = 0; i < 1000; i++)
+    {
+        ASSERT_NOT_NULL(list_insert_before(list, list_end(list), i));
+    }
+    list_dtor(list);
+
+    // an upstream block left behind is returned by the destructor
+    ASSERT_NOT_NULL(resource->allocate(resource, 1 << 16, 8));
+    multi_pool_resource_dtor(&multi);
+    ASSERT_TRUE(stats_resource_collect(&stats).live_bytes == 0);
+    stats_resource_dtor(&stats);
+
+    // mixed sizes share a few classes instead of one subpool per size
+    PoolResource pool_resource = pool_resource_ctor(64).value;
+    size_t pool_bytes = mixed_sizes_live_bytes(&pool_resource.base);
+    pool_resource_dtor(&pool_resource);
+
+    multi = multi_pool_resource_ctor(64, 4096, get_malloc_resource()).value;
+    size_t multi_bytes = mixed_sizes_live_bytes(&multi.base);
+    multi_pool_resource_dtor(&multi);
+
+    ASSERT_TRUE(multi_bytes * 4 < pool_bytes);
+
+    return result;
+}
+
+static bool test_trace_resource(void)
+{
+    bool result = true;
+
+    const char* path = "cmlib_test.trace";
+
+    ASSERT_ERROR(trace_resource_ctor(NULL, path).error_code);
+    ASSERT_ERROR(trace_resource_ctor(get_malloc_resource(), NULL).error_code);
+
+    Result_TraceResource trace_res =
+        trace_resource_ctor(get_malloc_resource(), path);
+    ASSERT_NO_ERROR(trace_res.error_code);
+    TraceResource trace = trace_res.value;
+    MemoryResource* resource = &trace.base;
+
+    char* small = resource->allocate(resource, 100, 8);
+    char* aligned = resource->allocate(resource, 10, 64);
+    ASSERT_NOT_NULL(small);
+    ASSERT_NOT_NULL(aligned);
+    ASSERT_TRUE((uintptr_t)aligned % 64 == 0);
+    memset(small, 7, 100);
+
+    small = memory_resource_reallocate(resource, small, 100, 5000, 8);
+    ASSERT_NOT_NULL(small);
+    ASSERT_TRUE(small[99] == 7);
+    resource->deallocate(resource, aligned);
+    memory_resource_deallocate_sized(resource, small, 5000, 8);
+    ASSERT_NULL(resource->allocate(resource, SIZE_MAX, 8));
+
+    ASSERT_NO_ERROR(trace_resource_flush(&trace));
+    trace_resource_dtor(&trace);
+
+    const TraceRecord expected[] = {
+        {.op = TRACE_ALLOCATE, .id = 1, .size = 100, .alignment = 8},
+        {.op = TRACE_ALLOCATE, .id = 2, .size = 10, .alignment = 64},
+        {.op = TRACE_REALLOCATE, .id = 1, .size = 5000, .alignment = 8},
+        {.op = TRACE_DEALLOCATE, .id = 2},
+        {.op = TRACE_DEALLOCATE, .id = 1},
+        {.op = TRACE_ALLOCATE, .id = 0, .size = SIZE_MAX, .alignment = 8},
+    };
+
+    FILE* file = fopen(path, "rb");
+    ASSERT_NOT_NULL(file);
+    if (!file)
+    {
+        return result;
+    }
+    ASSERT_NO_ERROR(trace_read_header(file));
+
+    TraceRecord records[ARRAY_SIZE(expected) + 1] = {};
+    size_t count = fread(records, sizeof(*records), ARRAY_SIZE(records), file);
+    fclose(file);
+    remove(path);
+
+    ASSERT_TRUE(count == ARRAY_SIZE(expected));
+    for (size_t i = 0; i < MIN(count, ARRAY_SIZE(expected)); i++)
+    {
+        ASSERT_TRUE(records[i].op == expected[i].op);
+        ASSERT_TRUE(records[i].id == expected[i].id);
+        ASSERT_TRUE(records[i].size == expected[i].size);
+        ASSERT_TRUE(records[i].alignment == expected[i].alignment);
+        ASSERT_TRUE(records[i].thread != 0
+                    && records[i].thread == records[0].thread);
+        ASSERT_TRUE(records[i].timestamp >= records[i ? i - 1 : 0].timestamp);
+    }
+
+    // a file of another kind is rejected
+    file = fopen(path, "w+b");
+    ASSERT_NOT_NULL(file);
+    if (file)
+    {
+        fputs("not a trace file", file);
+        rewind(file);
+        ASSERT_ERROR(trace_read_header(file));
+        fclose(file);
+        remove(path);
+    }
+
+    return result;
+}
+
+typedef struct CacheLineCounter
+{
+    alignas(64) size_t value;
+} CacheLineCounter;
+
+/**
+ * Allocates, grows and frees 64 byte and 4 KiB aligned blocks in resource,
+ * and builds a vector and a list of cache line aligned values in it.
+ */
+static bool check_resource_alignment(MemoryResource* resource)
+{
+    bool result = true;
+
+    const size_t alignments[] = {64, 4096};
+    for (size_t i = 0; i < ARRAY_SIZE(alignments); i++)
+    {
+        size_t alignment = alignments[i];
+
+        char* block = resource->allocate(resource, 100, alignment);
+        ASSERT_NOT_NULL(block);
+        if (!block)
+        {
+            continue;
+        }
+        ASSERT_TRUE((uintptr_t)block % alignment == 0);
+        memset(block, 7, 100);
+
+        char* grown =
+            memory_resource_reallocate(resource, block, 100, 3000, alignment);
+        ASSERT_NOT_NULL(grown);
+        if (!grown)
+        {
+            memory_resource_deallocate_sized(resource, block, 100, alignment);
+            continue;
+        }
+        ASSERT_TRUE((uintptr_t)grown % alignment == 0);
+        ASSERT_TRUE(grown[99] == 7);
+        memory_resource_deallocate_sized(resource, grown, 3000, alignment);
+    }
+
+    CacheLineCounter* counters = vec_ctor(resource, CacheLineCounter);
+    ASSERT_NOT_NULL(counters);
+    for (size_t i = 0; i < 100; i++)
+    {
+        ASSERT_NO_ERROR(vec_add(counters, (CacheLineCounter) {i}));
+    }
+    ASSERT_TRUE((uintptr_t)counters % alignof(CacheLineCounter) == 0);
+    ASSERT_TRUE(vec_size(counters) == 100 && counters[99].value == 99);
+    vec_dtor(counters);
+
+    list_ctor(list, resource);
+    ListNode* node =
+        list_insert_after(list, list_end(list), (CacheLineCounter) {42});
+    ASSERT_NOT_NULL(node);
+    CacheLineCounter* counter = list_node_get_value(node, CacheLineCounter);
+    ASSERT_TRUE((uintptr_t)counter % alignof(CacheLineCounter) == 0);
+    ASSERT_TRUE(counter && counter->value == 42);
+    list_dtor_type(list, CacheLineCounter);
+
+    return result;
+}
+
+static bool test_resource_alignment(void)
+{
+    bool result = true;
+
+    ASSERT_TRUE(check_resource_alignment(get_malloc_resource()));
+    ASSERT_TRUE(check_resource_alignment(get_calloc_resource()));
+
+    MemoryResource* calloc_resource = get_calloc_resource();
+    char* zeros = calloc_resource->allocate(calloc_resource, 5000, 4096);
+    ASSERT_NOT_NULL(zeros);
+    if (zeros)
+    {
+        ASSERT_TRUE(zeros[0] == 0 && zeros[4999] == 0);
+    }
+    calloc_resource->deallocate(calloc_resource, zeros);
+
+    Result_ArenaResource arena_res = arena_resource_ctor(1 << 20);
+    ASSERT_NO_ERROR(arena_res.error_code);
+    ASSERT_TRUE(check_resource_alignment(&arena_res.value.base));
+    arena_resource_dtor(&arena_res.value);
+
+    arena_res = arena_resource_ctor_growable(4096, 2);
+    ASSERT_NO_ERROR(arena_res.error_code);
+    ASSERT_TRUE(check_resource_alignment(&arena_res.value.base));
+    arena_resource_dtor(&arena_res.value);
+
+    arena_res = arena_resource_ctor_virtual(1 << 24);
+    ASSERT_NO_ERROR(arena_res.error_code);
+    ASSERT_TRUE(check_resource_alignment(&arena_res.value.base));
+    arena_resource_dtor(&arena_res.value);
+
+    Result_FreeListResource free_list_res = free_list_resource_ctor(1 << 16);
+    ASSERT_NO_ERROR(free_list_res.error_code);
+    ASSERT_TRUE(check_resource_alignment(&free_list_res.value.base));
+    free_list_resource_dtor(&free_list_res.value);
+
+    Result_PoolResource pool_res = pool_resource_ctor(64);
+    ASSERT_NO_ERROR(pool_res.error_code);
+    ASSERT_TRUE(check_resource_alignment(&pool_res.value.base));
+    pool_resource_dtor(&pool_res.value);
+
+    Result_ConcurrentPoolResource concurrent_res =
+        concurrent_pool_resource_ctor(64);
+    ASSERT_NO_ERROR(concurrent_res.error_code);
+    ASSERT_TRUE(check_resource_alignment(&concurrent_res.value.base));
+    concurrent_pool_resource_dtor(&concurrent_res.value);
+
+    Result_LockFreePoolResource lock_free_res =
+        lock_free_pool_resource_ctor(16384, 4096, 16);
+    ASSERT_NO_ERROR(lock_free_res.error_code);
+    ASSERT_TRUE(check_resource_alignment(&lock_free_res.value.base));
+    lock_free_pool_resource_dtor(&lock_free_res.value);
+
+    Result_StatsResource stats_res = stats_resource_ctor(get_malloc_resource());
+    ASSERT_NO_ERROR(stats_res.error_code);
+    ASSERT_TRUE(check_resource_alignment(&stats_res.value.base));
+    stats_resource_dtor(&stats_res.value);
+
+    alignas(64) char buffer[256];
+    Result_MonotonicResource monotonic_res =
+        monotonic_resource_ctor(buffer, sizeof(buffer), get_malloc_resource());
+    ASSERT_NO_ERROR(monotonic_res.error_code);
+    ASSERT_TRUE(check_resource_alignment(&monotonic_res.value.base));
+    monotonic_resource_dtor(&monotonic_res.value);
+
+    Result_MultiPoolResource multi_res =
+        multi_pool_resource_ctor(64, 4096, get_malloc_resource());
+    ASSERT_NO_ERROR(multi_res.error_code);
+    ASSERT_TRUE(check_resource_alignment(&multi_res.value.base));
+    multi_pool_resource_dtor(&multi_res.value);
+
+    Result_TraceResource trace_res =
+        trace_resource_ctor(get_malloc_resource(), "cmlib_alignment.trace");
+    ASSERT_NO_ERROR(trace_res.error_code);
+    ASSERT_TRUE(check_resource_alignment(&trace_res.value.base));
+    trace_resource_dtor(&trace_res.value);
+    remove("cmlib_alignment.trace");
+
+    Result_StackResource stack_res = stack_resource_ctor(1 << 16);
+    ASSERT_NO_ERROR(stack_res.error_code);
+    ASSERT_TRUE(check_resource_alignment(&stack_res.value.base));
+    stack_resource_dtor(&stack_res.value);
 
     return result;
 }
@@ -524,11 +2448,37 @@ int main()
 {
     TestEntry tests[] = {
         make_test_entry(test_arena),
+        make_test_entry(test_arena_growable),
+        make_test_entry(test_arena_mark),
+        make_test_entry(test_arena_virtual),
         make_test_entry(test_free_list),
+        make_test_entry(test_free_list_coalescing),
+        make_test_entry(test_free_list_size_classes),
+        make_test_entry(test_free_list_many_pools),
+        make_test_entry(test_free_list_large_blocks),
         make_test_entry(test_free_list_dump),
         make_test_entry(test_pool),
+        make_test_entry(test_pool_classes),
+        make_test_entry(test_pool_trim),
+        make_test_entry(test_pool_small_count),
+        make_test_entry(test_pool_large_blocks),
+        make_test_entry(test_pool_bulk),
+        make_test_entry(test_huge_pages),
+        make_test_entry(test_prefault),
+        make_test_entry(test_stack_allocator),
+        make_test_entry(test_concurrent_pool),
+        make_test_entry(test_lock_free_pool),
+        make_test_entry(test_counting_malloc),
+        make_test_entry(test_stats_resource),
+        make_test_entry(test_monotonic_resource),
+        make_test_entry(test_multi_pool_resource),
+        make_test_entry(test_trace_resource),
         make_test_entry(test_list),
+        make_test_entry(test_list_bulk),
         make_test_entry(test_resource_conversions),
+        make_test_entry(test_resource_alignment),
+        make_test_entry(test_resource_reallocate),
+        make_test_entry(test_resource_deallocate_sized),
         make_test_entry(test_string),
         make_test_entry(test_vector),
         make_test_entry(test_io)